@@ -85,17 +85,27 @@ def align32(i: int) -> int:
         return (i | 3) + 1
 
 
-def create(data_dir: str, size: str, image_file: str) -> None:
+def parse_size(size: str) -> int:
+    if size[-1].lower() == "k":
+        return int(size[:-1]) * 1024
+    elif size[-1].lower() == "m":
+        return int(size[:-1]) * 1048576
+    else:
+        return int(size)
+
+
+def create(data_dir: str, size: str, reserve: str, image_file: str) -> None:
     """
     Create a ERFS filesystem image.
+    The last `reserve` bytes of the fs area are left out of the image (flash log of the firmware).
     """
 
-    if size[-1].lower() == "k":
-        size = int(size[:-1]) * 1024
-    elif size[-1].lower() == "m":
-        size = int(size[:-1]) * 1048576
-    else:
-        size = int(size)
+    size = parse_size(size)
+    reserve = parse_size(reserve)
+    if reserve >= size:
+        print(f"reserved area ({reserve} bytes) leaves no room for the FS", file=sys.stderr)
+        exit(2)
+    size -= reserve
 
     click.echo(click.style("ERFS 3.2 builder", fg="bright_green"))
 
@@ -270,18 +280,27 @@ def list_content(image_file: str, verbose: bool, extract_dir: str, patterns) ->
 @click.option("-l", "--list", "list_files", help="list the content of an image", is_flag=True)
 @click.option("-x", "--extract", "extract_dir", metavar="DIR", help="extract files to directory", type=str)
 @click.option("-s", "--size", metavar="SIZE", help="fs image size, in bytes", type=str, default="1m", show_default=True)
+@click.option(
+    "-r",
+    "--reserve",
+    metavar="SIZE",
+    help="bytes left free at the end of the fs area (TIC_FLASHLOG_SECTORS * FLASH_SECTOR_SIZE)",
+    type=str,
+    default="16k",
+    show_default=True,
+)
 @click.option("-b", "--block", help="ignored", type=int, expose_value=False)
 @click.option("-p", "--page", help="ignored", type=int, expose_value=False)
 @click.option("-v", "--verbose", help="verbose list", is_flag=True)
 @click.argument("image_file")
 @click.argument("files", metavar="[FILES_TO_EXTRACT]", nargs=-1)
-def main(data_dir, list_files, extract_dir, size, verbose, image_file, files):
+def main(data_dir, list_files, extract_dir, size, reserve, verbose, image_file, files):
 
     if list_files or extract_dir:
         list_content(image_file, verbose, extract_dir, files)
 
     else:
-        create(data_dir, size, image_file)
+        create(data_dir, size, reserve, image_file)
 
 
 if __name__ == "__main__":
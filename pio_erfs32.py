@@ -3,6 +3,8 @@
 # Copyright (c) 2020 René Devichi. All rights reserved.
 
 # Replace the fs builder tool in the SCons environment
+# mkerfs32.py leaves the last 16 Ko of the fs area out of the image (--reserve):
+# they hold the flash log of the firmware (TIC_FLASHLOG_SECTORS in src/tic.cpp)
 
 Import("env")
 
@@ -0,0 +1,148 @@
+/*
+ * librairie Teleinfo: détection automatique de la vitesse
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include "teleinfo.h"
+
+// Écoute successivement la ligne à 1200 bauds (mode historique) et à 9600 bauds
+// (mode standard) et retient le mode qui produit le plus de groupes valides.
+// Une fois verrouillé, la détection n'est relancée qu'après une longue série
+// d'erreurs de réception sans aucun groupe valide.
+//
+// La classe ne touche pas au port série: update() indique quand il faut
+// changer de vitesse, baudrate() donne la vitesse à utiliser.
+class TeleinfoAutoBaud
+{
+public:
+    enum : uint8_t
+    {
+        MODE_HISTORIQUE = 0, // 1200 bauds, séparateur SP
+        MODE_STANDARD = 1,   // 9600 bauds, séparateur HT
+    };
+
+    static const uint32_t SAMPLE_MS = 3000;     // durée d'écoute d'une vitesse (au moins une trame)
+    static const uint32_t MIN_GROUPS = 2;       // score minimal pour retenir un mode
+    static const uint32_t LOCK_GROUPS = 8;      // score suffisant pour verrouiller sans attendre
+    static const uint32_t RELOCK_FAILURES = 64; // erreurs consécutives avant nouvelle détection
+    static const uint32_t RELOCK_MS = 15000;    // ... et durée minimale sans groupe valide
+    static const uint32_t STRAY_BYTES = 8;      // octets hors trame comptés comme une erreur
+
+    static uint32_t baudrate(uint8_t mode)
+    {
+        return (mode == MODE_STANDARD) ? 9600 : 1200;
+    }
+
+private:
+    uint8_t mode_{MODE_HISTORIQUE}; // mode écouté ou verrouillé
+    bool locked_{false};
+    uint8_t sampled_{0};    // modes déjà écoutés dans le cycle en cours (bits)
+    uint32_t scores_[2]{};  // groupes valides obtenus par mode
+    uint32_t start_ms_{0};  // début de l'écoute ou dernier groupe valide
+    uint32_t groups0_{0};   // compteur de groupes valides au début de l'écoute
+    uint32_t failures0_{0}; // compteur d'erreurs au dernier groupe valide
+
+    static uint32_t failures(const TeleinfoDecoder::Stats &stats)
+    {
+        // à la mauvaise vitesse, le STX est rare: les octets hors trame comptent aussi
+        return stats.checksum_errors + stats.overflows + stats.resyncs + stats.stray_bytes / STRAY_BYTES;
+    }
+
+    void listen(uint8_t mode, const TeleinfoDecoder::Stats &stats, uint32_t now_ms)
+    {
+        mode_ = mode;
+        start_ms_ = now_ms;
+        groups0_ = stats.groups[mode];
+    }
+
+    void lock(uint8_t mode, const TeleinfoDecoder::Stats &stats, uint32_t now_ms)
+    {
+        locked_ = true;
+        listen(mode, stats, now_ms);
+        failures0_ = failures(stats);
+    }
+
+public:
+    // commence la détection par le mode donné (le dernier mode détecté par exemple)
+    void start(uint8_t mode, const TeleinfoDecoder::Stats &stats, uint32_t now_ms)
+    {
+        locked_ = false;
+        sampled_ = 0;
+        listen(mode & 1, stats, now_ms);
+    }
+
+    bool locked() const
+    {
+        return locked_;
+    }
+
+    uint8_t mode() const
+    {
+        return mode_;
+    }
+
+    uint32_t baudrate() const
+    {
+        return baudrate(mode_);
+    }
+
+    // à appeler après avoir passé des octets au décodeur
+    // retourne true si la vitesse de la liaison doit être changée
+    bool update(const TeleinfoDecoder::Stats &stats, uint32_t now_ms)
+    {
+        uint32_t groups = stats.groups[mode_] - groups0_;
+
+        if (locked_)
+        {
+            if (groups != 0)
+            {
+                // tout va bien
+                lock(mode_, stats, now_ms);
+                return false;
+            }
+
+            if ((failures(stats) - failures0_ >= RELOCK_FAILURES) && (now_ms - start_ms_ >= RELOCK_MS))
+            {
+                // la ligne ne correspond plus au mode: on commence par l'autre
+                start(mode_ ^ 1, stats, now_ms);
+                return true;
+            }
+            return false;
+        }
+
+        if (groups >= LOCK_GROUPS)
+        {
+            // pas de doute possible
+            lock(mode_, stats, now_ms);
+            return false;
+        }
+
+        if (now_ms - start_ms_ < SAMPLE_MS)
+        {
+            return false;
+        }
+
+        // fin de l'écoute de ce mode
+        scores_[mode_] = groups;
+        sampled_ |= 1 << mode_;
+
+        if (sampled_ == 3)
+        {
+            // les deux modes ont été écoutés
+            sampled_ = 0;
+
+            uint8_t current = mode_;
+            uint8_t best = (scores_[MODE_STANDARD] > scores_[MODE_HISTORIQUE]) ? MODE_STANDARD : MODE_HISTORIQUE;
+            if (scores_[best] >= MIN_GROUPS)
+            {
+                lock(best, stats, now_ms);
+                return best != current;
+            }
+        }
+
+        // écoute l'autre mode
+        listen(mode_ ^ 1, stats, now_ms);
+        return true;
+    }
+};
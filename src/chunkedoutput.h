@@ -0,0 +1,138 @@
+// sortie HTTP par morceaux (Transfer-Encoding: chunked) via ESP8266WebServer
+// rene-d 2020
+
+#pragma once
+
+#include <Arduino.h>
+#include <ESP8266WebServer.h>
+
+// Remplace la String des constructeurs JSON: le texte est accumulé dans un
+// petit tampon fixe, passé à sendContent() dès qu'il est plein. La réponse
+// a été commencée avec setContentLength(CONTENT_LENGTH_UNKNOWN) et send(),
+// c'est le serveur qui la découpe en morceaux HTTP: elle n'est jamais
+// entièrement en mémoire, quelle que soit sa taille.
+//
+// Les derniers caractères écrits restent dans le tampon pour que finalize()
+// puisse encore les modifier: operator[] et remove() ne portent que sur eux.
+class ChunkedOutput
+{
+public:
+    enum : size_t
+    {
+        BUFFER_SIZE = 256, // données par morceau
+        KEEP = 2,          // caractères gardés lors de l'envoi d'un tampon plein
+    };
+
+private:
+    ESP8266WebServer &server_;
+    char buffer_[BUFFER_SIZE];
+    size_t length_;  // caractères dans le tampon
+    size_t flushed_; // caractères déjà envoyés
+    size_t chunks_;  // morceaux envoyés
+
+    // envoie les n premiers caractères du tampon
+    void send(size_t n)
+    {
+        server_.sendContent(buffer_, n);
+        ++chunks_;
+
+        memmove(buffer_, buffer_ + n, length_ - n);
+        flushed_ += n;
+        length_ -= n;
+    }
+
+public:
+    explicit ChunkedOutput(ESP8266WebServer &server) : server_(server), length_(0), flushed_(0), chunks_(0)
+    {
+    }
+
+    // envoie ce qui reste et le morceau vide qui termine la réponse
+    void end()
+    {
+        if (length_ != 0)
+        {
+            send(length_);
+        }
+        server_.sendContent("");
+    }
+
+    size_t chunks() const
+    {
+        return chunks_;
+    }
+
+    // interface String utilisée par JSONBuilder et JSONTableBuilder
+
+    void reserve(size_t)
+    {
+    }
+
+    void clear()
+    {
+        length_ = 0;
+    }
+
+    size_t length() const
+    {
+        return flushed_ + length_;
+    }
+
+    char &operator[](size_t index)
+    {
+        return buffer_[index - flushed_];
+    }
+
+    void remove(size_t index, size_t count)
+    {
+        // seulement en fin de texte
+        length_ = index - flushed_;
+        (void)count;
+    }
+
+    void concat(char c)
+    {
+        if (length_ == BUFFER_SIZE)
+        {
+            send(BUFFER_SIZE - KEEP);
+        }
+        buffer_[length_++] = c;
+    }
+
+    void concat(const char *s)
+    {
+        while (*s != 0)
+        {
+            concat(*s++);
+        }
+    }
+
+    void concat(const __FlashStringHelper *s)
+    {
+        PGM_P p = reinterpret_cast<PGM_P>(s);
+        char c;
+        while ((c = pgm_read_byte(p++)) != 0)
+        {
+            concat(c);
+        }
+    }
+
+    void concat(const String &s)
+    {
+        concat(s.c_str());
+    }
+
+    void concat(uint32_t value)
+    {
+        char digits[10];
+        uint8_t n = 0;
+        do
+        {
+            digits[n++] = '0' + value % 10;
+            value /= 10;
+        } while (value != 0);
+        while (n != 0)
+        {
+            concat(digits[--n]);
+        }
+    }
+};
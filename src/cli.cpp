@@ -167,6 +167,7 @@ void cli_setup()
 
         if (arg == "restart")
         {
+            tic_save_history();
             Serial.println(F("restart..."));
             Serial.flush();
 
@@ -25,6 +25,7 @@
 
 #include "wifinfo.h"
 #include "config.h"
+#include "chunkedoutput.h"
 #include "jsonbuilder.h"
 #include "strncpy_s.h"
 #include "tic.h"
@@ -94,6 +95,7 @@ void config_reset()
     strcpy_P(config.ota_auth, DEFAULT_OTA_AUTH);
     config.ota_port = DEFAULT_OTA_PORT;
     config.sse_freq = 10;
+    config.tic_mode = TIC_MODE_AUTO;
 
     // Emoncms
     strcpy_P(config.emoncms.host, CFG_EMON_DEFAULT_HOST);
@@ -208,6 +210,78 @@ bool config_save()
     return ret_code;
 }
 
+// prix du kWh par index en euros séparés par des virgules, jusqu'au dernier prix défini
+static void config_prices_string(char *buf, size_t size)
+{
+    size_t n = CFG_TARIFF_PRICES;
+    while ((n != 0) && (config.prices[n - 1] == 0))
+    {
+        --n;
+    }
+
+    size_t pos = 0;
+    buf[0] = 0;
+    for (size_t i = 0; (i < n) && (pos < size); ++i)
+    {
+        pos += snprintf(buf + pos, size - pos, "%s%u.%04u", (i == 0) ? "" : ",", config.prices[i] / 10000, config.prices[i] % 10000);
+    }
+}
+
+// lit les prix du kWh en euros, au dix-millième près: "0.1296,0.1582"
+// les prix ne sont pas modifiés si l'un d'eux n'est pas un nombre ou dépasse 6.5535 €
+static bool config_parse_prices(const String &value)
+{
+    uint16_t prices[CFG_TARIFF_PRICES];
+    const char *p = value.c_str();
+
+    for (size_t i = 0; i < CFG_TARIFF_PRICES; ++i)
+    {
+        uint32_t price = 0;
+        uint32_t scale = 10000;
+
+        while (*p == ' ')
+        {
+            ++p;
+        }
+        while (isdigit(*p))
+        {
+            price = price * 10 + (*p++ - '0');
+            if (price > UINT16_MAX / 10000)
+            {
+                return false;
+            }
+        }
+        price *= 10000;
+        if (*p == '.')
+        {
+            ++p;
+            while (isdigit(*p))
+            {
+                scale /= 10;
+                price += (*p++ - '0') * scale;
+            }
+        }
+        while (*p == ' ')
+        {
+            ++p;
+        }
+
+        if ((price > UINT16_MAX) || ((*p != 0) && (*p != ',')))
+        {
+            return false;
+        }
+        prices[i] = price;
+
+        if (*p == ',')
+        {
+            ++p;
+        }
+    }
+
+    memcpy(config.prices, prices, sizeof(config.prices));
+    return true;
+}
+
 // print configuration
 void config_show()
 {
@@ -235,6 +309,22 @@ void config_show()
     Serial.print(F("SSE freq :"));
     Serial.println(config.sse_freq);
 
+    Serial.print(F("TIC mode :"));
+    if (config.tic_mode == TIC_MODE_AUTO)
+    {
+        Serial.print(F("auto, détecté "));
+        Serial.println(config.tic_detected == TIC_MODE_STANDARD ? F("standard") : F("historique"));
+    }
+    else
+    {
+        Serial.println(config.tic_mode == TIC_MODE_STANDARD ? F("standard") : F("historique"));
+    }
+
+    char prices[CFG_TARIFF_PRICES * 8];
+    config_prices_string(prices, sizeof(prices));
+    Serial.print(F("Prix kWh :"));
+    Serial.println(prices);
+
     Serial.print(F("Config   :"));
     if (config.options & OPTION_LED_TINFO)
     {
@@ -311,9 +401,12 @@ void config_show()
 }
 
 // Return JSON string containing configuration data
-void config_get_json(String &r, bool restricted)
+template <typename Output>
+void config_get_json(Output &r, bool restricted)
 {
-    JSONBuilder js(r, 1024);
+    char prices[CFG_TARIFF_PRICES * 8];
+
+    BasicJSONBuilder<Output> js(r, 1024);
 
     if (!restricted)
     {
@@ -330,6 +423,9 @@ void config_get_json(String &r, bool restricted)
     }
 
     js.append(CFG_FORM_SSE_FREQ, config.sse_freq);
+    js.append(CFG_FORM_TIC_MODE, config.tic_mode);
+    config_prices_string(prices, sizeof(prices));
+    js.append(CFG_FORM_PRICES, prices);
     js.append(CFG_LED_TINFO, (config.options & OPTION_LED_TINFO) ? 1 : 0);
 
     js.append(CFG_FORM_EMON_HOST, config.emoncms.host);
@@ -359,6 +455,9 @@ void config_get_json(String &r, bool restricted)
     js.append(CFG_FORM_HTTPREQ_SEUIL_HAUT, config.httpreq.seuil_haut, true);
 }
 
+template void config_get_json(String &r, bool restricted);
+template void config_get_json(ChunkedOutput &r, bool restricted);
+
 static int validate_int(const String &value, int a, int b, int d)
 {
     int v = value.toInt();
@@ -396,6 +495,9 @@ void config_handle_form(ESP8266WebServer &server, bool restricted)
             strncpy_s(config.password, server.arg(CFG_FORM_PASSWORD), CFG_PASSWORD_LENGTH);
         }
         config.sse_freq = validate_int(server.arg(CFG_FORM_SSE_FREQ), 0, 360, 0);
+        tic_set_mode(validate_int(server.arg(CFG_FORM_TIC_MODE), TIC_MODE_HISTORIQUE, TIC_MODE_AUTO, TIC_MODE_AUTO));
+        // sans le champ, les prix restent ceux enregistrés
+        bool prices_ok = !server.hasArg(CFG_FORM_PRICES) || config_parse_prices(server.arg(CFG_FORM_PRICES));
 
         config.options = 0;
         if (server.hasArg(CFG_LED_TINFO))
@@ -432,15 +534,20 @@ void config_handle_form(ESP8266WebServer &server, bool restricted)
         config.httpreq.seuil_bas = validate_int(server.arg(CFG_FORM_HTTPREQ_SEUIL_BAS), 0, 20000, 0);
         config.httpreq.seuil_haut = validate_int(server.arg(CFG_FORM_HTTPREQ_SEUIL_HAUT), 0, 20000, 0);
 
-        if (config_save())
+        if (!config_save())
         {
-            ret = 200;
-            response = PSTR("OK");
+            ret = 412;
+            response = PSTR("Unable to save configuration");
+        }
+        else if (!prices_ok)
+        {
+            ret = 400;
+            response = PSTR("Invalid prices");
         }
         else
         {
-            ret = 412;
-            response = PSTR("Unable to save configuration");
+            ret = 200;
+            response = PSTR("OK");
         }
 
         config_show();
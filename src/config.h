@@ -63,6 +63,14 @@
 #define CFG_LED_TINFO FPSTR("cfg_led_tinfo")
 #define OPTION_LED_TINFO 0x0001 // blink led sur réception téléinfo
 
+// mode de la téléinformation
+#define TIC_MODE_HISTORIQUE 0 // 1200 bauds
+#define TIC_MODE_STANDARD 1   // 9600 bauds
+#define TIC_MODE_AUTO 2       // détection automatique au démarrage
+
+// nombre d'index tarifaires (EASF01 à EASF10)
+#define CFG_TARIFF_PRICES 10
+
 // Web Interface Configuration Form field names
 #define CFG_FORM_SSID FPSTR("ssid")
 #define CFG_FORM_PSK FPSTR("psk")
@@ -71,8 +79,10 @@
 #define CFG_FORM_OTA_AUTH FPSTR("ota_auth")
 #define CFG_FORM_OTA_PORT FPSTR("ota_port")
 #define CFG_FORM_SSE_FREQ FPSTR("sse_freq")
+#define CFG_FORM_TIC_MODE FPSTR("tic_mode")
 #define CFG_FORM_USERNAME FPSTR("username")
 #define CFG_FORM_PASSWORD FPSTR("password")
+#define CFG_FORM_PRICES FPSTR("prices")
 
 #define CFG_FORM_EMON_HOST FPSTR("emon_host")
 #define CFG_FORM_EMON_PORT FPSTR("emon_port")
@@ -159,7 +169,10 @@ struct Config
     uint16_t sse_freq;                      // fréquence mini des mises à jour SSE. 0=dès qu'une trame est dispo
     char username[CFG_USERNAME_LENGTH + 1]; // nom pour Basic Auth
     char password[CFG_PASSWORD_LENGTH + 1]; // mot de passe
-    uint8_t filler[65];                     // in case adding data in config avoiding loosing current conf by bad crc
+    uint8_t tic_mode;                       // TIC_MODE_HISTORIQUE, TIC_MODE_STANDARD ou TIC_MODE_AUTO
+    uint8_t tic_detected;                   // dernier mode détecté en TIC_MODE_AUTO
+    uint16_t prices[CFG_TARIFF_PRICES];     // prix du kWh par index tarifaire, en dix-millièmes d'euro
+    uint8_t filler[43];                     // in case adding data in config avoiding loosing current conf by bad crc
     EmoncmsConfig emoncms;                  // Emoncms configuration
     JeedomConfig jeedom;                    // jeedom configuration
     HttpreqConfig httpreq;                  // HTTP request
@@ -175,7 +188,8 @@ extern Config config;
 bool config_read(bool clear_on_error = true);
 bool config_save(void);
 void config_show(void);
-void config_get_json(String &r, bool restricted);
+template <typename Output>
+void config_get_json(Output &r, bool restricted);
 void config_handle_form(ESP8266WebServer &server, bool restricted);
 void config_setup();
 void config_reset();
@@ -0,0 +1,258 @@
+/*
+ * librairie Teleinfo: pointes de puissance moyenne
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+
+// Puissance apparente moyenne sur des fenêtres de 10 et 30 minutes alignées
+// sur l'horloge, et plus fortes moyennes du jour et du mois.
+//
+// Chaque trame prolonge l'intégrale de la fenêtre en cours avec la puissance
+// de la trame précédente: la mise à jour est en O(1), sans historique.
+// Une fenêtre terminée a pour puissance son intégrale divisée par la durée
+// effectivement couverte par les trames; elle est ignorée si la téléinformation
+// a manqué plus de la moitié du temps.
+class DemandTracker
+{
+public:
+    enum : uint8_t
+    {
+        NB_WINDOWS = 2,
+        TOP = 3, // pointes gardées par jour et par mois
+    };
+
+    enum Scope : uint8_t
+    {
+        DAY,
+        MONTH,
+        NB_SCOPES
+    };
+
+    // puissance moyenne d'une fenêtre terminée
+    struct Peak
+    {
+        uint32_t time; // début de la fenêtre
+        uint16_t va;   // puissance apparente moyenne en VA, 0 si vide
+    };
+
+    // au-delà, l'absence de trames n'est pas intégrée
+    static const uint32_t MAX_GAP_MS = 60000;
+
+private:
+    struct window
+    {
+        uint16_t seconds;         // durée de la fenêtre
+        uint32_t start;           // début de la fenêtre en cours
+        uint64_t integral;        // puissance intégrée en VA.ms
+        uint32_t covered_ms;      // durée intégrée
+        Peak last;                // dernière fenêtre terminée
+        Peak top[NB_SCOPES][TOP]; // plus fortes fenêtres, par ordre décroissant
+    };
+
+    window windows_[NB_WINDOWS];
+    bool started_;
+    uint32_t last_sec_;
+    uint16_t last_ms_;
+    uint16_t last_va_;
+    uint32_t day_;   // jour de l'heure locale (année * 400 + jour de l'année)
+    uint32_t month_; // mois de l'heure locale (année * 12 + mois)
+
+    static void insert(Peak top[TOP], const Peak &peak)
+    {
+        uint8_t i = 0;
+        while ((i < TOP) && (top[i].va >= peak.va))
+        {
+            ++i;
+        }
+        if (i == TOP)
+        {
+            return;
+        }
+        for (uint8_t j = TOP - 1; j > i; --j)
+        {
+            top[j] = top[j - 1];
+        }
+        top[i] = peak;
+    }
+
+    static void clear_top(Peak top[TOP])
+    {
+        for (uint8_t i = 0; i < TOP; ++i)
+        {
+            top[i].time = 0;
+            top[i].va = 0;
+        }
+    }
+
+    // termine la fenêtre en cours, retourne true si elle a assez de mesures
+    static bool close(window &w)
+    {
+        bool valid = (w.covered_ms != 0) && (w.covered_ms >= w.seconds * 500u);
+        if (valid)
+        {
+            w.last.time = w.start;
+            w.last.va = w.integral / w.covered_ms;
+            insert(w.top[DAY], w.last);
+            insert(w.top[MONTH], w.last);
+        }
+        w.start += w.seconds;
+        w.integral = 0;
+        w.covered_ms = 0;
+        return valid;
+    }
+
+    void restart(uint32_t sec)
+    {
+        for (uint8_t i = 0; i < NB_WINDOWS; ++i)
+        {
+            window &w = windows_[i];
+            w.start = sec - sec % w.seconds;
+            w.integral = 0;
+            w.covered_ms = 0;
+        }
+    }
+
+public:
+    DemandTracker()
+    {
+        windows_[0].seconds = 600;
+        windows_[1].seconds = 1800;
+        clear();
+    }
+
+    void clear()
+    {
+        for (uint8_t i = 0; i < NB_WINDOWS; ++i)
+        {
+            window &w = windows_[i];
+            w.start = 0;
+            w.integral = 0;
+            w.covered_ms = 0;
+            w.last.time = 0;
+            w.last.va = 0;
+            clear_top(w.top[DAY]);
+            clear_top(w.top[MONTH]);
+        }
+        started_ = false;
+        last_sec_ = 0;
+        last_ms_ = 0;
+        last_va_ = 0;
+        day_ = 0;
+        month_ = 0;
+    }
+
+    // ajoute une mesure: date en secondes et millisecondes, puissance apparente en VA,
+    // et la même date en heure locale pour les changements de jour et de mois
+    // retourne true si une fenêtre vient de se terminer
+    bool add(uint32_t sec, uint16_t ms, uint16_t va, const struct tm &local)
+    {
+        uint32_t day = (local.tm_year * 400) + local.tm_yday;
+        uint32_t month = (local.tm_year * 12) + local.tm_mon;
+        bool closed = false;
+
+        if (!started_ || (sec < last_sec_) || ((sec == last_sec_) && (ms < last_ms_)))
+        {
+            // première mesure ou retour de l'horloge en arrière
+            if (!started_)
+            {
+                day_ = day;
+                month_ = month;
+            }
+            started_ = true;
+            restart(sec);
+        }
+        else
+        {
+            uint64_t now = sec * 1000ull + ms;
+            uint64_t prev = last_sec_ * 1000ull + last_ms_;
+            bool integrate = (now - prev <= MAX_GAP_MS);
+
+            for (uint8_t i = 0; i < NB_WINDOWS; ++i)
+            {
+                window &w = windows_[i];
+                uint64_t t = prev;
+
+                // termine les fenêtres révolues, la suivante reprend à la fin de celle-ci
+                while (now >= (w.start + w.seconds) * 1000ull)
+                {
+                    uint64_t end = (w.start + w.seconds) * 1000ull;
+                    if (integrate && (t < end))
+                    {
+                        w.integral += static_cast<uint64_t>(last_va_) * (end - t);
+                        w.covered_ms += end - t;
+                        t = end;
+                    }
+                    closed |= close(w);
+
+                    if (!integrate)
+                    {
+                        // longue interruption: pas de fenêtres vides à parcourir
+                        w.start = sec - sec % w.seconds;
+                        break;
+                    }
+                }
+
+                if (integrate && (now > t))
+                {
+                    w.integral += static_cast<uint64_t>(last_va_) * (now - t);
+                    w.covered_ms += now - t;
+                }
+            }
+        }
+
+        // les fenêtres terminées comptent pour le jour où elles ont commencé
+        if (day != day_)
+        {
+            for (uint8_t i = 0; i < NB_WINDOWS; ++i)
+            {
+                clear_top(windows_[i].top[DAY]);
+            }
+            day_ = day;
+        }
+        if (month != month_)
+        {
+            for (uint8_t i = 0; i < NB_WINDOWS; ++i)
+            {
+                clear_top(windows_[i].top[MONTH]);
+            }
+            month_ = month;
+        }
+
+        last_sec_ = sec;
+        last_ms_ = ms;
+        last_va_ = va;
+        return closed;
+    }
+
+    // durée de la fenêtre en secondes
+    uint16_t seconds(uint8_t window) const
+    {
+        return windows_[window].seconds;
+    }
+
+    // puissance moyenne depuis le début de la fenêtre en cours
+    uint16_t current(uint8_t window) const
+    {
+        const struct window &w = windows_[window];
+        return (w.covered_ms == 0) ? 0 : w.integral / w.covered_ms;
+    }
+
+    const Peak &last(uint8_t window) const
+    {
+        return windows_[window].last;
+    }
+
+    // TOP plus fortes fenêtres du jour ou du mois, les cases vides ont va = 0
+    const Peak *top(uint8_t window, Scope scope) const
+    {
+        return windows_[window].top[scope];
+    }
+
+    bool is_empty() const
+    {
+        return !started_;
+    }
+};
@@ -0,0 +1,325 @@
+/*
+ * librairie Teleinfo: journal des cumuls horaires en flash
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <flash_hal.h>
+
+// Journal circulaire en ajout seul, sur quelques secteurs de flash réservés.
+//
+// Chaque secteur commence par un en-tête qui porte un numéro de génération:
+// la génération g est toujours écrite dans le secteur (g - 1) % nombre de secteurs,
+// les secteurs sont donc effacés à tour de rôle et s'usent de la même façon.
+// Les enregistrements, de taille fixe et protégés par un CRC, sont écrits
+// les uns après les autres sans effacement préalable. Ils sont mis en attente
+// en RAM et écrits par lots pour limiter les accès à la flash.
+//
+// Au démarrage, la génération la plus récente donne le secteur en cours,
+// et le premier emplacement libre qui suit le dernier enregistrement écrit
+// la position d'écriture. Un enregistrement tronqué par une coupure de courant
+// a un CRC faux: il est ignoré à la relecture et n'est jamais réécrit.
+class FlashLog
+{
+public:
+    // cumul horaire
+    struct Record
+    {
+        uint32_t period; // numéro de l'heure (date / 3600)
+        uint32_t energy; // énergie en Wh
+        uint16_t peak;   // puissance apparente maximale en VA
+        uint16_t crc;
+    };
+
+    enum : uint32_t
+    {
+        MAGIC = 0x474F4C54, // "TLOG"
+        VERSION = 1,
+        BATCH = 6, // enregistrements écrits ensemble
+    };
+
+private:
+    struct Header
+    {
+        uint32_t magic;
+        uint32_t generation;
+        uint16_t version;
+        uint16_t crc;
+    };
+
+    enum : uint32_t
+    {
+        RECORDS_PER_SECTOR = (FLASH_SECTOR_SIZE - sizeof(Header)) / sizeof(Record),
+        READ_CHUNK = 16, // enregistrements lus à la fois au démarrage
+    };
+
+    uint32_t start_;      // adresse physique du premier secteur
+    uint8_t sectors_;     // nombre de secteurs réservés
+    uint8_t sector_;      // secteur en cours d'écriture
+    uint16_t next_;       // prochain emplacement du secteur en cours
+    uint32_t generation_; // génération du secteur en cours, 0 si le journal est vide
+
+    Record pending_[BATCH];
+    uint8_t nb_pending_{0};
+
+    uint32_t erases_{0};
+    uint32_t errors_{0};
+
+    // CRC-16/MODBUS, comme la configuration en EEPROM
+    static uint16_t crc16(const void *data, size_t size)
+    {
+        const uint8_t *p = static_cast<const uint8_t *>(data);
+        uint16_t crc = 0xFFFF;
+        while (size-- != 0)
+        {
+            crc ^= *p++;
+            for (uint8_t i = 0; i < 8; ++i)
+            {
+                crc = (crc & 1) ? (crc >> 1) ^ 0xA001 : (crc >> 1);
+            }
+        }
+        return crc;
+    }
+
+    static bool is_free(const Record &r)
+    {
+        return (r.period == UINT32_MAX) && (r.energy == UINT32_MAX) && (r.peak == UINT16_MAX) && (r.crc == UINT16_MAX);
+    }
+
+    static bool is_valid(const Record &r)
+    {
+        return r.crc == crc16(&r, offsetof(Record, crc));
+    }
+
+    uint32_t sector_addr(uint8_t sector) const
+    {
+        return start_ + sector * FLASH_SECTOR_SIZE;
+    }
+
+    uint32_t record_addr(uint8_t sector, uint16_t i) const
+    {
+        return sector_addr(sector) + sizeof(Header) + i * sizeof(Record);
+    }
+
+    uint8_t sector_of(uint32_t generation) const
+    {
+        return (generation - 1) % sectors_;
+    }
+
+    // génération du secteur, 0 si l'en-tête n'est pas valide
+    uint32_t read_generation(uint8_t sector) const
+    {
+        Header h;
+        if ((flash_hal_read(sector_addr(sector), sizeof(h), reinterpret_cast<uint8_t *>(&h)) != FLASH_HAL_OK) ||
+            (h.magic != MAGIC) || (h.version != VERSION) || (h.generation == 0) ||
+            (h.crc != crc16(&h, offsetof(Header, crc))) || (sector_of(h.generation) != sector))
+        {
+            return 0;
+        }
+        return h.generation;
+    }
+
+    // efface le secteur suivant et y écrit l'en-tête de la nouvelle génération
+    bool open_sector()
+    {
+        uint32_t generation = generation_ + 1;
+        uint8_t sector = sector_of(generation);
+
+        ++erases_;
+        if (flash_hal_erase(sector_addr(sector), FLASH_SECTOR_SIZE) != FLASH_HAL_OK)
+        {
+            ++errors_;
+            return false;
+        }
+
+        Header h;
+        h.magic = MAGIC;
+        h.generation = generation;
+        h.version = VERSION;
+        h.crc = crc16(&h, offsetof(Header, crc));
+
+        // même en cas d'échec, le secteur est entamé: la génération suivante ira ailleurs
+        generation_ = generation;
+        sector_ = sector;
+        next_ = 0;
+
+        if (flash_hal_write(sector_addr(sector), sizeof(h), reinterpret_cast<const uint8_t *>(&h)) != FLASH_HAL_OK)
+        {
+            ++errors_;
+            next_ = RECORDS_PER_SECTOR;
+            return false;
+        }
+        return true;
+    }
+
+    // appelle f pour chaque enregistrement valide du secteur, jusqu'à l'emplacement end
+    // retourne l'emplacement qui suit le dernier enregistrement écrit
+    template <typename F>
+    uint16_t scan(uint8_t sector, uint16_t end, F f) const
+    {
+        Record chunk[READ_CHUNK];
+        uint16_t last = 0;
+
+        for (uint16_t i = 0; i < end; i += READ_CHUNK)
+        {
+            uint16_t n = end - i;
+            if (n > READ_CHUNK)
+            {
+                n = READ_CHUNK;
+            }
+            if (flash_hal_read(record_addr(sector, i), n * sizeof(Record), reinterpret_cast<uint8_t *>(chunk)) != FLASH_HAL_OK)
+            {
+                break;
+            }
+            for (uint16_t j = 0; j < n; ++j)
+            {
+                if (!is_free(chunk[j]))
+                {
+                    last = i + j + 1;
+                    if (is_valid(chunk[j]))
+                    {
+                        f(chunk[j]);
+                    }
+                }
+            }
+        }
+        return last;
+    }
+
+public:
+    static uint32_t records_per_sector()
+    {
+        return RECORDS_PER_SECTOR;
+    }
+
+    // journal sur sectors secteurs à partir de l'adresse physique start, alignée sur un secteur
+    FlashLog(uint32_t start, uint8_t sectors) : start_(start), sectors_(sectors)
+    {
+        sector_ = 0;
+        next_ = RECORDS_PER_SECTOR;
+        generation_ = 0;
+    }
+
+    // retrouve la position d'écriture à partir du contenu de la flash
+    void begin()
+    {
+        nb_pending_ = 0;
+        generation_ = 0;
+        sector_ = 0;
+        next_ = RECORDS_PER_SECTOR;
+
+        for (uint8_t sector = 0; sector < sectors_; ++sector)
+        {
+            uint32_t generation = read_generation(sector);
+            if (generation > generation_)
+            {
+                generation_ = generation;
+                sector_ = sector;
+            }
+        }
+
+        if (generation_ != 0)
+        {
+            next_ = scan(sector_, RECORDS_PER_SECTOR, [](const Record &) {});
+        }
+    }
+
+    // appelle f pour chaque enregistrement en flash, du plus ancien au plus récent
+    template <typename F>
+    size_t replay(F f) const
+    {
+        size_t count = 0;
+        if (generation_ == 0)
+        {
+            return 0;
+        }
+
+        uint32_t first = (generation_ > sectors_) ? generation_ - sectors_ + 1 : 1;
+        for (uint32_t generation = first; generation <= generation_; ++generation)
+        {
+            uint8_t sector = sector_of(generation);
+            if (read_generation(sector) != generation)
+            {
+                continue;
+            }
+
+            uint16_t end = (generation == generation_) ? next_ : static_cast<uint16_t>(RECORDS_PER_SECTOR);
+            scan(sector, end, [&](const Record &r) {
+                ++count;
+                f(r);
+            });
+        }
+        return count;
+    }
+
+    // met un cumul en attente, le lot est écrit quand il est complet
+    void append(uint32_t period, uint32_t energy, uint16_t peak)
+    {
+        Record &r = pending_[nb_pending_++];
+        r.period = period;
+        r.energy = energy;
+        r.peak = peak;
+        r.crc = crc16(&r, offsetof(Record, crc));
+
+        if (nb_pending_ == BATCH)
+        {
+            flush();
+        }
+    }
+
+    // écrit les enregistrements en attente
+    // les enregistrements dont l'écriture a échoué sont perdus
+    bool flush()
+    {
+        uint8_t done = 0;
+        bool ok = true;
+
+        while (done < nb_pending_)
+        {
+            if ((next_ >= RECORDS_PER_SECTOR) && !open_sector())
+            {
+                ok = false;
+                break;
+            }
+
+            uint16_t n = nb_pending_ - done;
+            if (n > RECORDS_PER_SECTOR - next_)
+            {
+                n = RECORDS_PER_SECTOR - next_;
+            }
+
+            if (flash_hal_write(record_addr(sector_, next_), n * sizeof(Record), reinterpret_cast<const uint8_t *>(pending_ + done)) != FLASH_HAL_OK)
+            {
+                ++errors_;
+                ok = false;
+            }
+            next_ += n;
+            done += n;
+        }
+
+        nb_pending_ = 0;
+        return ok;
+    }
+
+    size_t pending() const
+    {
+        return nb_pending_;
+    }
+
+    // nombre d'enregistrements que le journal peut conserver au moins
+    size_t capacity() const
+    {
+        return (sectors_ - 1) * RECORDS_PER_SECTOR;
+    }
+
+    uint32_t erases() const
+    {
+        return erases_;
+    }
+
+    uint32_t errors() const
+    {
+        return errors_;
+    }
+};
@@ -0,0 +1,388 @@
+/*
+ * librairie Teleinfo: historique de la consommation
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+// Historique circulaire de taille fixe: une énergie et une puissance apparente
+// maximale par période. Les deux grandeurs sont rangées dans deux tableaux
+// distincts, parcourus séquentiellement lors de la sérialisation.
+// Les périodes sont numérotées (date / durée): la date d'une case se déduit
+// de sa position, seul le numéro de la dernière période est conservé.
+template <typename E, size_t N>
+class HistoryRing
+{
+    E energy_[N];      // énergie consommée sur la période en Wh
+    uint16_t peak_[N]; // puissance apparente maximale en VA
+    uint16_t head_;    // prochaine case à écrire
+    uint16_t count_;   // nombre de cases remplies
+    uint32_t last_;    // numéro de la période de la dernière case
+
+public:
+    enum : size_t
+    {
+        CAPACITY = N
+    };
+
+    HistoryRing()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        head_ = 0;
+        count_ = 0;
+        last_ = 0;
+    }
+
+    // ajoute la période numérotée, les périodes manquantes sont vides
+    void push(uint32_t period, uint32_t energy, uint16_t peak)
+    {
+        if ((count_ != 0) && (period <= last_))
+        {
+            return;
+        }
+
+        if (count_ != 0)
+        {
+            uint32_t gap = period - last_ - 1;
+            if (gap >= N)
+            {
+                // rien à garder
+                clear();
+            }
+            else
+            {
+                while (gap-- != 0)
+                {
+                    append(0, 0);
+                }
+            }
+        }
+
+        append((energy > static_cast<E>(-1)) ? static_cast<E>(-1) : energy, peak);
+        last_ = period;
+    }
+
+    size_t size() const
+    {
+        return count_;
+    }
+
+    // numéro de la période de la dernière case
+    uint32_t last_period() const
+    {
+        return last_;
+    }
+
+    // numéro de la période de la plus ancienne case
+    uint32_t first_period() const
+    {
+        return last_ - (count_ - 1);
+    }
+
+    // i-ème case à partir de la plus ancienne
+    uint32_t energy(size_t i) const
+    {
+        return energy_[index(i)];
+    }
+
+    uint32_t peak(size_t i) const
+    {
+        return peak_[index(i)];
+    }
+
+private:
+    size_t index(size_t i) const
+    {
+        return (head_ + N - count_ + i) % N;
+    }
+
+    void append(E energy, uint16_t peak)
+    {
+        energy_[head_] = energy;
+        peak_[head_] = peak;
+        head_ = (head_ + 1) % N;
+        if (count_ < N)
+        {
+            ++count_;
+        }
+    }
+};
+
+// Historique de la consommation alimenté à chaque trame: énergie et puissance
+// apparente maximale par minute sur un jour, par heure sur une semaine et par
+// jour sur un an. Les périodes sont alignées sur les dates UTC.
+//
+// Chaque résolution a une période en cours, qui est versée dans l'historique
+// de même résolution et cumulée dans la période en cours de la résolution
+// suivante quand elle se termine: l'ajout d'une mesure est en O(1).
+//
+// Les heures terminées peuvent être sauvegardées ailleurs, et rechargées au
+// démarrage avec restore(): elles reconstituent aussi l'historique par jour.
+class EnergyHistory
+{
+public:
+    // les mesures datées d'avant 2020 sont faites avant la mise à l'heure
+    static const uint32_t MIN_TIME = 1577836800;
+
+    // recul de l'horloge toléré (correction NTP): les mesures restent dans la période en cours
+    static const uint32_t MAX_BACKWARD = 3600;
+
+    enum Resolution : uint8_t
+    {
+        MINUTE,
+        HOUR,
+        DAY,
+        NB_RESOLUTIONS
+    };
+
+    // période en cours
+    struct Current
+    {
+        uint32_t period; // numéro de la période (date / durée)
+        uint32_t energy; // énergie en Wh
+        uint16_t peak;   // puissance apparente maximale en VA
+    };
+
+    typedef HistoryRing<uint16_t, 24 * 60> Minutes; // au plus 65 kWh par minute
+    typedef HistoryRing<uint32_t, 7 * 24> Hours;
+    typedef HistoryRing<uint32_t, 366> Days;
+
+private:
+    Minutes minutes_;
+    Hours hours_;
+    Days days_;
+    Current current_[NB_RESOLUTIONS];
+
+    Current closed_hour_; // dernière heure terminée
+
+    bool started_{false};
+    bool restored_{false}; // le jour en cours contient des heures rechargées
+    uint32_t last_time_{0};
+    uint32_t last_energy_{0};
+
+    void start(uint32_t time)
+    {
+        bool keep_day = false;
+
+        if (restored_)
+        {
+            // les heures rechargées du jour en cours y restent
+            restored_ = false;
+            uint32_t day = time / duration(DAY);
+            if (day > current_[DAY].period)
+            {
+                push(days_, current_[DAY], day);
+            }
+            else
+            {
+                keep_day = (day == current_[DAY].period);
+            }
+        }
+
+        for (uint8_t res = 0; res < NB_RESOLUTIONS; ++res)
+        {
+            if ((res == DAY) && keep_day)
+            {
+                continue;
+            }
+            current_[res].period = time / duration(static_cast<Resolution>(res));
+            current_[res].energy = 0;
+            current_[res].peak = 0;
+        }
+    }
+
+    // l'historique se termine toujours juste avant la nouvelle période en cours,
+    // quitte à y ajouter des périodes vides
+    template <typename Ring>
+    static void push(Ring &ring, const Current &c, uint32_t period)
+    {
+        ring.push(c.period, c.energy, c.peak);
+        if (period - 1 > c.period)
+        {
+            ring.push(period - 1, 0, 0);
+        }
+    }
+
+    // verse la période en cours dans l'historique et dans la résolution suivante
+    void close(Resolution res, uint32_t period)
+    {
+        Current &c = current_[res];
+
+        switch (res)
+        {
+        case MINUTE:
+            push(minutes_, c, period);
+            break;
+        case HOUR:
+            push(hours_, c, period);
+            closed_hour_ = c;
+            break;
+        default:
+            push(days_, c, period);
+            break;
+        }
+
+        if (res + 1 < NB_RESOLUTIONS)
+        {
+            Current &next = current_[res + 1];
+            next.energy += c.energy;
+            if (c.peak > next.peak)
+            {
+                next.peak = c.peak;
+            }
+        }
+
+        c.period = period;
+        c.energy = 0;
+        c.peak = 0;
+    }
+
+public:
+    static uint32_t duration(Resolution res)
+    {
+        return (res == MINUTE) ? 60 : (res == HOUR) ? 3600 : 86400;
+    }
+
+    void clear()
+    {
+        minutes_.clear();
+        hours_.clear();
+        days_.clear();
+        started_ = false;
+        restored_ = false;
+    }
+
+    // recharge une heure terminée, avant la première mesure
+    void restore(uint32_t period, uint32_t energy, uint16_t peak)
+    {
+        if (started_ || (period * duration(HOUR) < MIN_TIME) || ((hours_.size() != 0) && (period <= hours_.last_period())))
+        {
+            return;
+        }
+
+        hours_.push(period, energy, peak);
+
+        Current &day = current_[DAY];
+        uint32_t period_day = period / 24;
+        if (!restored_ || (period_day != day.period))
+        {
+            if (restored_)
+            {
+                push(days_, day, period_day);
+            }
+            restored_ = true;
+            day.period = period_day;
+            day.energy = 0;
+            day.peak = 0;
+        }
+        day.energy += energy;
+        if (peak > day.peak)
+        {
+            day.peak = peak;
+        }
+    }
+
+    // ajoute une mesure: date en secondes, index d'énergie en Wh et puissance apparente en VA
+    // retourne true si une heure vient de se terminer
+    bool add(uint32_t time, uint32_t energy, uint16_t papp)
+    {
+        if (time < MIN_TIME)
+        {
+            // l'horloge n'est pas encore à l'heure
+            return false;
+        }
+
+        if (started_ && ((time + MAX_BACKWARD < last_time_) || ((time > last_time_) && (time - last_time_ > 366 * 86400u))))
+        {
+            // l'horloge a beaucoup reculé ou vient d'être mise à l'heure: l'historique
+            // ne correspond plus à rien
+            clear();
+        }
+
+        if (started_ && (time < last_time_))
+        {
+            // petite correction de l'horloge: la mesure est datée de la précédente
+            time = last_time_;
+        }
+
+        if (!started_)
+        {
+            started_ = true;
+            start(time);
+        }
+        else if (energy >= last_energy_)
+        {
+            // l'énergie consommée depuis la dernière mesure l'a été dans la période en cours
+            current_[MINUTE].energy += energy - last_energy_;
+        }
+
+        last_time_ = time;
+        last_energy_ = energy;
+
+        // termine les périodes révolues, de la plus fine à la plus large
+        uint8_t res = 0;
+        for (; res < NB_RESOLUTIONS; ++res)
+        {
+            uint32_t period = time / duration(static_cast<Resolution>(res));
+            if (period == current_[res].period)
+            {
+                break;
+            }
+            close(static_cast<Resolution>(res), period);
+        }
+
+        Current &minute = current_[MINUTE];
+        if (papp > minute.peak)
+        {
+            minute.peak = papp;
+        }
+
+        return res > HOUR;
+    }
+
+    // dernière heure terminée, valide quand add() a retourné true
+    const Current &closed_hour() const
+    {
+        return closed_hour_;
+    }
+
+    bool is_empty() const
+    {
+        return !started_;
+    }
+
+    const Minutes &minutes() const
+    {
+        return minutes_;
+    }
+
+    const Hours &hours() const
+    {
+        return hours_;
+    }
+
+    const Days &days() const
+    {
+        return days_;
+    }
+
+    // période en cours, y compris les périodes en cours plus fines pas encore versées
+    Current current(Resolution res) const
+    {
+        Current c = current_[res];
+        for (uint8_t r = 0; r < res; ++r)
+        {
+            c.energy += current_[r].energy;
+            if (current_[r].peak > c.peak)
+            {
+                c.peak = current_[r].peak;
+            }
+        }
+        return c;
+    }
+};
@@ -5,17 +5,19 @@
 
 #include <Arduino.h>
 
-class JSONBuilder
+// Output: String, ou ChunkedOutput pour envoyer au fur et à mesure
+template <typename Output>
+class BasicJSONBuilder
 {
-    String &s;
+    Output &s;
 
 public:
-    explicit JSONBuilder(String &r) : s(r)
+    explicit BasicJSONBuilder(Output &r) : s(r)
     {
         s.concat("{\"");
     }
 
-    explicit JSONBuilder(String &r, size_t reserve_size) : s(r)
+    explicit BasicJSONBuilder(Output &r, size_t reserve_size) : s(r)
     {
         if (reserve_size != 0)
             s.reserve(reserve_size);
@@ -84,17 +86,18 @@ public:
     }
 };
 
-class JSONTableBuilder
+template <typename Output>
+class BasicJSONTableBuilder
 {
-    String &s;
+    Output &s;
 
 public:
-    explicit JSONTableBuilder(String &r) : s(r)
+    explicit BasicJSONTableBuilder(Output &r) : s(r)
     {
         s.concat("[");
     }
 
-    explicit JSONTableBuilder(String &r, size_t reserve_size) : s(r)
+    explicit BasicJSONTableBuilder(Output &r, size_t reserve_size) : s(r)
     {
         if (reserve_size != 0)
             s.reserve(reserve_size);
@@ -138,3 +141,6 @@ public:
             last = ']';
     }
 };
+
+typedef BasicJSONBuilder<String> JSONBuilder;
+typedef BasicJSONTableBuilder<String> JSONTableBuilder;
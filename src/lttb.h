@@ -0,0 +1,110 @@
+/*
+ * librairie Teleinfo: sous-échantillonnage des séries temporelles
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include "timeseries.h"
+
+// Largest-Triangle-Three-Buckets (S. Steinarsson, 2013): réduit une série à
+// points trames qui gardent son allure à l'affichage.
+//
+// La première et la dernière trame sont gardées, les autres sont réparties en
+// points - 2 paquets consécutifs. Dans chaque paquet, la trame retenue est celle
+// qui forme le plus grand triangle avec la trame retenue dans le paquet précédent
+// et le point moyen du paquet suivant. La grandeur values[value] sert au choix,
+// les trames sont transmises entières à f.
+//
+// Deux curseurs parcourent la série décompressée une seule fois chacun: l'un
+// calcule le point moyen du paquet suivant, l'autre choisit la trame du paquet
+// en cours. La mémoire utilisée ne dépend ni de la taille de la série
+// ni du nombre de points.
+//
+// Retourne le nombre de trames transmises: min(points, size()), au moins 3.
+template <typename Series, typename F>
+size_t lttb(const Series &series, size_t points, uint8_t value, F f)
+{
+    size_t n = series.size();
+    if (points < 3)
+    {
+        points = 3;
+    }
+    if (n <= points)
+    {
+        return series.for_each(f);
+    }
+
+    typename Series::Cursor cursor(series); // trames du paquet en cours
+    typename Series::Cursor ahead(series);  // trames du paquet suivant
+    TimeSample s;
+    TimeSample a; // dernière trame retenue
+
+    // dates en ms depuis la première trame
+    cursor.next(a);
+    ahead.next(s);
+    const uint32_t t0 = a.sec;
+    auto date = [t0](const TimeSample &s) -> int64_t { return (static_cast<int64_t>(s.sec) - t0) * 1000 + s.ms; };
+
+    f(a);
+    size_t sent = 1;
+
+    // paquet b: trames [start(b), start(b + 1)[ hors première et dernière trame
+    const size_t buckets = points - 2;
+    auto start = [n, buckets](size_t b) -> size_t { return 1 + b * (n - 2) / buckets; };
+
+    size_t ahead_index = 1; // index de la prochaine trame de ahead
+    size_t index = 1;       // index de la prochaine trame de cursor
+
+    for (size_t b = 0; b < buckets; ++b)
+    {
+        // point moyen du paquet suivant, ou dernière trame
+        int64_t ct = 0;
+        int64_t cv = 0;
+        size_t end = (b + 1 < buckets) ? start(b + 2) : n;
+        size_t from = start(b + 1);
+        size_t count = end - from;
+        while (ahead_index < end)
+        {
+            ahead.next(s);
+            if (ahead_index >= from)
+            {
+                ct += date(s);
+                cv += s.values[value];
+            }
+            ++ahead_index;
+        }
+        ct /= static_cast<int64_t>(count);
+        cv /= static_cast<int64_t>(count);
+
+        // trame du paquet qui forme le plus grand triangle
+        const int64_t at = date(a);
+        const int64_t av = a.values[value];
+        int64_t best_area = -1;
+        TimeSample best = a;
+        for (; index < start(b + 1); ++index)
+        {
+            cursor.next(s);
+            int64_t area = (at - ct) * (static_cast<int64_t>(s.values[value]) - av) - (at - date(s)) * (cv - av);
+            if (area < 0)
+            {
+                area = -area;
+            }
+            if (area > best_area)
+            {
+                best_area = area;
+                best = s;
+            }
+        }
+
+        f(best);
+        ++sent;
+        a = best;
+    }
+
+    // dernière trame
+    while (cursor.next(s))
+    {
+    }
+    f(s);
+    return sent + 1;
+}
@@ -26,10 +26,9 @@ void setup()
 #ifdef ENABLE_DEBUG
     // en debug, on reste à 115200: on ne se branche pas au compteur
     Serial.begin(115200);
-#else
-    // sinon, RX est utilisé pour la téléinfo. TX est coupé
-    Serial.begin(1200, SERIAL_7E1, SERIAL_RX_ONLY);
 #endif
+    // sinon, RX est utilisé pour la téléinfo et TX est coupé: la liaison est ouverte
+    // une fois la vitesse connue, après le chargement de la configuration
     Serial.flush();
 
     Serial.println(R"(
@@ -43,6 +42,14 @@ __      ___  __ ___       __
     // chargement de la conf depuis l'EEPROM
     config_setup();
 
+    // mode de la téléinformation, éventuellement détecté automatiquement
+    tic_setup();
+
+#ifndef ENABLE_DEBUG
+    // la vitesse dépend du mode de téléinformation (historique ou standard)
+    Serial.begin(tic_baudrate(), SERIAL_7E1, SERIAL_RX_ONLY);
+#endif
+
     // connexion au Wi-Fi ou activation de l'AP
     sys_wifi_connect();
 
@@ -101,10 +108,21 @@ void loop()
         tic_decode(c);
     }
 #else
-    if (Serial.available())
+    // vide le buffer de réception en une seule fois
+    uint8_t buf[64];
+    size_t n;
+    while ((n = Serial.available()) != 0)
     {
-        int c = Serial.read();
-        tic_decode(c);
+        n = Serial.readBytes(buf, std::min(n, sizeof(buf)));
+        tic_decode_buffer(buf, n);
+    }
+
+    // la détection automatique du mode peut demander un changement de vitesse
+    static uint32_t baudrate = tic_baudrate();
+    if (baudrate != tic_baudrate())
+    {
+        baudrate = tic_baudrate();
+        Serial.updateBaudRate(baudrate);
     }
 #endif
 }
@@ -0,0 +1,309 @@
+/*
+ * librairie Teleinfo: estimation de la puissance
+ * Copyright (c) 2014-2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <initializer_list>
+
+// Estime la puissance active en watt en dérivant l'index d'énergie (Wh)
+// sur plusieurs fenêtres glissantes, qui partagent le même historique.
+//
+// L'historique ne contient que les écarts entre deux mesures successives.
+// Chaque fenêtre tient à jour la somme des durées et des énergies des écarts
+// qu'elle couvre: l'ajout d'une mesure est en O(1) amorti, et le calcul de
+// la puissance en O(1).
+//
+// La puissance est la pente de la droite des moindres carrés qui passe par
+// les mesures de la fenêtre: avec un index résolu au Wh, elle varie beaucoup
+// moins que la pente entre la première et la dernière mesure. Les sommes de
+// la régression sont entières (64 bits) et relatives à la plus ancienne mesure
+// de la fenêtre: elles sont recalées sur la suivante quand celle-ci sort.
+// Il faut 60 s pour voir 60 W: l'index monte de 1 Wh, sa résolution.
+class PowerEstimator
+{
+public:
+    static const size_t MAX_WINDOWS = 4;
+    static const size_t CAPACITY = 256; // 300 s avec une trame toutes les 1.2 s
+
+private:
+    // écart entre deux mesures
+    struct delta
+    {
+        uint16_t ms; // durée en millisecondes
+        uint16_t wh; // énergie en Wh
+    };
+
+    struct window
+    {
+        uint32_t length_ms; // durée maximale couverte
+        uint16_t first;     // plus ancien écart de la fenêtre
+        uint16_t count;     // nombre d'écarts dans la fenêtre
+        uint32_t sum_ms;    // durée couverte
+        uint32_t sum_wh;    // énergie sur la durée couverte
+
+        // sommes de la régression sur les count + 1 mesures de la fenêtre,
+        // x en ms et y en Wh depuis la plus ancienne mesure
+        int64_t sx;
+        int64_t sy;
+        int64_t sxx;
+        int64_t sxy;
+        int64_t syy;
+    };
+
+    delta deltas_[CAPACITY];
+    uint16_t head_{0}; // prochain écart à écrire
+    window windows_[MAX_WINDOWS];
+    uint8_t nb_windows_{0};
+
+    bool has_last_{false};
+    uint32_t last_ms_{0};
+    uint32_t last_wh_{0};
+
+    void remove_oldest(window &w)
+    {
+        const delta &d = deltas_[w.first];
+        w.sum_ms -= d.ms;
+        w.sum_wh -= d.wh;
+        w.first = (w.first + 1) % CAPACITY;
+        --w.count;
+
+        // la mesure qui sort est l'origine (0, 0): elle ne contribue pas aux sommes,
+        // il reste à y décaler l'origine sur la mesure suivante
+        int64_t n = w.count + 1;
+        int64_t a = d.ms;
+        int64_t b = d.wh;
+        w.sxx += n * a * a - 2 * a * w.sx;
+        w.syy += n * b * b - 2 * b * w.sy;
+        w.sxy += n * a * b - b * w.sx - a * w.sy;
+        w.sx -= n * a;
+        w.sy -= n * b;
+    }
+
+    static uint8_t bits(uint64_t v)
+    {
+        return (v == 0) ? 0 : 64 - __builtin_clzll(v);
+    }
+
+    // covariance et variances (multipliées par n²) de la fenêtre
+    static void moments(const window &w, int64_t &cov, int64_t &var_x, int64_t &var_y)
+    {
+        int64_t n = w.count + 1;
+        cov = n * w.sxy - w.sx * w.sy;
+        var_x = n * w.sxx - w.sx * w.sx;
+        var_y = n * w.syy - w.sy * w.sy;
+    }
+
+    const window *find(uint32_t seconds) const
+    {
+        // la fenêtre demandée, ou à défaut la plus proche
+        const window *best = nullptr;
+        uint32_t best_gap = UINT32_MAX;
+        uint32_t length_ms = seconds * 1000;
+
+        for (uint8_t i = 0; i < nb_windows_; ++i)
+        {
+            const window &w = windows_[i];
+            uint32_t gap = (w.length_ms > length_ms) ? w.length_ms - length_ms : length_ms - w.length_ms;
+            if (gap < best_gap)
+            {
+                best = &w;
+                best_gap = gap;
+            }
+        }
+        return best;
+    }
+
+public:
+    // durées des fenêtres en secondes
+    PowerEstimator(std::initializer_list<uint16_t> windows)
+    {
+        for (auto seconds : windows)
+        {
+            if (nb_windows_ < MAX_WINDOWS)
+            {
+                windows_[nb_windows_++].length_ms = seconds * 1000u;
+            }
+        }
+        clear();
+    }
+
+    void clear()
+    {
+        head_ = 0;
+        has_last_ = false;
+        for (uint8_t i = 0; i < nb_windows_; ++i)
+        {
+            window &w = windows_[i];
+            w.first = 0;
+            w.count = 0;
+            w.sum_ms = 0;
+            w.sum_wh = 0;
+            w.sx = 0;
+            w.sy = 0;
+            w.sxx = 0;
+            w.sxy = 0;
+            w.syy = 0;
+        }
+    }
+
+    // ajoute une mesure de l'index d'énergie, datée en millisecondes
+    void add(uint32_t date_ms, uint32_t wh)
+    {
+        uint32_t ms = date_ms - last_ms_;
+        uint32_t dwh = wh - last_wh_;
+
+        if (has_last_ && (ms == 0))
+        {
+            // même instant: rien à dériver
+            return;
+        }
+
+        if (!has_last_ || (wh < last_wh_) || (ms > UINT16_MAX) || (dwh > UINT16_MAX))
+        {
+            // première mesure, changement d'index, saut d'horloge ou longue
+            // interruption de la téléinformation: on repart de zéro
+            clear();
+            has_last_ = true;
+            last_ms_ = date_ms;
+            last_wh_ = wh;
+            return;
+        }
+
+        last_ms_ = date_ms;
+        last_wh_ = wh;
+
+        for (uint8_t i = 0; i < nb_windows_; ++i)
+        {
+            window &w = windows_[i];
+
+            // l'écart le plus ancien va être écrasé
+            if (w.count == CAPACITY)
+            {
+                remove_oldest(w);
+            }
+        }
+
+        delta &d = deltas_[head_];
+        d.ms = ms;
+        d.wh = dwh;
+
+        for (uint8_t i = 0; i < nb_windows_; ++i)
+        {
+            window &w = windows_[i];
+
+            if (w.count == 0)
+            {
+                w.first = head_;
+            }
+            w.sum_ms += d.ms;
+            w.sum_wh += d.wh;
+            ++w.count;
+
+            int64_t x = w.sum_ms;
+            int64_t y = w.sum_wh;
+            w.sx += x;
+            w.sy += y;
+            w.sxx += x * x;
+            w.sxy += x * y;
+            w.syy += y * y;
+
+            // garde uniquement les écarts qui tiennent dans la fenêtre
+            while (w.sum_ms > w.length_ms)
+            {
+                remove_oldest(w);
+            }
+        }
+
+        head_ = (head_ + 1) % CAPACITY;
+    }
+
+    // puissance en watt sur la fenêtre de la durée donnée en secondes
+    // (ou la plus proche), 0 si la fenêtre ne contient pas encore d'écart
+    uint32_t watt(uint32_t seconds) const
+    {
+        const window *w = find(seconds);
+        if ((w == nullptr) || (w->sum_ms == 0))
+        {
+            return 0;
+        }
+
+        int64_t cov, var_x, var_y;
+        moments(*w, cov, var_x, var_y);
+        if ((cov <= 0) || (var_x <= 0))
+        {
+            return 0;
+        }
+
+        // pente en Wh/ms convertie en W, sans déborder de 64 bits
+        if (cov <= INT64_MAX / 3600000)
+        {
+            return cov * 3600000 / var_x;
+        }
+        return cov * 3600 / (var_x / 1000);
+    }
+
+    // puissance moyenne entre la première et la dernière mesure de la fenêtre
+    uint32_t watt_endpoints(uint32_t seconds) const
+    {
+        const window *w = find(seconds);
+        if ((w == nullptr) || (w->sum_ms == 0))
+        {
+            return 0;
+        }
+        return (3600000ull * w->sum_wh) / w->sum_ms;
+    }
+
+    // qualité de l'estimation: coefficient de détermination r² en pour mille
+    // 1000 quand les mesures sont alignées, 0 si la fenêtre a moins de 3 mesures
+    // ou si l'index n'a pas bougé
+    uint16_t quality(uint32_t seconds) const
+    {
+        const window *w = find(seconds);
+        if ((w == nullptr) || (w->count < 2))
+        {
+            return 0;
+        }
+
+        int64_t cov, var_x, var_y;
+        moments(*w, cov, var_x, var_y);
+        if ((cov <= 0) || (var_x <= 0) || (var_y <= 0))
+        {
+            return 0;
+        }
+
+        // r² = cov² / (var_x var_y): ramène les variances sur 26 bits et la
+        // covariance d'autant, puisque cov² <= var_x var_y: cov² * 1000 tient sur 64 bits
+        uint64_t a = cov;
+        uint64_t b = var_x;
+        uint64_t c = var_y;
+        uint8_t sb = (bits(b) > 26) ? bits(b) - 26 : 0;
+        uint8_t sc = (bits(c) > 26) ? bits(c) - 26 : 0;
+        if ((sb + sc) % 2 != 0)
+        {
+            ++sb;
+        }
+        a >>= (sb + sc) / 2;
+        b >>= sb;
+        c >>= sc;
+
+        uint64_t bc = b * c;
+        if (bc == 0)
+        {
+            return 0;
+        }
+
+        // arrondi au plus proche: la troncature des décalages ne doit pas
+        // empêcher un alignement parfait d'atteindre 1000
+        uint64_t r2 = (a * a * 1000 + bc / 2) / bc;
+        return (r2 > 1000) ? 1000 : r2;
+    }
+
+    // durée effectivement couverte par la fenêtre, en millisecondes
+    uint32_t span_ms(uint32_t seconds) const
+    {
+        const window *w = find(seconds);
+        return (w == nullptr) ? 0 : w->sum_ms;
+    }
+};
@@ -8,41 +8,376 @@
 #include "webserver.h"
 
 #include <ESP8266WebServer.h>
-#include <list>
+#include <algorithm>
 #include <user_interface.h>
 
+// nombre maximal de clients SSE simultanés
+#ifndef SSE_MAX_CLIENTS
+#define SSE_MAX_CLIENTS 4
+#endif
+
+// derniers événements gardés pour les clients qui se reconnectent
+#ifndef SSE_REPLAY_EVENTS
+#define SSE_REPLAY_EVENTS 8
+#endif
+
+// secondes pendant lesquelles l'historique est encore tenu après le départ du dernier client
+#ifndef SSE_REPLAY_DELAY
+#define SSE_REPLAY_DELAY 30
+#endif
+
+// une trame est envoyée au moins toutes les SSE_KEEPALIVE secondes, même inchangée
+#ifndef SSE_KEEPALIVE
+#define SSE_KEEPALIVE 30
+#endif
+
+// longueur maximale de la liste d'étiquettes d'un client (?labels=PAPP,IINST)
+#define SSE_LABELS_LENGTH 48
+
+// en mode delta, une trame complète toutes les SSE_KEYFRAME_INTERVAL trames
+#ifndef SSE_KEYFRAME_INTERVAL
+#define SSE_KEYFRAME_INTERVAL 60
+#endif
+
+// rend la trame réduite aux étiquettes de labels, séparées par des virgules
+typedef void (*SseProjection)(String &data, const char *labels);
+
+// Événement formaté une seule fois et envoyé tel quel par tous les clients:
+// chacun garde une référence jusqu'à ce qu'il l'ait entièrement écrit.
+class SseEvent
+{
+    uint32_t id_; // numéro de l'événement, 0 pour les en-têtes
+    String name_; // vide pour "message"
+    String text_; // événement formaté
+    uint8_t refs_;
+
+public:
+    SseEvent(uint32_t id, const char *name, const String &data) : id_(id), name_(name), refs_(0)
+    {
+        text_.reserve(data.length() + name_.length() + 32);
+        text_ += "id: ";
+        text_ += id_;
+        text_ += "\r\n";
+        if (name_.length() != 0)
+        {
+            text_ += "event: ";
+            text_ += name_;
+            text_ += "\r\n";
+        }
+        text_ += "data: ";
+        text_ += data;
+        text_ += "\r\n\r\n";
+    }
+
+    // texte déjà formaté
+    explicit SseEvent(const String &text) : id_(0), text_(text), refs_(0)
+    {
+    }
+
+    uint32_t id() const
+    {
+        return id_;
+    }
+
+    const String &name() const
+    {
+        return name_;
+    }
+
+    const String &text() const
+    {
+        return text_;
+    }
+
+    void ref()
+    {
+        ++refs_;
+    }
+
+    // libère l'événement quand plus personne ne l'utilise
+    void unref()
+    {
+        if (--refs_ == 0)
+        {
+            delete this;
+        }
+    }
+};
+
+// Derniers événements envoyés, du plus ancien au plus récent: un client qui
+// se reconnecte avec l'en-tête Last-Event-ID reçoit ceux qu'il a manqués.
+class SseHistory
+{
+    SseEvent *events_[SSE_REPLAY_EVENTS];
+    uint8_t head_;  // plus ancien événement
+    uint8_t count_; // nombre d'événements gardés
+
+public:
+    SseHistory() : head_(0), count_(0)
+    {
+    }
+
+    ~SseHistory()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (uint8_t i = 0; i < count_; ++i)
+        {
+            events_[(head_ + i) % SSE_REPLAY_EVENTS]->unref();
+        }
+        head_ = 0;
+        count_ = 0;
+    }
+
+    void add(SseEvent *event)
+    {
+        event->ref();
+        if (count_ == SSE_REPLAY_EVENTS)
+        {
+            events_[head_]->unref();
+            head_ = (head_ + 1) % SSE_REPLAY_EVENTS;
+            --count_;
+        }
+        events_[(head_ + count_) % SSE_REPLAY_EVENTS] = event;
+        ++count_;
+    }
+
+    // le plus ancien événement gardé qui suit id, nullptr s'il n'y en a pas
+    SseEvent *after(uint32_t id) const
+    {
+        for (uint8_t i = 0; i < count_; ++i)
+        {
+            SseEvent *e = events_[(head_ + i) % SSE_REPLAY_EVENTS];
+            if (e->id() > id)
+            {
+                return e;
+            }
+        }
+        return nullptr;
+    }
+};
+
+// Les événements ne sont jamais envoyés en bloquant: chaque client n'écrit que
+// ce que sa socket accepte (availableForWrite), le reste part aux appels suivants
+// de handle_clients(). En attendant, un événement plus récent de même nom remplace
+// celui en attente, et la file pleine perd son plus ancien événement: un client
+// lent reçoit moins de trames mais ne ralentit pas la téléinformation.
+//
+// Un client n'a que sa socket, le curseur dans l'événement en cours d'envoi
+// et des références vers les événements en attente.
+//
+// Après une reconnexion, les événements manqués sont repris de l'historique
+// un par un, avant ceux de la file qui n'ont pas déjà été envoyés.
+//
+// Un client peut ne demander que certaines étiquettes, et un intervalle minimal
+// entre deux trames. L'historique ne contient que des trames entières: il n'y a
+// pas de reprise pour un tel client.
+//
+// En mode delta (?delta=1), le client reçoit une trame complète puis des événements
+// "delta" avec les seules étiquettes modifiées. Il faut qu'il ait reçu toutes les
+// trames depuis la dernière complète: après une trame perdue, remplacée ou sautée
+// (min_interval), ou tant qu'une trame est en attente, il en reçoit une complète.
 class SseClient
 {
+public:
+    enum : uint8_t
+    {
+        QUEUE_SIZE = 2, // événements en attente, en plus de celui en cours d'envoi
+    };
+
+private:
     WiFiClient client_;
+    SseEvent *sending_; // événement en cours d'envoi
+    size_t sent_;       // octets de sending_ déjà écrits
+    SseEvent *queue_[QUEUE_SIZE];
+    uint8_t head_;     // plus ancien événement en attente
+    uint8_t queued_;   // nombre d'événements en attente
+    bool open_;        // emplacement utilisé
+    bool delta_;       // mode delta demandé
+    uint32_t dropped_; // événements remplacés ou perdus
+    uint32_t last_id_; // dernier événement commencé
+    const SseHistory *replay_; // historique à reprendre, nullptr une fois à jour
+    char labels_[SSE_LABELS_LENGTH]; // étiquettes demandées, vide pour toutes
+    uint16_t min_interval_;          // secondes entre deux trames
+    bool frame_sent_;                // last_frame_ est valide
+    bool resync_;                    // une trame complète est nécessaire en mode delta
+    uint32_t last_frame_;            // millis() de la dernière trame
 
-public:
-    explicit SseClient(ESP8266WebServer &server)
+    // trame complète ou différences
+    static bool is_frame(const SseEvent *e)
     {
-        // récupère le _currentClient : comme l'application est monothreadée
-        // c'est forcément celui qui déclenché la callback on()
-        client_ = server.client();
+        return (e->name().length() == 0) || (e->name() == "delta");
+    }
 
-        if (client_)
+    // événement suivant: d'abord l'historique, puis la file
+    SseEvent *next()
+    {
+        if (replay_ != nullptr)
         {
-            Serial.printf_P(PSTR("new client %p\n"), this);
+            SseEvent *e = replay_->after(last_id_);
+            if (e != nullptr)
+            {
+                e->ref();
+                return e;
+            }
+            replay_ = nullptr;
+        }
 
-            client_.println(F("HTTP/1.1 200 OK"));
-            client_.println(F("Content-Type: text/event-stream;charset=UTF-8"));
-            client_.println(F("Connection: close"));              // the connection will be closed after completion of the response
-            client_.println(F("Access-Control-Allow-Origin: *")); // allow any connection. We don't want Arduino to host all of the website ;-)
-            client_.println(F("Cache-Control: no-cache"));        // refresh the page automatically every 5 sec
-            client_.println();
-            client_.flush();
+        while (queued_ != 0)
+        {
+            SseEvent *e = queue_[head_];
+            head_ = (head_ + 1) % QUEUE_SIZE;
+            --queued_;
+            if (e->id() > last_id_)
+            {
+                return e;
+            }
+            e->unref(); // déjà repris de l'historique
         }
+        return nullptr;
+    }
+
+public:
+    SseClient()
+        : sending_(nullptr), sent_(0), head_(0), queued_(0), open_(false), delta_(false), dropped_(0), last_id_(0),
+          replay_(nullptr), min_interval_(0), frame_sent_(false), resync_(true), last_frame_(0)
+    {
+        labels_[0] = 0;
+    }
+
+    ~SseClient()
+    {
+        close();
+    }
+
+    // prend la connexion et lui envoie les en-têtes de la réponse, puis
+    // les événements de history qui suivent last_id si history n'est pas nul:
+    // l'abonnement, s'il y en a un, est fait avant pour que la reprise en tienne compte
+    void open(const WiFiClient &client, SseEvent *headers, const SseHistory *history = nullptr, uint32_t last_id = 0)
+    {
+        client_ = client;
+        open_ = true;
+        dropped_ = 0;
+        last_id_ = last_id;
+        replay_ = (labels_[0] == 0) ? history : nullptr;
+        frame_sent_ = false;
+        resync_ = true;
+
+        Serial.printf_P(PSTR("new client %p\n"), this);
+
+        headers->ref();
+        sending_ = headers;
+        sent_ = 0;
+        pump();
     }
 
-    virtual ~SseClient()
+    void close()
     {
+        if (!open_)
+        {
+            return;
+        }
+
+        drop_events();
+
         // give the web browser time to receive the data
         delay(1);
         // close the connection:
         client_.stop();
+        client_ = WiFiClient();
         Serial.printf_P(PSTR("client %p disconnected\n"), this);
+
+        labels_[0] = 0;
+        min_interval_ = 0;
+        delta_ = false;
+        open_ = false;
+    }
+
+    // abandonne l'événement en cours d'envoi et ceux en attente
+    void drop_events()
+    {
+        if (sending_ != nullptr)
+        {
+            sending_->unref();
+            sending_ = nullptr;
+        }
+        while (queued_ != 0)
+        {
+            queue_[head_]->unref();
+            head_ = (head_ + 1) % QUEUE_SIZE;
+            --queued_;
+        }
+        replay_ = nullptr;
+    }
+
+    bool is_open() const
+    {
+        return open_;
+    }
+
+    // abonnement, avant open(): étiquettes (en majuscules, sans espaces), intervalle minimal
+    // en secondes et mode delta, sans effet avec des étiquettes: la projection est déjà réduite
+    void subscribe(const char *labels, uint16_t min_interval, bool delta = false)
+    {
+        size_t n = 0;
+        for (; (*labels != 0) && (n < SSE_LABELS_LENGTH - 1); ++labels)
+        {
+            if (*labels != ' ')
+            {
+                labels_[n++] = toupper(*labels);
+            }
+        }
+        labels_[n] = 0;
+        min_interval_ = min_interval;
+        delta_ = delta && (labels_[0] == 0);
+    }
+
+    bool delta() const
+    {
+        return delta_;
+    }
+
+    // les différences suffisent: le client a ou aura toutes les trames précédentes
+    bool delta_ok() const
+    {
+        if (!delta_ || resync_)
+        {
+            return false;
+        }
+        for (uint8_t i = 0; i < queued_; ++i)
+        {
+            if (is_frame(queue_[(head_ + i) % QUEUE_SIZE]))
+            {
+                return false;
+            }
+        }
+        return true;
+    }
+
+    // trame non envoyée à cause de min_interval
+    void frame_skipped()
+    {
+        resync_ = true;
+    }
+
+    const char *labels() const
+    {
+        return labels_;
+    }
+
+    // true si une trame peut partir maintenant: elle est alors comptée comme envoyée
+    bool frame_due(uint32_t now)
+    {
+        if (frame_sent_ && (now - last_frame_ < min_interval_ * 1000u))
+        {
+            return false;
+        }
+        frame_sent_ = true;
+        last_frame_ = now;
+        return true;
     }
 
     bool connected()
@@ -50,13 +385,96 @@ public:
         return client_.connected();
     }
 
-    void send_event(const String &data)
+    void send_event(SseEvent *event)
+    {
+        event->ref();
+
+        // seul le plus récent événement de chaque nom compte, une trame complète remplace
+        // aussi des différences: il prend la dernière place pour que les numéros restent croissants
+        for (uint8_t i = 0; i < queued_; ++i)
+        {
+            const SseEvent *e = queue_[(head_ + i) % QUEUE_SIZE];
+            if ((e->name() == event->name()) || (is_frame(e) && is_frame(event)))
+            {
+                resync_ |= is_frame(event);
+                queue_[(head_ + i) % QUEUE_SIZE]->unref();
+                for (uint8_t j = i; j + 1 < queued_; ++j)
+                {
+                    queue_[(head_ + j) % QUEUE_SIZE] = queue_[(head_ + j + 1) % QUEUE_SIZE];
+                }
+                queue_[(head_ + queued_ - 1) % QUEUE_SIZE] = event;
+                ++dropped_;
+                resync_ &= (event->name().length() != 0);
+                pump();
+                return;
+            }
+        }
+
+        if (queued_ == QUEUE_SIZE)
+        {
+            // file pleine: perd le plus ancien
+            resync_ |= is_frame(queue_[head_]);
+            queue_[head_]->unref();
+            head_ = (head_ + 1) % QUEUE_SIZE;
+            --queued_;
+            ++dropped_;
+        }
+
+        queue_[(head_ + queued_) % QUEUE_SIZE] = event;
+        ++queued_;
+        resync_ &= (event->name().length() != 0);
+
+        pump();
+    }
+
+    // écrit ce que la socket accepte sans attendre
+    void pump()
     {
-        client_.print("data: ");
-        client_.print(data);
-        client_.print("\r\n\r\n");
+        while (true)
+        {
+            size_t room = client_.availableForWrite();
+            if (room == 0)
+            {
+                return;
+            }
 
-        client_.flush();
+            // l'événement suivant ne quitte la file que s'il peut commencer à partir
+            if ((sending_ != nullptr) && (sent_ == sending_->text().length()))
+            {
+                sending_->unref();
+                sending_ = nullptr;
+            }
+            if (sending_ == nullptr)
+            {
+                sending_ = next();
+                if (sending_ == nullptr)
+                {
+                    return;
+                }
+                sent_ = 0;
+                last_id_ = sending_->id();
+            }
+
+            const String &text = sending_->text();
+            size_t n = std::min(room, text.length() - sent_);
+            n = client_.write(reinterpret_cast<const uint8_t *>(text.c_str()) + sent_, n);
+            if (n == 0)
+            {
+                return;
+            }
+            sent_ += n;
+        }
+    }
+
+    // plus rien à écrire
+    bool idle() const
+    {
+        return ((sending_ == nullptr) || (sent_ == sending_->text().length())) && (queued_ == 0) && (replay_ == nullptr);
+    }
+
+    uint32_t dropped() const
+    {
+        return dropped_;
     }
 
     String remote() const
@@ -71,9 +489,32 @@ public:
 
 class SseClients
 {
-    std::list<SseClient *> clients_;
+    SseEvent headers_; // en-têtes de la réponse, communs à tous les clients
+    SseHistory history_;
+    SseClient clients_[SSE_MAX_CLIENTS];
+    int32_t heap_released_; // tas libéré par la dernière déconnexion
+    uint32_t last_id_;      // numéro du dernier événement
+    bool had_client_;       // last_client_ est valide
+    uint32_t last_client_;  // millis() du dernier passage avec un client
+    bool new_client_;       // client connecté depuis la dernière trame
 
 public:
+    SseClients()
+        : headers_(F("HTTP/1.1 200 OK\r\n"
+                     "Content-Type: text/event-stream;charset=UTF-8\r\n"
+                     "Connection: close\r\n"            // the connection will be closed after completion of the response
+                     "Access-Control-Allow-Origin: *\r\n" // allow any connection. We don't want Arduino to host all of the website ;-)
+                     "Cache-Control: no-cache\r\n"
+                     "\r\n")),
+          heap_released_(0),
+          last_id_(0),
+          had_client_(false),
+          last_client_(0),
+          new_client_(false)
+    {
+        headers_.ref(); // jamais libérés: ce n'est pas un événement alloué
+    }
+
     void on(const String &uri, ESP8266WebServer &server)
     {
         server.on(uri, [&server, this] {
@@ -86,68 +527,232 @@ public:
 
     void handle_sse_data(ESP8266WebServer &server)
     {
-        if (clients_.size() < 2)
+        for (auto &client : clients_)
         {
-            // if (clients_.size() == 0)
-            // {
-            //     // Set CPU speed to 160MHz
-            //     system_update_cpu_freq(160);
-            // }
-            clients_.push_back(new SseClient(server));
+            if (!client.is_open())
+            {
+                // un navigateur qui se reconnecte indique le dernier événement reçu,
+                // des numéros d'avant un redémarrage ne correspondent à rien
+                uint32_t last_id = server.header(F("Last-Event-ID")).toInt();
+                bool replay = (last_id != 0) && (last_id <= last_id_);
+
+                client.subscribe(server.arg(F("labels")).c_str(),
+                                 server.arg(F("min_interval")).toInt(),
+                                 server.arg(F("delta")).toInt() != 0);
+
+                // récupère le _currentClient : comme l'application est monothreadée
+                // c'est forcément celui qui déclenché la callback on()
+                client.open(server.client(), &headers_, replay ? &history_ : nullptr, replay ? last_id : 0);
+                new_client_ = true;
+                return;
+            }
         }
-        else
+
+        server.send(503, mime::mimeTable[mime::txt].mimeType, "Service Unavailable (too many clients)");
+    }
+
+    size_t count() const
+    {
+        size_t n = 0;
+        for (const auto &client : clients_)
         {
-            server.send(503, mime::mimeTable[mime::txt].mimeType, "Service Unavailable (too many clients)");
+            n += client.is_open();
         }
+        return n;
     }
 
-    size_t count() const
+    // un client attend sa première trame: elle est à envoyer même si elle n'a pas changé
+    bool has_new_client() const
     {
-        return clients_.size();
+        return new_client_;
+    }
+
+    // clients en mode delta: sans eux, les différences ne sont pas calculées
+    bool has_delta_clients() const
+    {
+        for (const auto &client : clients_)
+        {
+            if (client.is_open() && client.delta())
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    static constexpr size_t capacity()
+    {
+        return SSE_MAX_CLIENTS;
+    }
+
+    // mémoire d'un client: son emplacement dans le pool
+    static constexpr size_t client_size()
+    {
+        return sizeof(SseClient);
+    }
+
+    // et la connexion TCP, mesurée lors de la dernière déconnexion, sans les événements
+    int32_t heap_per_client() const
+    {
+        return heap_released_;
     }
 
     String remotes() const
     {
         String s;
-        for (const auto &it : clients_)
+        for (const auto &client : clients_)
         {
-            s += it->remote() + " ";
+            if (client.is_open())
+            {
+                s += client.remote() + " ";
+            }
         }
         return s;
     }
 
-    void handle_clients(const String *send_data = nullptr)
+    // envoie un événement à tous les clients, ou sans événement continue les envois en cours
+    // l'événement est gardé dans l'historique pour ceux qui vont se reconnecter, y compris
+    // SSE_REPLAY_DELAY secondes après le départ du dernier client: au-delà, il n'y a plus
+    // ni événement alloué ni historique
+    //
+    // project n'est donné que pour les trames: les clients abonnés à certaines étiquettes
+    // reçoivent la projection de la trame, rendue une seule fois pour une même liste
+    //
+    // delta, s'il est donné, contient les différences avec la trame précédente:
+    // il est envoyé aux clients en mode delta qui sont à jour, sans entrer dans l'historique
+    void handle_clients(const String *send_data = nullptr,
+                        const char *event = nullptr,
+                        SseProjection project = nullptr,
+                        const String *delta = nullptr)
     {
-        if (clients_.empty())
+        SseEvent *shared = nullptr;
+        SseEvent *differences = nullptr;
+        Projection projections[SSE_MAX_CLIENTS];
+        uint8_t nb_projections = 0;
+
+        if (project != nullptr)
         {
-            // nothing to do
+            new_client_ = false; // il va recevoir la trame
+        }
+
+        if (count() != 0)
+        {
+            had_client_ = true;
+            last_client_ = millis();
+        }
+        else if (!had_client_ || (millis() - last_client_ >= SSE_REPLAY_DELAY * 1000u))
+        {
+            // plus personne pour demander une reprise
+            had_client_ = false;
+            history_.clear();
+            if (send_data != nullptr)
+            {
+                ++last_id_;
+            }
             return;
         }
 
-        auto it = clients_.begin();
-        auto end = clients_.end();
+        if (send_data != nullptr)
+        {
+            shared = new SseEvent(++last_id_, (event != nullptr) ? event : "", *send_data);
+            shared->ref(); // le temps de la distribution
+            history_.add(shared);
+        }
 
-        while (it != end)
+        for (auto &client : clients_)
         {
-            if ((*it)->connected())
+            if (!client.is_open())
+            {
+                continue;
+            }
+
+            if (client.connected())
             {
-                if (send_data)
+                if ((shared != nullptr) && (project != nullptr))
+                {
+                    if (!client.frame_due(millis()))
+                    {
+                        client.frame_skipped();
+                        client.pump();
+                    }
+                    else if ((delta != nullptr) && client.delta_ok())
+                    {
+                        if (differences == nullptr)
+                        {
+                            differences = new SseEvent(last_id_, "delta", *delta);
+                            differences->ref(); // le temps de la distribution
+                        }
+                        client.send_event(differences);
+                    }
+                    else if (client.labels()[0] == 0)
+                    {
+                        client.send_event(shared);
+                    }
+                    else
+                    {
+                        client.send_event(projection(client.labels(), projections, nb_projections, project));
+                    }
+                }
+                else if (shared != nullptr)
                 {
-                    (*it)->send_event(*send_data);
+                    client.send_event(shared);
+                }
+                else
+                {
+                    client.pump();
                 }
-                ++it;
             }
             else
             {
-                delete *it;
-                it = clients_.erase(it);
+                // seule la connexion est mesurée: les événements, éventuellement
+                // partagés, sont libérés avant
+                client.drop_events();
+                uint32_t heap = system_get_free_heap_size();
+                client.close();
+                heap_released_ = static_cast<int32_t>(system_get_free_heap_size() - heap);
+            }
+        }
 
-                // if (clients_.size() == 0)
-                // {
-                //     // back to 80MHz
-                //     system_update_cpu_freq(80);
-                // }
+        if (shared != nullptr)
+        {
+            shared->unref();
+        }
+        if (differences != nullptr)
+        {
+            differences->unref();
+        }
+        for (uint8_t i = 0; i < nb_projections; ++i)
+        {
+            projections[i].event->unref();
+        }
+    }
+
+private:
+    struct Projection
+    {
+        const char *labels;
+        SseEvent *event;
+    };
+
+    // projection de la trame en cours de distribution pour la liste labels,
+    // rendue au premier client qui la demande, avec le numéro de la trame
+    SseEvent *projection(const char *labels, Projection projections[], uint8_t &nb_projections, SseProjection project)
+    {
+        for (uint8_t i = 0; i < nb_projections; ++i)
+        {
+            if (strcmp(projections[i].labels, labels) == 0)
+            {
+                return projections[i].event;
             }
         }
+
+        String data;
+        project(data, labels);
+        SseEvent *e = new SseEvent(last_id_, "", data);
+        e->ref(); // le temps de la distribution
+        projections[nb_projections].labels = labels;
+        projections[nb_projections].event = e;
+        ++nb_projections;
+        return e;
     }
 };
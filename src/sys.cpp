@@ -27,10 +27,12 @@
 #include "sys.h"
 #include "cpuload.h"
 #include "config.h"
+#include "chunkedoutput.h"
 #include "jsonbuilder.h"
 #include "led.h"
 #include "sse.h"
 #include "strncpy_s.h"
+#include "tic.h"
 #include <ArduinoOTA.h>
 #include <ESP8266WebServer.h>
 #include <ESP8266WiFi.h>
@@ -89,11 +91,12 @@ String sys_time_now()
 }
 
 // Return JSON string containing system data
-void sys_get_info_json(String &response, bool restricted)
+template <typename Output>
+void sys_get_info_json(Output &response, bool restricted)
 {
     char buffer[32];
 
-    JSONTableBuilder js(response, 1024);
+    BasicJSONTableBuilder<Output> js(response, 1024);
 
     js.append(F("Uptime"), sys_uptime());
     js.append(F("Timestamp"), sys_time_now());
@@ -160,12 +163,19 @@ void sys_get_info_json(String &response, bool restricted)
     sprintf_P(buffer, PSTR("%zu %%"), 100 * info.usedBytes / info.totalBytes);
     js.append(F("FS Occupation"), buffer);
 
-    js.append(F("SSE Clients"), sse_clients.count());
+    sprintf_P(buffer, PSTR("%zu / %zu"), sse_clients.count(), SseClients::capacity());
+    js.append(F("SSE Clients"), buffer);
+    // emplacement du client, puis tas rendu par la dernière connexion fermée
+    sprintf_P(buffer, PSTR("%zu + %d octets"), SseClients::client_size(), sse_clients.heap_per_client());
+    js.append(F("SSE Mémoire par client"), buffer);
     js.append(F("SSE Connexions"), sse_clients.remotes());
 
     js.finalize();
 }
 
+template void sys_get_info_json(String &response, bool restricted);
+template void sys_get_info_json(ChunkedOutput &response, bool restricted);
+
 // Purpose : scan Wifi Access Point and return JSON code
 void sys_wifi_scan_json(String &response, bool restricted)
 {
@@ -397,6 +407,7 @@ void sys_handle_reset(ESP8266WebServer &server)
     // Just to debug where we are
     Serial.println(F("Serving /reset page..."));
     server.send(200, mime::mimeTable[mime::txt].mimeType, "Restart");
+    tic_save_history();
     Serial.println(F("Ok!"));
     delay(1000);
     ESP.restart();
@@ -414,6 +425,7 @@ void sys_ota_setup()
 
     ArduinoOTA.onEnd([]() {
         led_off();
+        tic_save_history();
         Serial.println(F("Update finished : restarting"));
     });
 
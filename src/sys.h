@@ -6,7 +6,8 @@
 #include <Arduino.h>
 #include <ESP8266WebServer.h>
 
-void sys_get_info_json(String &response, bool restricted);
+template <typename Output>
+void sys_get_info_json(Output &response, bool restricted);
 void sys_handle_reset(ESP8266WebServer &server);
 void sys_handle_factory_reset(ESP8266WebServer &server);
 void sys_wifi_scan_json(String &response, bool restricted);
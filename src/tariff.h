@@ -0,0 +1,194 @@
+/*
+ * librairie Teleinfo: consommation par période tarifaire
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include <Arduino.h>
+#include <time.h>
+
+// Compteurs d'énergie par période tarifaire pour aujourd'hui, hier et le mois
+// en cours, mis à jour à chaque trame.
+//
+// Le compteur tient un index par période (HCHC/HCHP, BBRHCJB...BBRHPJR, EJPHN/EJPHPM,
+// EASF01...EASF10): l'énergie de chaque période est la progression de son index
+// depuis la trame précédente, elle est donc toujours attribuée à la bonne période,
+// même quand la trame qui suit un changement de période arrive en retard.
+// Les périodes sont numérotées comme les index fournisseur du mode standard,
+// de 1 à NB_INDEX, et nommées comme PTEC ou LTARF.
+//
+// Les jours et les mois sont ceux de l'heure locale: les compteurs du jour
+// passent dans ceux d'hier à minuit.
+class TariffAccounting
+{
+public:
+    enum : uint8_t
+    {
+        NB_INDEX = 10,
+        NAME_LENGTH = 16,
+    };
+
+    enum Counter : uint8_t
+    {
+        TODAY,
+        YESTERDAY,
+        MONTH,
+        NB_COUNTERS
+    };
+
+private:
+    uint32_t wh_[NB_COUNTERS][NB_INDEX]; // énergie en Wh par compteur et par période
+    uint32_t last_[NB_INDEX];            // dernier relevé de chaque index, 0 si absent
+    char names_[NB_INDEX][NAME_LENGTH + 1];
+    uint32_t day_;   // jour en cours, en jours depuis le 1er janvier 1970
+    uint32_t month_; // mois en cours, en mois depuis janvier 1900
+    uint8_t active_; // période en cours, 0 si inconnue
+    bool started_;
+
+    // nombre de jours depuis le 1er janvier 1970 (H. Hinnant, days_from_civil)
+    static uint32_t day_number(int year, unsigned month, unsigned mday)
+    {
+        year -= month <= 2;
+        int era = (year >= 0 ? year : year - 399) / 400;
+        unsigned yoe = static_cast<unsigned>(year - era * 400);
+        unsigned doy = (153 * ((month > 2) ? month - 3 : month + 9) + 2) / 5 + mday - 1;
+        unsigned doe = yoe * 365 + yoe / 4 - yoe / 100 + doy;
+        return era * 146097 + static_cast<int>(doe) - 719468;
+    }
+
+    void zero(Counter c)
+    {
+        for (uint8_t i = 0; i < NB_INDEX; ++i)
+        {
+            wh_[c][i] = 0;
+        }
+    }
+
+public:
+    TariffAccounting()
+    {
+        clear();
+    }
+
+    void clear()
+    {
+        for (uint8_t c = 0; c < NB_COUNTERS; ++c)
+        {
+            zero(static_cast<Counter>(c));
+        }
+        for (uint8_t i = 0; i < NB_INDEX; ++i)
+        {
+            last_[i] = 0;
+            names_[i][0] = 0;
+        }
+        day_ = 0;
+        month_ = 0;
+        active_ = 0;
+        started_ = false;
+    }
+
+    // nomme la période (1 à NB_INDEX)
+    void set_name(uint8_t period, const char *name)
+    {
+        if ((period == 0) || (period > NB_INDEX) || (strcmp(names_[period - 1], name) == 0))
+        {
+            return;
+        }
+        strncpy(names_[period - 1], name, NAME_LENGTH);
+        names_[period - 1][NAME_LENGTH] = 0;
+    }
+
+    // ajoute les relevés d'une trame: date locale, index des périodes en Wh (0 si absent)
+    // et période en cours (0 si inconnue)
+    // retourne true si les compteurs ou la période en cours ont changé
+    bool add(const struct tm &tm, const uint32_t index[NB_INDEX], uint8_t active)
+    {
+        bool changed = (active != active_);
+        active_ = (active <= NB_INDEX) ? active : 0;
+
+        uint32_t day = day_number(tm.tm_year + 1900, tm.tm_mon + 1, tm.tm_mday);
+        uint32_t month = tm.tm_year * 12 + tm.tm_mon;
+
+        if (!started_)
+        {
+            started_ = true;
+            day_ = day;
+            month_ = month;
+            changed = true;
+        }
+        else if (day != day_)
+        {
+            // nouveau jour: aujourd'hui devient hier, sauf si un jour a été sauté
+            for (uint8_t i = 0; i < NB_INDEX; ++i)
+            {
+                wh_[YESTERDAY][i] = (day == day_ + 1) ? wh_[TODAY][i] : 0;
+            }
+            zero(TODAY);
+            if (month != month_)
+            {
+                zero(MONTH);
+            }
+            day_ = day;
+            month_ = month;
+            changed = true;
+        }
+
+        for (uint8_t i = 0; i < NB_INDEX; ++i)
+        {
+            if (index[i] == 0)
+            {
+                continue;
+            }
+
+            // un index qui recule (changement de compteur) repart de son nouveau relevé
+            if ((last_[i] != 0) && (index[i] > last_[i]))
+            {
+                uint32_t wh = index[i] - last_[i];
+                wh_[TODAY][i] += wh;
+                wh_[MONTH][i] += wh;
+                changed = true;
+            }
+            last_[i] = index[i];
+        }
+
+        return changed;
+    }
+
+    // énergie en Wh de la période (1 à NB_INDEX)
+    uint32_t energy(Counter c, uint8_t period) const
+    {
+        return ((period == 0) || (period > NB_INDEX)) ? 0 : wh_[c][period - 1];
+    }
+
+    // coût en dix-millièmes d'euro, avec les prix du kWh par période en dix-millièmes d'euro
+    uint64_t cost(Counter c, const uint16_t prices[NB_INDEX]) const
+    {
+        uint64_t cost = 0;
+        for (uint8_t i = 0; i < NB_INDEX; ++i)
+        {
+            cost += static_cast<uint64_t>(wh_[c][i]) * prices[i];
+        }
+        return (cost + 500) / 1000;
+    }
+
+    // nom de la période, vide si elle n'a jamais été vue
+    const char *name(uint8_t period) const
+    {
+        return ((period == 0) || (period > NB_INDEX)) ? "" : names_[period - 1];
+    }
+
+    bool has_period(uint8_t period) const
+    {
+        return (period != 0) && (period <= NB_INDEX) && ((last_[period - 1] != 0) || (names_[period - 1][0] != 0));
+    }
+
+    uint8_t active() const
+    {
+        return active_;
+    }
+
+    bool is_empty() const
+    {
+        return !started_;
+    }
+};
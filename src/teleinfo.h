@@ -4,6 +4,7 @@
  */
 #pragma once
 
+#include "ticlabels.h"
 #include <Arduino.h>
 #include <sys/time.h>
 #include <time.h>
@@ -11,8 +12,10 @@
 #define STX 0x02 // start of text
 #define ETX 0x03 // end of text
 #define EOT 0x04 // end of transmission
+#define HT 0x09  // horizontal tab
 #define LF 0x0A  // line feed
 #define CR 0x0D  // carriage return
+#define SP 0x20  // space
 
 /*
 <STX>
@@ -28,6 +31,18 @@
 <LF>HHPHC D /<CR>
 <LF>MOTDETAT 000000 B<CR>
 <ETX>
+
+mode standard (9600 bauds): séparateur HT, horodatage optionnel,
+checksum calculé en incluant le dernier séparateur (mode n°2)
+<STX>
+<LF>ADSC<HT>041876097321<HT>E<CR>
+<LF>VTIC<HT>02<HT>J<CR>
+<LF>DATE<HT>E200520164452<HT><HT>C<CR>
+<LF>NGTF<HT>      BASE      <HT><<CR>
+<LF>EAST<HT>001538257<HT>#<CR>
+<LF>SMAXSN<HT>E200520095010<HT>01858<HT>:<CR>
+...
+<ETX>
 */
 
 // Quelques rappels sur le courant alternatif monophasé:
@@ -37,230 +52,307 @@
 //  W = puissance active en watt (W) = U * I * cos Φ
 //  en France, la tension nominale est 230V à 50Hz
 
-class Teleinfo
+// trame reçue et son index des groupes
+struct TeleinfoFrame
 {
-public:
-    static const size_t MAX_FRAME_SIZE = 350;
+    // une trame standard monophasée fait environ 600 octets et 40 groupes,
+    // une trame triphasée en production peut atteindre 70 groupes
+    static const size_t MAX_FRAME_SIZE = 1536;
+    static const size_t MAX_GROUPS = 80;
 
-protected:
-    char frame_[MAX_FRAME_SIZE]; // buffer de mémorisation de la trame
-    size_t size_{0};             // offset courant (i.e. longueur de la trame)
-    timeval timestamp_{0, 0};    // date du début de la trame
-
-    struct conso
+    // index des groupes, construit par le décodeur à la validation du checksum
+    struct group
     {
-        uint32_t date_ms;
-        uint32_t watt_heure;
+        uint16_t hash;  // empreinte de l'étiquette
+        uint16_t label; // offset de l'étiquette dans data
+        uint16_t value; // offset de la valeur dans data
+        uint16_t date;  // offset de l'horodatage dans data, 0 si absent
+        uint8_t next;   // groupe suivant dans la même alvéole
+        Label id;       // identifiant de l'étiquette, Label::unknown si inconnue
     };
 
-    static const size_t CONSO_MAX = 48; // il y a une mesure toute les 1.4 s
-    conso consos_[CONSO_MAX];           // avec 48, on couvre 67 s
-    ssize_t i_consos_{0};
-    conso conso0_{0, 0};
-
-public:
-    Teleinfo()
+    static const size_t HASH_BUCKETS = 16; // puissance de 2
+    static const uint8_t NO_GROUP = 0xFF;
+
+    char data[MAX_FRAME_SIZE];     // contenu de la trame
+    size_t size{0};                // longueur de la trame, 0 si vide
+    timeval timestamp{0, 0};       // date du début de la trame
+    group groups[MAX_GROUPS];      // index des groupes de la trame
+    uint8_t nb_groups{0};          // nombre de groupes indexés
+    bool standard{false};          // trame en mode standard
+    uint8_t buckets[HASH_BUCKETS]; // premier groupe de chaque alvéole
+    uint8_t ids[TIC_LABEL_COUNT];  // premier groupe de chaque étiquette connue
+
+    // différences avec la trame précédente, calculées à la publication
+    uint32_t sequence{0};                       // numéro de la trame
+    uint8_t changed[(MAX_GROUPS + 7) / 8];      // groupes nouveaux ou modifiés
+    uint8_t removed[(TIC_LABEL_COUNT + 7) / 8]; // étiquettes connues disparues
+    uint8_t nb_changed{0};                      // nombre de groupes nouveaux ou modifiés
+    uint8_t nb_removed{0};                      // nombre de groupes disparus
+
+    TeleinfoFrame()
     {
-        memset(&consos_, 0, sizeof(consos_));
+        clear_index();
     }
 
-    void copy_from(const Teleinfo &tinfo)
+    void clear_index()
     {
-        size_ = tinfo.size_;
-        memmove(frame_, tinfo.frame_, size_);
-        timestamp_ = tinfo.timestamp_;
+        nb_groups = 0;
+        standard = false;
+        memset(buckets, NO_GROUP, sizeof(buckets));
+        memset(ids, NO_GROUP, sizeof(ids));
+        memset(changed, 0, sizeof(changed));
+        memset(removed, 0, sizeof(removed));
+        nb_changed = 0;
+        nb_removed = 0;
+    }
 
-        if (!is_empty())
+    // recherche d'un groupe dans l'index
+    const group *find_group(const char *label, uint16_t hash) const
+    {
+        uint8_t i = buckets[hash & (HASH_BUCKETS - 1)];
+        while (i != NO_GROUP)
         {
-            uint32_t wh = get_value_int("HCHP") + get_value_int("HCHC");
-
-            if (conso0_.date_ms == 0)
+            const group &g = groups[i];
+            if ((g.hash == hash) && (strcmp(data + g.label, label) == 0))
             {
-                // mémorise une valeur initiale pour avoir des valeurs
-                // un peu moins grandes dans le tableau consos_[]
-                conso0_.date_ms = timestamp_.tv_sec - 1;
-                conso0_.watt_heure = wh - 1;
+                return &g;
             }
+            i = g.next;
+        }
+        return nullptr;
+    }
 
-            consos_[i_consos_].date_ms = (timestamp_.tv_sec - conso0_.date_ms) * 1000 + timestamp_.tv_usec / 1000;
-            consos_[i_consos_].watt_heure = wh - conso0_.watt_heure;
-
-            i_consos_ = (i_consos_ + 1) % CONSO_MAX;
+    // recherche par identifiant si l'étiquette est connue, sinon par empreinte
+    const group *find_group(const char *label, uint16_t hash, Label id) const
+    {
+        if (id != Label::unknown)
+        {
+            uint8_t i = ids[static_cast<size_t>(id)];
+            return (i == NO_GROUP) ? nullptr : &groups[i];
         }
+        return find_group(label, hash);
     }
 
-    // retourne l'estimation de la puissance en watt en dérivant les index
-    // de consommation d'énergie qui sont en W.h
-    //
-    // faute de pouvoir faire beaucoup de calculs et de connaître les valeurs futures,
-    // on estime que la variation de la puissance est linéaire sur l'intervalle de temps
-    //
-    // il faut une période de 60s pour avoir une mesure si la puissance est de 60 W:
-    // en 60s l'index va monter de 1 Wh, résolution des index HC/HP.
-    uint32_t watt(uint32_t periode = 60) const
+    bool is_changed(uint8_t i) const
     {
-        ssize_t actuel = (CONSO_MAX + i_consos_ - 1) % CONSO_MAX;
-        uint32_t now = consos_[actuel].date_ms;
-        ssize_t premier = actuel;
+        return (changed[i / 8] & (1 << (i % 8))) != 0;
+    }
 
-        periode = periode * 1000; // secondes -> millisecondes
+    bool is_removed(Label id) const
+    {
+        size_t i = static_cast<size_t>(id);
+        return (removed[i / 8] & (1 << (i % 8))) != 0;
+    }
 
-        // cherche la valeur la plus éloignée dans le tableau circulaire
-        // tout en restant dans la période
-        do
+    // compare les groupes avec ceux de la trame précédente:
+    // un groupe est modifié si sa valeur ou son horodatage change, ou s'il est nouveau
+    void compare(const TeleinfoFrame &prev)
+    {
+        for (uint8_t i = 0; i < nb_groups; ++i)
         {
-            ssize_t suivant = (CONSO_MAX + premier - 1) % CONSO_MAX;
-            if (consos_[suivant].watt_heure == 0)
+            const group &g = groups[i];
+            const group *p = prev.find_group(data + g.label, g.hash, g.id);
+
+            if ((p == nullptr) ||
+                (strcmp(data + g.value, prev.data + p->value) != 0) ||
+                ((g.date == 0) != (p->date == 0)) ||
+                ((g.date != 0) && (strcmp(data + g.date, prev.data + p->date) != 0)))
             {
-                break;
+                changed[i / 8] |= 1 << (i % 8);
+                ++nb_changed;
             }
-            if (now - consos_[suivant].date_ms > periode)
+        }
+
+        for (uint8_t i = 0; i < prev.nb_groups; ++i)
+        {
+            const group &p = prev.groups[i];
+            if (find_group(prev.data + p.label, p.hash, p.id) == nullptr)
             {
-                break;
+                ++nb_removed;
+                if (p.id != Label::unknown)
+                {
+                    removed[static_cast<size_t>(p.id) / 8] |= 1 << (static_cast<size_t>(p.id) % 8);
+                }
             }
-            premier = suivant;
-        } while (premier != i_consos_);
+        }
+    }
 
-        if (consos_[actuel].date_ms == consos_[premier].date_ms)
+    // retrouve l'indice du groupe qui commence à l'offset donné
+    // (les groupes sont rangés dans l'ordre de la trame)
+    uint8_t group_at(size_t offset) const
+    {
+        uint8_t lo = 0;
+        uint8_t hi = nb_groups;
+        while (lo < hi)
         {
-            // i.e. actuel == premier (sauf si problème de mesure)
-            // pas assez de valeur
-            return 0;
+            uint8_t mid = (lo + hi) / 2;
+            if (groups[mid].label < offset)
+                lo = mid + 1;
+            else
+                hi = mid;
         }
+        return lo;
+    }
 
-#if 0
-        // ajustement affine avec toutes les valeurs trouvées
+    // ajoute un groupe à l'index, retourne false s'il n'y a plus de place
+    bool add_group(uint16_t hash, size_t label, size_t value, size_t date = 0)
+    {
+        if (nb_groups >= MAX_GROUPS)
+        {
+            return false;
+        }
 
-        size_t i = premier;
-        int n = 0;
-        double m_x = 0;
-        double m_y = 0;
-        double s_x2 = 0;
-        double s_y2 = 0;
-        double s_xy = 0;
-        double x_prev = consos_[premier].date_ms;
+        group &g = groups[nb_groups];
+        g.hash = hash;
+        g.label = label;
+        g.value = value;
+        g.date = date;
+        g.next = NO_GROUP;
+        g.id = tic_label_find(data + label, hash);
 
-        while (true)
+        // en cas de doublon, la recherche retourne la première occurrence
+        if (find_group(data + label, hash) == nullptr)
         {
-            n += 1;
+            uint8_t &bucket = buckets[hash & (HASH_BUCKETS - 1)];
+            g.next = bucket;
+            bucket = nb_groups;
 
-            double x = consos_[i].date_ms;
-            double y = consos_[i].watt_heure;
-
-            if (x < x_prev)
+            if (g.id != Label::unknown)
             {
-                x += 1000000;
+                ids[static_cast<size_t>(g.id)] = nb_groups;
             }
-            x_prev = x;
-
-            x = x / 3600000.; // convertit x de millisecondes en heures
-
-            m_x += x;
-            m_y += y;
+        }
 
-            s_x2 += x * x;
-            s_y2 += y * y;
-            s_xy += x * y;
+        ++nb_groups;
+        return true;
+    }
+};
 
-            if (i == actuel)
-            {
-                break;
-            }
-            i = (i + 1) % CONSO_MAX;
-        }
+class Teleinfo
+{
+public:
+    static const size_t MAX_FRAME_SIZE = TeleinfoFrame::MAX_FRAME_SIZE;
+    static const size_t MAX_GROUPS = TeleinfoFrame::MAX_GROUPS;
 
-        m_x = m_x / n;                        // moyenne(x)
-        m_y = m_y / n;                        // moyenne(y)
-        double cov_xy = s_xy / n - m_x * m_y; // Cov(x, y)
-        double v_x = s_x2 / n - m_x * m_x;    // V(x)
-        double v_y = s_y2 / n - m_y * m_y;    // V(x)
+    // empreinte d'une étiquette (djb2 en 16 bits)
+    static constexpr uint16_t label_hash(const char *label)
+    {
+        return tic_label_hash(label);
+    }
 
-        double r = cov_xy / sqrt(v_x * v_y); // coeff de corrélation linéaire
-        double a = cov_xy / v_x;             // Y = a X + b
-        double b = m_y - a * m_x;            //
+protected:
+    typedef TeleinfoFrame::group group;
 
-        uint32_t w = round(a);
-#else
-        // considère uniquement les première et dernière (actuelle) valeurs
+    // dernière trame complète: elle appartient au décodeur qui l'a publiée,
+    // nullptr tant qu'il n'y en a pas (pas de trame vide en mémoire pour ça)
+    const TeleinfoFrame *frame_;
 
-        uint32_t wh = consos_[actuel].watt_heure - consos_[premier].watt_heure;
-        int32_t t = now - consos_[premier].date_ms;
-        if (t < 0)
-        {
-            t += 1000000;
-        }
-        uint32_t w = (3600000 * wh) / t;
-#endif
+    // date de début de la trame, nulle sans trame
+    timeval get_timeval() const
+    {
+        return (frame_ == nullptr) ? timeval{0, 0} : frame_->timestamp;
+    }
 
-        // for (int i = 0; i < CONSO_MAX; ++i)
-        // {
-        //     char flag = ' ';
-        //     if (i == i_consos_)
-        //         flag = 'i';
-        //     if (i == actuel)
-        //         flag = 'a';
-        //     if (i == premier)
-        //         flag = 'p';
-        //     printf("%2d %c %10d %10d\n", i, flag, consos_[i].date_ms, consos_[i].watt_heure);
-        // }
-        // printf("\tactuel=%2zu  dernier=%2zu   W=%u   a=%.3lf r=%.3lf\n", actuel, premier, w, 0.,0.);
+public:
+    Teleinfo() : frame_(nullptr)
+    {
+    }
 
-        return w;
+    // reprend la dernière trame complète du décodeur, sans recopie:
+    // le décodeur écrit la trame suivante dans l'autre buffer
+    void update_from(const Teleinfo &tinfo)
+    {
+        frame_ = tinfo.frame_;
     }
 
     bool is_empty() const
     {
-        return size_ == 0;
+        return (frame_ == nullptr) || (frame_->size == 0);
     }
 
-    const char *get_value(const char *label, const char *default_value = nullptr, bool remove_leading_zeros = false) const
+    // mode de la trame: historique (1200 bauds) ou standard (9600 bauds)
+    bool is_standard() const
     {
-        const char *p = frame_;
-        const char *end = frame_ + size_;
+        return (frame_ != nullptr) && frame_->standard;
+    }
 
-        while (p < end)
+    // index d'énergie active soutirée en Wh, tous les index tarifaires confondus
+    uint32_t energy() const
+    {
+        if (is_standard())
         {
-            const char *current_label = p;
+            return get_value_int(Label::EAST);
+        }
 
-            // cherche la fin de l'étiquette
-            while (*p != 0)
-            {
-                if (p >= end)
-                    return default_value;
-                ++p;
-            }
+        static const Label index[] = {Label::BASE,
+                                      Label::HCHC, Label::HCHP,
+                                      Label::EJPHN, Label::EJPHPM,
+                                      Label::BBRHCJB, Label::BBRHPJB,
+                                      Label::BBRHCJW, Label::BBRHPJW,
+                                      Label::BBRHCJR, Label::BBRHPJR};
+        uint32_t wh = 0;
+        for (auto id : index)
+        {
+            wh += get_value_int(id);
+        }
+        return wh;
+    }
 
-            //saute le 0 sépateur étiquette-valeur
-            ++p;
-            if (p >= end)
-                return default_value;
+    const char *get_value(const char *label, const char *default_value = nullptr, bool remove_leading_zeros = false) const
+    {
+        if (is_empty())
+        {
+            return default_value;
+        }
 
-            const char *current_value = p;
+        const group *g = frame_->find_group(label, label_hash(label));
+        if (g == nullptr)
+        {
+            return default_value;
+        }
 
-            // cherche la fin de la valeur
-            while (*p != 0)
-            {
-                if (p >= end)
-                    return default_value;
-                ++p;
-            }
-            ++p; //saute le 0
+        const char *value = frame_->data + g->value;
+        if (remove_leading_zeros)
+            get_integer(value);
 
-            if (strcmp(current_label, label) == 0)
-            {
-                if (remove_leading_zeros)
-                    get_integer(current_value);
+        return value;
+    }
 
-                return current_value;
-            }
+    // accès direct par identifiant, sans comparaison de chaînes
+    const char *get_value(Label id, const char *default_value = nullptr, bool remove_leading_zeros = false) const
+    {
+        if (is_empty() || (id >= Label::unknown))
+        {
+            return default_value;
+        }
+
+        uint8_t i = frame_->ids[static_cast<size_t>(id)];
+        if (i == TeleinfoFrame::NO_GROUP)
+        {
+            return default_value;
         }
 
-        return default_value;
+        const char *value = frame_->data + frame_->groups[i].value;
+        if (remove_leading_zeros)
+            get_integer(value);
+
+        return value;
     }
 
     uint32_t get_value_int(const char *label, uint32_t default_value = 0) const
     {
-        const char *value = get_value(label, nullptr, true);
+        return to_int(get_value(label, nullptr, true), default_value);
+    }
+
+    uint32_t get_value_int(Label id, uint32_t default_value = 0) const
+    {
+        return to_int(get_value(id, nullptr, true), default_value);
+    }
+
+    // convertit une valeur en entier
+    static uint32_t to_int(const char *value, uint32_t default_value = 0)
+    {
         if (value == nullptr)
         {
             return default_value;
@@ -280,57 +372,161 @@ public:
         return u;
     }
 
-    bool get_value_next(const char *&label, const char *&value, char const **state) const
+    // horodatage d'un groupe (mode standard): SAAMMJJhhmmss, S étant la saison (E/H)
+    const char *get_date(const char *label) const
     {
-        const char *p = frame_;
-        const char *end = frame_ + size_;
+        if (is_empty())
+        {
+            return nullptr;
+        }
 
-        if (state == nullptr)
-            return false;
-        if (*state != nullptr && (*state < frame_ || *state >= end))
-            return false;
+        const group *g = frame_->find_group(label, label_hash(label));
+        return (g == nullptr || g->date == 0) ? nullptr : frame_->data + g->date;
+    }
 
-        if (*state != nullptr)
-            p = *state;
+    const char *get_date(Label id) const
+    {
+        if (is_empty() || (id >= Label::unknown))
+        {
+            return nullptr;
+        }
+
+        uint8_t i = frame_->ids[static_cast<size_t>(id)];
+        return (i == TeleinfoFrame::NO_GROUP || frame_->groups[i].date == 0) ? nullptr : frame_->data + frame_->groups[i].date;
+    }
 
-        label = p;
+    // parcourt les groupes dans l'ordre de la trame
+    // state doit être initialisé à nullptr, il pointe ensuite sur l'étiquette du groupe suivant
+    bool get_value_next(const char *&label, const char *&value, char const **state, const char **date = nullptr) const
+    {
+        if (state == nullptr || is_empty())
+            return false;
 
-        // cherche la fin de l'étiquette
-        while (*p != 0)
+        uint8_t i = 0;
+        if (*state != nullptr)
         {
-            if (p >= end)
+            if (*state < frame_->data || *state >= frame_->data + frame_->size)
                 return false;
-            ++p;
+            i = frame_->group_at(*state - frame_->data);
         }
+        if (i >= frame_->nb_groups)
+            return false;
 
-        //saute le 0 sépateur étiquette-valeur
-        ++p;
-        if (p >= end)
+        const group &g = frame_->groups[i];
+        label = frame_->data + g.label;
+        value = frame_->data + g.value;
+        if (date != nullptr)
+            *date = (g.date == 0) ? nullptr : frame_->data + g.date;
+
+        // l'étiquette du groupe suivant, ou la fin de la trame
+        *state = (i + 1 < frame_->nb_groups) ? frame_->data + frame_->groups[i + 1].label : frame_->data + frame_->size;
+        return true;
+    }
+
+    // numéro de la trame, incrémenté à chaque trame publiée par le décodeur:
+    // un saut indique que les différences ne portent pas sur la trame vue précédemment
+    uint32_t get_sequence() const
+    {
+        return (frame_ == nullptr) ? 0 : frame_->sequence;
+    }
+
+    // buffer de la trame: avec le numéro, distingue les trames de deux décodeurs
+    const void *get_frame_id() const
+    {
+        return frame_;
+    }
+
+    // la trame diffère-t-elle de la précédente ?
+    bool has_changed() const
+    {
+        return (frame_ != nullptr) && ((frame_->nb_changed != 0) || (frame_->nb_removed != 0));
+    }
+
+    // nombre de groupes nouveaux ou modifiés, et de groupes disparus
+    uint8_t get_nb_changed() const
+    {
+        return (frame_ == nullptr) ? 0 : frame_->nb_changed;
+    }
+
+    uint8_t get_nb_removed() const
+    {
+        return (frame_ == nullptr) ? 0 : frame_->nb_removed;
+    }
+
+    // le groupe est nouveau, modifié ou a disparu depuis la trame précédente
+    bool is_changed(Label id) const
+    {
+        if (is_empty() || (id >= Label::unknown))
+        {
             return false;
+        }
 
-        value = p;
+        uint8_t i = frame_->ids[static_cast<size_t>(id)];
+        return (i == TeleinfoFrame::NO_GROUP) ? frame_->is_removed(id) : frame_->is_changed(i);
+    }
 
-        // cherche la fin de la valeur
-        while (*p != 0)
+    // les étiquettes inconnues disparues ne sont pas signalées (cf. get_nb_removed())
+    bool is_changed(const char *label) const
+    {
+        uint16_t hash = label_hash(label);
+        Label id = tic_label_find(label, hash);
+        if (id != Label::unknown)
         {
-            if (p >= end)
-                return false;
-            ++p;
+            return is_changed(id);
         }
-        ++p; //saute le 0
 
-        *state = p;
-        return true;
+        const group *g = is_empty() ? nullptr : frame_->find_group(label, hash);
+        return (g != nullptr) && frame_->is_changed(g - frame_->groups);
+    }
+
+    // comme get_value_next(), en ne retenant que les groupes nouveaux ou modifiés
+    bool get_changed_next(const char *&label, const char *&value, char const **state, const char **date = nullptr) const
+    {
+        while (get_value_next(label, value, state, date))
+        {
+            if (frame_->is_changed(frame_->group_at(label - frame_->data)))
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // accès aux groupes par indice, dans l'ordre de la trame
+    uint8_t get_nb_groups() const
+    {
+        return is_empty() ? 0 : frame_->nb_groups;
+    }
+
+    // étiquette et valeur du groupe i, retourne son identifiant
+    Label get_group(uint8_t i, const char *&label, const char *&value) const
+    {
+        const group &g = frame_->groups[i];
+        label = frame_->data + g.label;
+        value = frame_->data + g.value;
+        return g.id;
+    }
+
+    // le groupe i est nouveau ou modifié depuis la trame précédente
+    bool is_group_changed(uint8_t i) const
+    {
+        return frame_->is_changed(i);
     }
 
     time_t get_timestamp() const
     {
-        return timestamp_.tv_sec;
+        return get_timeval().tv_sec;
+    }
+
+    uint16_t get_timestamp_ms() const
+    {
+        return get_timeval().tv_usec / 1000;
     }
 
     String get_timestamp_iso8601() const
     {
-        struct tm *tm = localtime(&timestamp_.tv_sec);
+        time_t sec = get_timestamp();
+        struct tm *tm = localtime(&sec);
         char buf[32]; // bien suffisant pour date
         strftime(buf, sizeof(buf), "%Y-%m-%dT%H:%M:%S%z", tm);
         return String(buf);
@@ -339,42 +535,36 @@ public:
     String get_seconds() const
     {
         char buf[32]; // bien suffisant pour les secondes
-        snprintf(buf, sizeof(buf), "%ld.%03d", timestamp_.tv_sec, (int)(timestamp_.tv_usec / 1000));
+        const timeval tv = get_timeval();
+        snprintf(buf, sizeof(buf), "%ld.%03d", tv.tv_sec, (int)(tv.tv_usec / 1000));
         return String(buf);
     }
 
+    // reconstitue la trame sans les checksums, un groupe par ligne
     size_t get_frame_ascii(char *frame, size_t size) const
     {
+        const char sep = is_standard() ? HT : SP;
         size_t j = 0;
-        bool label = true;
-        for (size_t i = 0; i < size_; ++i)
+
+        auto append = [&](const char *s, char end) {
+            while (*s && (j < size - 2))
+                frame[j++] = *s++;
+            if (j < size - 2)
+                frame[j++] = end;
+        };
+
+        for (uint8_t i = 0; !is_empty() && (i < frame_->nb_groups) && (j < size - 2); ++i)
         {
-            int c = frame_[i];
-            if (c == 0)
-            {
-                if (label)
-                {
-                    frame[j++] = ' ';
-                }
-                else
-                {
-                    frame[j++] = LF;
-                }
-                label = !label;
-            }
-            else
-            {
-                frame[j++] = c;
-            }
-            if (j >= size - 2)
-            {
-                break;
-            }
+            const group &g = frame_->groups[i];
+            append(frame_->data + g.label, sep);
+            if (g.date != 0)
+                append(frame_->data + g.date, sep);
+            append(frame_->data + g.value, LF);
         }
+
         if (j != 0 && frame[j - 1] != LF)
         {
-            // par construction, on doit avoir un LF à la fin
-            // sinon la frame est mal formée
+            // buffer trop petit: on ne retourne pas de trame tronquée
             j = 0;
         }
         frame[j] = 0;
@@ -384,7 +574,11 @@ public:
 
     static bool get_integer(const char *&value)
     {
-        // il faut que value ne contienne que des chiffres
+        // il faut que value ne contienne que des chiffres (DATE n'a pas de valeur)
+        if (*value == 0)
+        {
+            return false;
+        }
         for (const char *c = value; *c; ++c)
         {
             if (!isdigit(*c))
@@ -399,10 +593,27 @@ public:
     }
 };
 
+// Le décodeur remplit alternativement deux trames: à la réception de ETX,
+// la trame complète est publiée (frame_) et la suivante est écrite dans l'autre.
+// Les lecteurs (Teleinfo::update_from) ne font que reprendre le pointeur.
 class TeleinfoDecoder : public Teleinfo
 {
+    TeleinfoFrame frames_[2];      // trame publiée et trame en cours de réception
+    TeleinfoFrame *cur_{frames_};  // trame en cours de réception
+    bool ready_{false};            // une trame vient d'être publiée
+    bool lost_{false};             // erreur déjà comptée, en attente de STX
+    uint32_t sequence_{0};         // numéro de la dernière trame publiée
     size_t offset_{0};             // offset courant (i.e. longueur de la trame)
     size_t offset_start_group_{0}; // offset de début d'un groupe (état wait_cr)
+
+    // groupe en cours, calculé au fil de la réception
+    static const uint16_t NO_SEP = 0xFFFF;
+    uint16_t sum_{0};       // somme des octets du groupe (modulo 2^16, seuls 6 bits comptent)
+    uint16_t hash_{0};      // empreinte de l'étiquette
+    bool in_label_{false};  // aucun séparateur reçu dans le groupe
+    uint16_t sp_{NO_SEP};   // offset du premier espace
+    uint16_t ht_[2];        // offsets des deux premières tabulations
+    uint8_t nb_ht_{0};      // nombre de tabulations (plafonné à 4)
     enum
     {
         wait_stx,
@@ -413,151 +624,445 @@ class TeleinfoDecoder : public Teleinfo
     int (*time_cb_)(struct timeval *, void *){(int (*)(struct timeval *, void *))(::gettimeofday)};
 
 public:
+    // compteurs de réception
+    struct Stats
+    {
+        uint32_t bytes;           // octets reçus
+        uint32_t frames;          // trames complètes
+        uint32_t groups[2];       // groupes valides par mode (0: historique, 1: standard)
+        uint32_t checksum_errors; // groupes rejetés pour mauvais checksum
+        uint32_t overflows;       // trames trop longues ou avec trop de groupes
+        uint32_t resyncs;         // trames abandonnées, une fois par perte de synchronisation
+        uint32_t stray_bytes;     // octets reçus hors trame, en attente de STX
+        uint32_t interrupts;      // trames interrompues par EOT
+        uint32_t intervals;       // nombre d'intervalles mesurés entre deux trames complètes
+        uint32_t interval_min;    // intervalle minimal en ms
+        uint32_t interval_max;    // intervalle maximal en ms
+        uint64_t interval_total;  // somme des intervalles en ms
+
+        uint32_t interval_avg() const
+        {
+            return (intervals == 0) ? 0 : interval_total / intervals;
+        }
+    };
+
+private:
+    Stats stats_{};
+
+public:
+    // la trame publiée est d'abord l'autre buffer, vide: la première trame reçue
+    // est comparée à elle
+    TeleinfoDecoder()
+    {
+        frame_ = &frames_[1];
+    }
+    TeleinfoDecoder(const TeleinfoDecoder &) = delete;
+    TeleinfoDecoder &operator=(const TeleinfoDecoder &) = delete;
+
     void set_time_cb(int (*cb)(struct timeval *, void *))
     {
         time_cb_ = cb;
     }
 
+    const Stats &stats() const
+    {
+        return stats_;
+    }
+
     // trame complète, on peut la lire
     bool ready() const
     {
-        return size_ != 0;
+        return ready_;
     }
 
+    // traite un octet reçu
     void put(int c)
     {
-        size_ = 0;
+        ready_ = false;
+        ++stats_.bytes;
+        decode(c);
+    }
+
+    // traite un buffer d'octets reçus
+    // s'arrête juste après la fin d'une trame pour qu'elle puisse être lue
+    // avant d'être écrasée par la suivante: ready() indique si c'est le cas
+    // retourne le nombre d'octets consommés
+    size_t put(const uint8_t *buf, size_t len)
+    {
+        ready_ = false;
 
-        if (c == STX)
+        for (size_t i = 0; i < len; ++i)
         {
-            // début de trame, on réinitialise et on attend un LF (ou un ETX à la rigueur...)
-            offset_ = 0;
-            state_ = wait_lf_or_etx;
-            time_cb_(&timestamp_, nullptr);
+            if (decode(buf[i]))
+            {
+                stats_.bytes += i + 1;
+                return i + 1;
+            }
         }
-        else if (c == LF)
+        stats_.bytes += len;
+        return len;
+    }
+
+private:
+    // classes d'octets de l'automate de réception
+    enum : uint8_t
+    {
+        class_data, // caractère quelconque
+        class_stx,
+        class_etx,
+        class_eot,
+        class_lf,
+        class_cr,
+        class_sep, // HT ou SP: séparateur possible
+        nb_classes
+    };
+
+    // actions de l'automate de réception
+    enum : uint8_t
+    {
+        action_store,       // mémorise le caractère dans le groupe en cours
+        action_start_frame, // STX: début de trame
+        action_start_group, // LF: début de groupe
+        action_separator,   // HT ou SP dans un groupe: mémorise sa position
+        action_end_group,   // CR: fin de groupe, vérification du checksum
+        action_end_frame,   // ETX: fin de trame
+        action_interrupt,   // EOT: trame interrompue
+        action_ignore,      // EOT hors trame
+        action_error,       // octet inattendu: on attend la trame suivante
+    };
+
+    // table des classes, indexée par l'octet sans le bit de parité
+    struct ByteClasses
+    {
+        uint8_t c[128];
+    };
+
+    static constexpr ByteClasses make_byte_classes()
+    {
+        ByteClasses classes{};
+        classes.c[STX] = class_stx;
+        classes.c[ETX] = class_etx;
+        classes.c[EOT] = class_eot;
+        classes.c[LF] = class_lf;
+        classes.c[CR] = class_cr;
+        classes.c[HT] = class_sep;
+        classes.c[SP] = class_sep;
+        return classes;
+    }
+
+    // action à effectuer selon l'état et la classe de l'octet reçu
+    static uint8_t transition(uint8_t state, int c)
+    {
+        static constexpr ByteClasses classes = make_byte_classes();
+        // clang-format off
+        static constexpr uint8_t transitions[3][nb_classes] = {
+            //                    data          STX                 ETX               EOT               LF                  CR                HT/SP
+            /* wait_stx */       {action_error, action_start_frame, action_error,     action_ignore,    action_error,       action_error,     action_error},
+            /* wait_lf_or_etx */ {action_error, action_start_frame, action_end_frame, action_interrupt, action_start_group, action_error,     action_error},
+            /* wait_cr */        {action_store, action_start_frame, action_error,     action_interrupt, action_error,       action_end_group, action_separator},
+        };
+        // clang-format on
+        return transitions[state][classes.c[c]];
+    }
+
+    // automate de réception, retourne true si la trame est complète
+    bool decode(int c)
+    {
+        // un octet reçu en 8 bits au lieu de 7E1 porte la parité dans le bit de poids fort
+        c &= 0x7F;
+
+        uint8_t action = transition(state_, c);
+
+        // cas le plus fréquent, traité avant l'aiguillage
+        if (action == action_store)
         {
-            // début de valeur: on doit être dans l'état adéquant
-            if (state_ == wait_lf_or_etx)
+            if (offset_ < MAX_FRAME_SIZE)
             {
-                // on passe dans l'état lecture jusqu'au CR
-                state_ = wait_cr;
-                offset_start_group_ = offset_;
+                cur_->data[offset_++] = c;
+                sum_ += c;
+                if (in_label_)
+                {
+                    hash_ = (hash_ * 33) ^ c;
+                }
             }
             else
             {
-                // sinon, erreur et on attend le début de la trame suivante
-                state_ = wait_stx;
+                // frame trop longue: reinit
+                overflow();
             }
+            return false;
         }
-        else if (c == CR)
+
+        switch (action)
         {
-            // fin de donnée
-            if (state_ == wait_cr)
+        case action_start_frame:
+            // début de trame, on réinitialise et on attend un LF (ou un ETX à la rigueur...)
+            offset_ = 0;
+            cur_->clear_index();
+            state_ = wait_lf_or_etx;
+            lost_ = false;
+            time_cb_(&cur_->timestamp, nullptr);
+            break;
+
+        case action_start_group:
+            // début de valeur: on passe dans l'état lecture jusqu'au CR
+            state_ = wait_cr;
+            offset_start_group_ = offset_;
+            sum_ = 0;
+            hash_ = 5381;
+            in_label_ = true;
+            sp_ = NO_SEP;
+            nb_ht_ = 0;
+            break;
+
+        case action_separator:
+            if (offset_ >= MAX_FRAME_SIZE)
+            {
+                // frame trop longue: reinit
+                overflow();
+                break;
+            }
+            if (c == HT)
             {
-                // 4 octets au moins (STX-LF-groupe-crc) en début de trame
-                // 2 octets au moins pour finir la trame
-                if ((offset_ >= 4) && (offset_ < (MAX_FRAME_SIZE - 2)))
+                if (nb_ht_ < 2)
                 {
-                    if (offset_start_group_ < offset_ - 3)
-                    {
-                        // séparateur après la donnée
-                        char sep = frame_[offset_ - 2];
-
-                        int checksum = frame_[offset_ - 1];
-
-                        // calcul du checksum sur étiquette-séparateur-donnée
-                        // (mode de calcul n°1, cf. doc Enedis)
-                        int sum = 0;
-                        for (size_t i = offset_start_group_; i < offset_ - 2; ++i)
-                        {
-                            sum += frame_[i];
-
-                            if (frame_[i] == sep)
-                            {
-                                frame_[i] = 0;
-                                sep = -1; // valeur impossible, empêche un deuxième séparateur
-                            }
-                        }
-                        sum = (sum & 63) + 32;
-
-                        if (sum == checksum)
-                        {
-                            --offset_; // supprime le checksum
-
-                            // supprime les . qui terminent certaines valeurs (PTEC par exemple)
-                            while ((offset_ >= 2) && (frame_[offset_ - 2] == '.'))
-                            {
-                                --offset_;
-                            }
-
-                            frame_[offset_ - 1] = 0; // écrase le dernier séparateur avec 0
-
-                            state_ = wait_lf_or_etx;
-                        }
-                        else
-                        {
-                            // mauvais checksum: reinit
-                            state_ = wait_stx;
-                        }
-                    }
-                    else
-                    {
-                        // pas assez de caractères: reinit
-                        state_ = wait_stx;
-                    }
+                    ht_[nb_ht_] = offset_;
                 }
-                else
+                if (nb_ht_ < 4)
                 {
-                    // frame trop longue: reinit
-                    state_ = wait_stx;
+                    ++nb_ht_;
                 }
             }
-            else
+            else if (sp_ == NO_SEP)
+            {
+                sp_ = offset_;
+            }
+            in_label_ = false;
+            cur_->data[offset_++] = c;
+            sum_ += c;
+            break;
+
+        case action_end_group:
+            check_group();
+            break;
+
+        case action_end_frame:
+            state_ = wait_stx;
+            if (offset_ != 0)
             {
-                // mauvais état: reinit
-                state_ = wait_stx;
+                publish();
             }
+            return true;
+
+        case action_interrupt:
+            // cas d'interruption de la trame
+            ++stats_.interrupts;
+            state_ = wait_stx;
+            break;
+
+        case action_ignore:
+            break;
+
+        default:
+            // mauvais état: reinit
+            resync();
+            break;
+        }
+
+        return false;
+    }
+
+    // fin de groupe: vérifie le checksum et ajoute le groupe à l'index
+    // la somme, l'empreinte et les séparateurs ont été calculés à la réception des octets
+    void check_group()
+    {
+        // 4 octets au moins (STX-LF-groupe-crc) en début de trame
+        // 2 octets au moins pour finir la trame
+        if ((offset_ < 4) || (offset_ >= (MAX_FRAME_SIZE - 2)))
+        {
+            // frame trop longue: reinit
+            overflow();
+            return;
+        }
+
+        if (offset_start_group_ >= offset_ - 3)
+        {
+            // pas assez de caractères: reinit
+            resync();
+            return;
         }
-        else if (c == ETX)
+
+        // séparateur après la donnée:
+        // espace en mode historique, tabulation en mode standard
+        size_t end = offset_ - 2;
+        char sep = cur_->data[end];
+        bool standard = (sep == HT);
+        int checksum = cur_->data[offset_ - 1];
+
+        // checksum sur étiquette-séparateur-[horodatage-séparateur]-donnée
+        // mode de calcul n°1 (historique) ou n°2 (standard: avec le dernier séparateur),
+        // cf. doc Enedis
+        int sum = static_cast<uint16_t>(sum_ - checksum - (standard ? 0 : sep));
+        sum = (sum & 63) + 32;
+
+        // découpage des champs: toutes les tabulations en mode standard,
+        // seulement le premier espace en mode historique
+        size_t value = 0;
+        size_t date = 0;
+        bool valid = true;
+        if (standard)
         {
-            if (state_ == wait_lf_or_etx)
+            // la dernière tabulation est le séparateur avant le checksum
+            uint8_t fields = nb_ht_ - 1;
+            if (fields == 1)
             {
-                size_ = offset_;
-                state_ = wait_stx;
-                //validate_frame();
+                value = ht_[0] + 1;
+            }
+            else if (fields == 2)
+            {
+                // le premier champ était l'horodatage
+                date = ht_[0] + 1;
+                value = ht_[1] + 1;
             }
             else
             {
-                // reinit
-                state_ = wait_stx;
+                valid = false; // pas de valeur ou trop de séparateurs
             }
-        }
-        else if (c == EOT)
-        {
-            // cas d'interruption de la trame
-            state_ = wait_stx;
+
+            // l'empreinte s'arrête au premier séparateur, quel qu'il soit
+            valid = valid && (sp_ > ht_[0]);
         }
         else
         {
-            // caractère quelconque
-            if (state_ == wait_cr)
-            {
-                if (offset_ < MAX_FRAME_SIZE)
-                {
-                    frame_[offset_++] = c;
-                }
-                else
-                {
-                    // reinit
-                    state_ = wait_stx;
-                }
-            }
-            else
+            if (sp_ < end)
             {
-                // reinit
-                state_ = wait_stx;
+                value = sp_ + 1;
             }
+            valid = (sep == SP) && ((nb_ht_ == 0) || (ht_[0] > sp_));
+        }
+
+        // tous les groupes d'une trame sont dans le même mode
+        if (cur_->nb_groups == 0)
+        {
+            cur_->standard = standard;
+        }
+        else if (cur_->standard != standard)
+        {
+            valid = false;
+        }
+
+        if (sum != checksum)
+        {
+            // mauvais checksum: reinit
+            ++stats_.checksum_errors;
+            state_ = wait_stx;
+            lost_ = true;
+            return;
+        }
+
+        if (!valid || (value == 0))
+        {
+            // groupe mal formé: reinit
+            resync();
+            return;
+        }
+
+        // termine l'étiquette et l'horodatage
+        cur_->data[value - 1] = 0;
+        if (date != 0)
+        {
+            cur_->data[date - 1] = 0;
+        }
+
+        if (!cur_->add_group(hash_, offset_start_group_, value, date))
+        {
+            // trop de groupes: reinit
+            overflow();
+            return;
+        }
+
+        --offset_; // supprime le checksum
+
+        // supprime les . qui terminent certaines valeurs (PTEC par exemple)
+        while (!standard && (offset_ >= 2) && (cur_->data[offset_ - 2] == '.'))
+        {
+            --offset_;
+        }
+
+        cur_->data[offset_ - 1] = 0; // écrase le dernier séparateur avec 0
+
+        ++stats_.groups[standard ? 1 : 0];
+        state_ = wait_lf_or_etx;
+    }
+
+    // publie la trame complète et bascule sur l'autre buffer
+    void publish()
+    {
+        cur_->size = offset_;
+        cur_->sequence = ++sequence_;
+        cur_->compare(*frame_);
+        ++stats_.frames;
+        measure_interval();
+        frame_ = cur_;
+        cur_ = (cur_ == &frames_[0]) ? &frames_[1] : &frames_[0];
+        ready_ = true;
+    }
+
+    // erreur de réception: on attend le début de la trame suivante
+    // une perte de synchronisation ne compte qu'une fois jusqu'au STX suivant,
+    // les octets reçus hors trame sont comptés à part
+    void resync()
+    {
+        if (state_ == wait_stx)
+        {
+            ++stats_.stray_bytes;
+        }
+        if (!lost_)
+        {
+            ++stats_.resyncs;
+            lost_ = true;
+        }
+        state_ = wait_stx;
+    }
+
+    // trame trop longue pour le buffer ou l'index
+    void overflow()
+    {
+        state_ = wait_stx;
+        lost_ = true;
+        ++stats_.overflows;
+    }
+
+    // intervalle entre les débuts de la trame publiée et de la précédente
+    void measure_interval()
+    {
+        if (is_empty())
+        {
+            return;
+        }
+
+        // ignore les sauts d'horloge (synchronisation NTP notamment)
+        time_t sec = cur_->timestamp.tv_sec - frame_->timestamp.tv_sec;
+        if ((sec < 0) || (sec >= 3600))
+        {
+            return;
+        }
+
+        int32_t ms = sec * 1000 + (cur_->timestamp.tv_usec - frame_->timestamp.tv_usec) / 1000;
+        if (ms < 0)
+        {
+            return;
+        }
+
+        if ((stats_.intervals == 0) || (static_cast<uint32_t>(ms) < stats_.interval_min))
+        {
+            stats_.interval_min = ms;
+        }
+        if (static_cast<uint32_t>(ms) > stats_.interval_max)
+        {
+            stats_.interval_max = ms;
         }
+        stats_.interval_total += ms;
+        ++stats_.intervals;
     }
 };
@@ -3,13 +3,23 @@
 
 #include "wifinfo.h"
 #include "tic.h"
+#include "autobaud.h"
+#include "chunkedoutput.h"
 #include "config.h"
+#include "demand.h"
+#include "flashlog.h"
+#include "history.h"
 #include "httpreq.h"
 #include "jsonbuilder.h"
 #include "led.h"
+#include "lttb.h"
+#include "power.h"
 #include "sse.h"
 #include "strncpy_s.h"
+#include "tariff.h"
 #include "teleinfo.h"
+#include "ticdelta.h"
+#include "timeseries.h"
 #include <PolledTimeout.h>
 
 // les différente notifications que httpreq peut envoyer
@@ -29,7 +39,7 @@ enum Seuil
 
 extern SseClients sse_clients;
 
-static char periode_en_cours[8] = {0};
+static char periode_en_cours[17] = {0}; // PTEC ou LTARF
 static bool init_periode_en_cours = true;
 static Seuil seuil_en_cours = BAS;
 static bool etat_adps = false;
@@ -41,8 +51,62 @@ static esp8266::polledTimeout::periodicMs timer_sse(esp8266::polledTimeout::peri
 
 Teleinfo tinfo;
 static TeleinfoDecoder tinfo_decoder;
+static TeleinfoAutoBaud tinfo_autobaud;
+static EnergyHistory tic_history;
+
+// puissance estimée en dérivant les index d'énergie, sur 10 s, 1 min et 5 min
+static PowerEstimator tic_power{10, 60, 300};
+
+// cumuls horaires sauvegardés dans les derniers secteurs de la zone du filesystem,
+// que mkerfs32.py laisse hors de l'image ERFS (option --reserve, à garder en accord)
+#define TIC_FLASHLOG_SECTORS 4
+static FlashLog tic_flashlog(FS_PHYS_ADDR + FS_PHYS_SIZE - TIC_FLASHLOG_SECTORS * FLASH_SECTOR_SIZE, TIC_FLASHLOG_SECTORS);
+
+// dernières trames compressées dans 8 Ko: 2 à 4 octets par trame, soit 45 min à 1h30 de téléinformation,
+// à pleine résolution; l'historique sur plusieurs jours est celui de tic_history, par minute, heure et jour
+static TimeSeries<16, 512> tic_series;
+
+// consommation par période tarifaire, servie depuis un JSON recalculé quand elle a changé
+static TariffAccounting tic_tariff;
+static String tic_tariff_json;
+static bool tic_tariff_dirty = true;
+static uint16_t tic_tariff_prices[CFG_TARIFF_PRICES]; // prix ayant servi au JSON
+
+// puissances moyennes sur 10 et 30 minutes
+static DemandTracker tic_demand;
+
+// rendus JSON de la trame courante, construits à la première demande et partagés
+// par /json, /tinfo.json, /emoncms.json, SSE et httpreq jusqu'à la trame suivante
+enum TicJson : uint8_t
+{
+    TIC_JSON_DICT,
+    TIC_JSON_ARRAY,
+    TIC_JSON_EMONCMS,
+    TIC_JSON_COUNT
+};
+static String tic_json[TIC_JSON_COUNT];
+static const void *tic_json_frame[TIC_JSON_COUNT];  // trame rendue
+static uint32_t tic_json_sequence[TIC_JSON_COUNT]; // et son numéro
+static bool tic_json_valid[TIC_JSON_COUNT];        // rendu déjà construit (sans trame, frame est nul)
+static size_t tic_json_notif_pos = 0;              // où insérer "notif" dans le dict, 0 si dict vide
+
+// une trame a changé depuis le dernier envoi aux clients SSE
+static bool tic_sse_changed = false;
+static uint32_t tic_sse_sent = 0; // millis() du dernier envoi
+
+// différences avec la dernière trame envoyée aux clients SSE en mode delta
+static TeleinfoDelta tic_sse_delta(SSE_KEYFRAME_INTERVAL);
+
+static bool tic_standard = false; // mode de la dernière trame
 bool tinfo_pause = false;
 
+static_assert((TeleinfoAutoBaud::MODE_HISTORIQUE == TIC_MODE_HISTORIQUE) && (TeleinfoAutoBaud::MODE_STANDARD == TIC_MODE_STANDARD),
+              "TIC_MODE_*");
+
+static const String &tic_json_get(TicJson kind);
+static void tic_json_build_dict(String &data, const char *labels = nullptr);
+static void tic_json_build_emoncms(String &url);
+static bool tic_json_build_delta(String &data);
 static void tic_get_json_dict_notif(String &data, const char *notif);
 static void http_notif(const char *notif);
 static void http_notif_periode_en_cours();
@@ -51,37 +115,285 @@ static void http_notif_adps();
 static void jeedom_notif();
 static void emoncms_notif();
 
-void tic_decode(int c)
+// ajoute une mesure à l'historique, les heures terminées sont sauvegardées en flash
+static void tic_history_add(uint32_t time, uint32_t energy, uint16_t papp)
 {
-    if (tinfo_pause)
+    if (tic_history.add(time, energy, papp))
+    {
+        const EnergyHistory::Current &hour = tic_history.closed_hour();
+        tic_flashlog.append(hour.period, hour.energy, hour.peak);
+    }
+}
+
+// index heures creuses/pleines, puissance apparente et intensité de la trame
+static void tic_series_add()
+{
+    static const Label labels[2][TimeSample::NB_VALUES] = {
+        {Label::HCHC, Label::HCHP, Label::PAPP, Label::IINST},
+        {Label::EASF01, Label::EASF02, Label::SINSTS, Label::IRMS1},
+    };
+
+    bool standard = tinfo.is_standard();
+    TimeSample s;
+    s.sec = tinfo.get_timestamp();
+    s.ms = tinfo.get_timestamp_ms();
+    for (uint8_t i = 0; i < TimeSample::NB_VALUES; ++i)
+    {
+        s.values[i] = tinfo.get_value_int(labels[standard][i]);
+    }
+    tic_series.add(s);
+}
+
+// attribue la progression des index à leur période tarifaire
+static void tic_tariff_add()
+{
+    // index du mode historique, numérotés comme les index fournisseur du mode standard
+    static const struct
     {
+        Label label;
+        uint8_t period;
+        const char *name; // valeur de PTEC, sans les . que le décodeur supprime
+    } historique[] = {
+        {Label::BASE, 1, "TH"},
+        {Label::HCHC, 1, "HC"},
+        {Label::HCHP, 2, "HP"},
+        {Label::EJPHN, 1, "HN"},
+        {Label::EJPHPM, 2, "PM"},
+        {Label::BBRHCJB, 1, "HCJB"},
+        {Label::BBRHPJB, 2, "HPJB"},
+        {Label::BBRHCJW, 3, "HCJW"},
+        {Label::BBRHPJW, 4, "HPJW"},
+        {Label::BBRHCJR, 5, "HCJR"},
+        {Label::BBRHPJR, 6, "HPJR"},
+    };
+
+    time_t now = tinfo.get_timestamp();
+    if (now < static_cast<time_t>(EnergyHistory::MIN_TIME))
+    {
+        // l'horloge n'est pas encore à l'heure
         return;
     }
 
-    tinfo_decoder.put(c);
+    uint32_t index[TariffAccounting::NB_INDEX] = {0};
+    uint8_t active = 0;
 
-    if (tinfo_decoder.ready())
+    if (tinfo.is_standard())
     {
-        if (config.options & OPTION_LED_TINFO)
+        for (uint8_t i = 0; i < TariffAccounting::NB_INDEX; ++i)
         {
-            led_on();
+            index[i] = tinfo.get_value_int(static_cast<Label>(static_cast<uint8_t>(Label::EASF01) + i));
         }
-        tinfo.copy_from(tinfo_decoder);
+        active = tinfo.get_value_int(Label::NTARF);
+
+        // LTARF sans les espaces de cadrage
+        const char *ltarf = tinfo.get_value(Label::LTARF, "");
+        char name[TariffAccounting::NAME_LENGTH + 1];
+        while (*ltarf == ' ')
+        {
+            ++ltarf;
+        }
+        strncpy(name, ltarf, TariffAccounting::NAME_LENGTH);
+        name[TariffAccounting::NAME_LENGTH] = 0;
+        size_t len = strlen(name);
+        while ((len != 0) && (name[len - 1] == ' '))
+        {
+            name[--len] = 0;
+        }
+        tic_tariff.set_name(active, name);
+    }
+    else
+    {
+        const char *ptec = tinfo.get_value(Label::PTEC, "");
+        for (const auto &h : historique)
+        {
+            uint32_t wh = tinfo.get_value_int(h.label);
+            if (wh != 0)
+            {
+                index[h.period - 1] = wh;
+                tic_tariff.set_name(h.period, h.name);
+                if (strcmp(ptec, h.name) == 0)
+                {
+                    active = h.period;
+                }
+            }
+        }
+    }
+
+    if (tic_tariff.add(*localtime(&now), index, active))
+    {
+        tic_tariff_dirty = true;
+    }
+}
+
+// intègre la puissance apparente, et signale aux clients SSE la fin d'une fenêtre
+static void tic_demand_add()
+{
+    time_t now = tinfo.get_timestamp();
+    if (now < static_cast<time_t>(EnergyHistory::MIN_TIME))
+    {
+        return;
+    }
+
+    uint16_t va = tinfo.get_value_int(tinfo.is_standard() ? Label::SINSTS : Label::PAPP);
+    if (tic_demand.add(now, tinfo.get_timestamp_ms(), va, *localtime(&now)))
+    {
+        String data;
+        tic_get_demand_json(data, false);
+        sse_clients.handle_clients(&data, "demand");
+    }
+}
+
+// appelée quand le décodeur a reçu une trame complète
+static void tic_frame_ready()
+{
+    if (config.options & OPTION_LED_TINFO)
+    {
+        led_on();
+    }
+    tinfo.update_from(tinfo_decoder);
+
+    tic_power.add(static_cast<uint32_t>(tinfo.get_timestamp()) * 1000 + tinfo.get_timestamp_ms(), tinfo.energy());
+
+    if (tinfo.is_standard() != tic_standard)
+    {
+        // les grandeurs ne sont plus les mêmes
+        tic_standard = tinfo.is_standard();
+        tic_series.clear();
+        tic_tariff.clear();
+        tic_tariff_dirty = true;
+        tic_demand.clear();
+    }
+
+    tic_history_add(tinfo.get_timestamp(),
+                    tinfo.energy(),
+                    tinfo.get_value_int(tinfo.is_standard() ? Label::SINSTS : Label::PAPP));
+    tic_series_add();
+    tic_tariff_add();
+    tic_demand_add();
 
+    if (tinfo.is_standard())
+    {
+        Serial.printf("teleinfo: [%lu] %s  %s  %s\n",
+                      millis(),
+                      tinfo.get_value(Label::LTARF, "?"),
+                      tinfo.get_value(Label::EAST, "?"),
+                      tinfo.get_value(Label::SINSTS, "?"));
+    }
+    else
+    {
         Serial.printf("teleinfo: [%lu] %s  %s  %s  %s\n",
                       millis(),
-                      tinfo.get_value("PTEC", "?"),
-                      tinfo.get_value("HCHP", "?"),
-                      tinfo.get_value("HCHC", "?"),
-                      tinfo.get_value("PAPP", "?"));
+                      tinfo.get_value(Label::PTEC, "?"),
+                      tinfo.get_value(Label::HCHP, "?"),
+                      tinfo.get_value(Label::HCHC, "?"),
+                      tinfo.get_value(Label::PAPP, "?"));
+    }
+
+    tic_notifs();
+
+    if (config.options & OPTION_LED_TINFO)
+    {
+        led_off();
+    }
+}
+
+// un seul octet, par la même voie qu'un buffer (détection de la vitesse comprise)
+void tic_decode(int c)
+{
+    uint8_t b = c;
+    tic_decode_buffer(&b, 1);
+}
+
+// à appeler après le chargement de la configuration
+void tic_setup()
+{
+    // recharge l'historique par heure et par jour
+    tic_flashlog.begin();
+    size_t hours = tic_flashlog.replay([](const FlashLog::Record &r) {
+        tic_history.restore(r.period, r.energy, r.peak);
+    });
+    Serial.printf_P(PSTR("history: %zu heures\n"), hours);
+
+    if (config.tic_mode == TIC_MODE_AUTO)
+    {
+        // commence par le dernier mode détecté
+        tinfo_autobaud.start(config.tic_detected, tinfo_decoder.stats(), millis());
+    }
+}
+
+// change le mode de téléinformation: en passant en détection automatique,
+// celle-ci repart du dernier mode détecté
+void tic_set_mode(uint8_t mode)
+{
+    bool start = (mode == TIC_MODE_AUTO) && (config.tic_mode != TIC_MODE_AUTO);
+
+    config.tic_mode = mode;
+
+    if (start)
+    {
+        tinfo_autobaud.start(config.tic_detected, tinfo_decoder.stats(), millis());
+    }
+}
+
+// vitesse de la liaison série selon le mode de téléinformation configuré ou en cours de détection
+uint32_t tic_baudrate()
+{
+    if (config.tic_mode == TIC_MODE_AUTO)
+    {
+        return tinfo_autobaud.baudrate();
+    }
+    return TeleinfoAutoBaud::baudrate(config.tic_mode);
+}
+
+// détection automatique du mode, après chaque réception
+static void tic_autobaud()
+{
+    if (config.tic_mode != TIC_MODE_AUTO)
+    {
+        return;
+    }
+
+    if (tinfo_autobaud.update(tinfo_decoder.stats(), millis()))
+    {
+        Serial.printf_P(PSTR("autobaud: %u bauds\n"), tinfo_autobaud.baudrate());
+    }
+
+    if (tinfo_autobaud.locked() && (tinfo_autobaud.mode() != config.tic_detected))
+    {
+        // mémorise le mode pour le prochain démarrage
+        config.tic_detected = tinfo_autobaud.mode();
+        config_save();
+    }
+}
 
-        tic_notifs();
+// décode tout un buffer reçu de la liaison série
+// retourne le nombre de trames complètes
+size_t tic_decode_buffer(const uint8_t *buf, size_t len)
+{
+    size_t frames = 0;
 
-        if (config.options & OPTION_LED_TINFO)
+    if (tinfo_pause)
+    {
+        return 0;
+    }
+
+    while (len != 0)
+    {
+        // le décodeur rend la main après chaque fin de trame
+        size_t n = tinfo_decoder.put(buf, len);
+        buf += n;
+        len -= n;
+
+        if (tinfo_decoder.ready())
         {
-            led_off();
+            tic_frame_ready();
+            ++frames;
         }
     }
+
+    tic_autobaud();
+
+    return frames;
 }
 
 // appelée chaque fois qu'une trame de teleinfo valide est reçue
@@ -120,11 +432,31 @@ void tic_notifs()
         emoncms_notif();
     }
 
-    if (timer_sse && (sse_clients.count() != 0))
+    // sans changement depuis le dernier envoi, la trame n'est pas renvoyée aux clients SSE:
+    // le timer reste échu et la prochaine trame modifiée part aussitôt. Un changement
+    // survenu entre deux échéances est envoyé même si la trame suivante est identique.
+    // Un nouveau client reçoit tout de suite la trame, et elle repart au moins toutes
+    // les SSE_KEEPALIVE secondes pour que son horodatage montre que le compteur est là.
+    tic_sse_changed |= tinfo.has_changed();
+    if (sse_clients.has_delta_clients())
     {
-        String data;
-        tic_get_json_dict(data, false);
-        sse_clients.handle_clients(&data);
+        tic_sse_delta.add(tinfo);
+    }
+    else
+    {
+        tic_sse_delta.reset();
+    }
+
+    bool keepalive = (millis() - tic_sse_sent >= SSE_KEEPALIVE * 1000u);
+    if (sse_clients.has_new_client() || ((tic_sse_changed || keepalive) && timer_sse))
+    {
+        tic_sse_changed = false;
+        tic_sse_sent = millis();
+
+        String delta;
+        bool has_delta = sse_clients.has_delta_clients() && tic_json_build_delta(delta);
+
+        sse_clients.handle_clients(&tic_json_get(TIC_JSON_DICT), nullptr, tic_json_build_dict, has_delta ? &delta : nullptr);
     }
 }
 
@@ -179,35 +511,65 @@ void tic_make_timers()
     }
 }
 
-void tic_get_json_array(String &data, bool restricted __attribute__((unused)))
+static void tic_json_build_array(String &data)
 {
-    if (tinfo.is_empty())
-    {
-        data = "[]";
-        return;
-    }
-
     // la trame en JSON fait environ 360 à 373 octets selon ADPS pour un abo HC/HP
     JSONTableBuilder js(data, 400);
-    const char *label;
-    const char *value;
-    const char *state = nullptr;
 
-    js.append("timestamp", tinfo.get_timestamp_iso8601());
+    if (!tinfo.is_empty())
+    {
+        const char *label;
+        const char *value;
+        const char *state = nullptr;
 
-    // expérimental: la puissance en watt calculée sur la dernière minute
-    js.append("watt", tinfo.watt());
+        js.append("timestamp", tinfo.get_timestamp_iso8601());
 
-    while (tinfo.get_value_next(label, value, &state))
-    {
-        js.append(label, value);
+        // expérimental: la puissance en watt calculée sur la dernière minute
+        js.append("watt", tic_power.watt(60));
+
+        while (tinfo.get_value_next(label, value, &state))
+        {
+            js.append(label, value);
+        }
     }
 
     js.finalize();
 }
 
-static void tic_get_json_dict_notif(String &data, const char *notif)
+// rendus partagés de la trame courante, envoyés sans recopie
+const String &tic_get_json_array(bool restricted __attribute__((unused)))
+{
+    return tic_json_get(TIC_JSON_ARRAY);
+}
+
+// label fait-il partie de la liste list, séparée par des virgules ?
+static bool tic_label_listed(const char *label, const char *list)
+{
+    size_t len = strlen(label);
+    while (*list != 0)
+    {
+        const char *end = strchr(list, ',');
+        size_t n = (end == nullptr) ? strlen(list) : static_cast<size_t>(end - list);
+        if ((n == len) && (strncmp(label, list, n) == 0))
+        {
+            return true;
+        }
+        list += n;
+        if (*list == ',')
+        {
+            ++list;
+        }
+    }
+    return false;
+}
+
+// la trame en dict JSON, ou seulement les étiquettes de labels (projection SSE)
+static void tic_json_build_dict(String &data, const char *labels)
 {
+    if (labels == nullptr)
+    {
+        tic_json_notif_pos = 0;
+    }
 
     if (tinfo.is_empty())
     {
@@ -225,13 +587,18 @@ static void tic_get_json_dict_notif(String &data, const char *notif)
 
     js.append("seconds", tinfo.get_seconds().c_str());
 
-    if (notif != nullptr)
+    if (labels == nullptr)
     {
-        js.append("notif", notif);
+        tic_json_notif_pos = data.length() - 1; // avant le " du label suivant
     }
 
     while (tinfo.get_value_next(label, value, &state))
     {
+        if ((labels != nullptr) && !tic_label_listed(label, labels))
+        {
+            continue;
+        }
+
         bool is_number = tinfo.get_integer(value);
 
         if (is_number)
@@ -243,11 +610,415 @@ static void tic_get_json_dict_notif(String &data, const char *notif)
     js.finalize();
 }
 
+// les étiquettes modifiées depuis la dernière trame diffusée en SSE, comme le dict:
+// false s'il faut envoyer la trame complète
+static bool tic_json_build_delta(String &data)
+{
+    if (tinfo.is_empty())
+    {
+        tic_sse_delta.reset();
+        return false;
+    }
+
+    JSONBuilder js(data, 64);
+
+    js.append("timestamp", tinfo.get_timestamp_iso8601().c_str());
+
+    js.append("seconds", tinfo.get_seconds().c_str());
+
+    bool delta = tic_sse_delta.update(tinfo, [&js](const char *label, const char *value) {
+        if (Teleinfo::get_integer(value))
+            js.append_without_quote(label, value);
+        else
+            js.append(label, value);
+    });
+
+    js.finalize();
+    return delta;
+}
+
+// le dict de la trame avec "notif" après "seconds", sans refaire la sérialisation
+static void tic_get_json_dict_notif(String &data, const char *notif)
+{
+    const String &dict = tic_json_get(TIC_JSON_DICT);
+
+    if ((notif == nullptr) || (tic_json_notif_pos == 0))
+    {
+        data = dict;
+        return;
+    }
+
+    data.reserve(dict.length() + strlen(notif) + 12);
+    data = dict;
+    data.remove(tic_json_notif_pos, data.length() - tic_json_notif_pos);
+    data += "\"notif\":\"";
+    data += notif;
+    data += "\",";
+    data += dict.c_str() + tic_json_notif_pos;
+}
+
 void tic_get_json_dict(String &data, bool restricted __attribute__((unused)))
 {
     tic_get_json_dict_notif(data, nullptr);
 }
 
+const String &tic_get_json_dict(bool restricted __attribute__((unused)))
+{
+    return tic_json_get(TIC_JSON_DICT);
+}
+
+// retourne le rendu de la trame courante, construit s'il est d'une trame précédente
+static const String &tic_json_get(TicJson kind)
+{
+    String &data = tic_json[kind];
+
+    if (!tic_json_valid[kind] || (tic_json_frame[kind] != tinfo.get_frame_id()) ||
+        (tic_json_sequence[kind] != tinfo.get_sequence()))
+    {
+        data.clear();
+        switch (kind)
+        {
+        case TIC_JSON_DICT:
+            tic_json_build_dict(data);
+            break;
+        case TIC_JSON_ARRAY:
+            tic_json_build_array(data);
+            break;
+        default:
+            tic_json_build_emoncms(data);
+            break;
+        }
+        tic_json_frame[kind] = tinfo.get_frame_id();
+        tic_json_sequence[kind] = tinfo.get_sequence();
+        tic_json_valid[kind] = true;
+    }
+
+    return data;
+}
+
+// compteurs de réception de la liaison série, pour diagnostiquer une ligne bruitée
+void tic_get_stats_json(String &data, bool restricted __attribute__((unused)))
+{
+    const TeleinfoDecoder::Stats &stats = tinfo_decoder.stats();
+    JSONBuilder js(data, 320);
+
+    js.append("mode", tinfo.is_standard() ? "standard" : "historique");
+    js.append("baudrate", tic_baudrate());
+    js.append("bytes", stats.bytes);
+    js.append("frames", stats.frames);
+    js.append("groups", stats.groups[0] + stats.groups[1]);
+    js.append("checksum_errors", stats.checksum_errors);
+    js.append("overflows", stats.overflows);
+    js.append("resyncs", stats.resyncs);
+    js.append("stray_bytes", stats.stray_bytes);
+    js.append("interrupts", stats.interrupts);
+    js.append("interval_min", stats.interval_min);
+    js.append("interval_avg", stats.interval_avg());
+    js.append("interval_max", stats.interval_max, true);
+}
+
+// historique d'une résolution: énergies et puissances maximales à partir de la
+// date de début, la dernière période est celle en cours
+template <typename Output, typename Ring>
+static void tic_history_json(Output &data, const Ring &ring, EnergyHistory::Resolution res)
+{
+    const EnergyHistory::Current current = tic_history.current(res);
+    uint32_t duration = EnergyHistory::duration(res);
+    size_t count = ring.size();
+    uint32_t start = ((count != 0) ? ring.first_period() : current.period) * duration;
+
+    // 1440 minutes: plus de 15 Ko, à envoyer par morceaux
+    BasicJSONBuilder<Output> js(data, 64);
+    js.append("period", duration);
+    js.append("start", start);
+
+    // le builder termine par ," : on continue avec les tableaux
+    data.concat(F("energy\":["));
+    for (size_t i = 0; i < count; ++i)
+    {
+        data.concat(ring.energy(i));
+        data.concat(',');
+    }
+    data.concat(current.energy);
+
+    data.concat(F("],\"peak\":["));
+    for (size_t i = 0; i < count; ++i)
+    {
+        data.concat(ring.peak(i));
+        data.concat(',');
+    }
+    data.concat(static_cast<uint32_t>(current.peak));
+    data.concat(F("]}"));
+}
+
+// écrit en flash les cumuls horaires en attente, avant un redémarrage
+void tic_save_history()
+{
+    tic_flashlog.flush();
+}
+
+// résolution de l'historique demandée, false si elle est inconnue
+static bool tic_history_resolution(const String &res, EnergyHistory::Resolution &resolution)
+{
+    if ((res.length() == 0) || (res == "minute"))
+    {
+        resolution = EnergyHistory::MINUTE;
+    }
+    else if (res == "hour")
+    {
+        resolution = EnergyHistory::HOUR;
+    }
+    else if (res == "day")
+    {
+        resolution = EnergyHistory::DAY;
+    }
+    else
+    {
+        return false;
+    }
+    return true;
+}
+
+// historique de la consommation par minute, heure ou jour
+// retourne false si la résolution est inconnue
+template <typename Output>
+static bool tic_get_history_json(Output &data, const String &res)
+{
+    EnergyHistory::Resolution resolution;
+
+    if (!tic_history_resolution(res, resolution))
+    {
+        return false;
+    }
+
+    data.clear();
+    if (tic_history.is_empty())
+    {
+        data.concat("{}");
+    }
+    else if (resolution == EnergyHistory::MINUTE)
+    {
+        tic_history_json(data, tic_history.minutes(), resolution);
+    }
+    else if (resolution == EnergyHistory::HOUR)
+    {
+        tic_history_json(data, tic_history.hours(), resolution);
+    }
+    else
+    {
+        tic_history_json(data, tic_history.days(), resolution);
+    }
+    return true;
+}
+
+// interface pour webserver http://wifinfo/history.json?res=minute|hour|day, envoyé par morceaux
+// retourne false sans rien envoyer si la résolution est inconnue
+bool tic_send_history(ESP8266WebServer &server, const String &res)
+{
+    EnergyHistory::Resolution resolution;
+
+    if (!tic_history_resolution(res, resolution))
+    {
+        return false;
+    }
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, mime::mimeTable[mime::json].mimeType, "");
+
+    ChunkedOutput output(server);
+    tic_get_history_json(output, res);
+    output.end();
+    return true;
+}
+
+// énergies par période tarifaire: aujourd'hui, hier, mois en cours, et les coûts si les prix sont configurés
+// {"active":"HP","periods":["HC","HP"],"today":[1200,3400],"yesterday":[...],"month":[...],"cost":[0.6934,...]}
+static void tic_tariff_build_json(String &data)
+{
+    static const char *counters[TariffAccounting::NB_COUNTERS] = {"today", "yesterday", "month"};
+
+    data.reserve(256);
+    data = F("{\"active\":\"");
+    data.concat(tic_tariff.name(tic_tariff.active()));
+    data.concat(F("\",\"periods\":["));
+    bool first = true;
+    bool priced = false;
+    for (uint8_t period = 1; period <= TariffAccounting::NB_INDEX; ++period)
+    {
+        if (tic_tariff.has_period(period))
+        {
+            data.concat(first ? F("\"") : F(",\""));
+            data.concat(tic_tariff.name(period));
+            data.concat('"');
+            first = false;
+        }
+        priced |= (tic_tariff_prices[period - 1] != 0);
+    }
+    data.concat(']');
+
+    for (uint8_t c = 0; c < TariffAccounting::NB_COUNTERS; ++c)
+    {
+        data.concat(F(",\""));
+        data.concat(counters[c]);
+        data.concat(F("\":["));
+        first = true;
+        for (uint8_t period = 1; period <= TariffAccounting::NB_INDEX; ++period)
+        {
+            if (tic_tariff.has_period(period))
+            {
+                if (!first)
+                {
+                    data.concat(',');
+                }
+                data.concat(tic_tariff.energy(static_cast<TariffAccounting::Counter>(c), period));
+                first = false;
+            }
+        }
+        data.concat(']');
+    }
+
+    if (priced)
+    {
+        // coûts en euros, dans l'ordre des compteurs
+        data.concat(F(",\"cost\":["));
+        for (uint8_t c = 0; c < TariffAccounting::NB_COUNTERS; ++c)
+        {
+            uint64_t cost = tic_tariff.cost(static_cast<TariffAccounting::Counter>(c), tic_tariff_prices);
+            char buf[24];
+            snprintf(buf, sizeof(buf), "%s%lu.%04u", (c == 0) ? "" : ",",
+                     static_cast<unsigned long>(cost / 10000), static_cast<unsigned>(cost % 10000));
+            data.concat(buf);
+        }
+        data.concat(']');
+    }
+
+    data.concat('}');
+}
+
+void tic_get_tariff_json(String &data, bool restricted __attribute__((unused)))
+{
+    if (tic_tariff.is_empty())
+    {
+        data = "{}";
+        return;
+    }
+    if (tic_tariff_dirty || (memcmp(tic_tariff_prices, config.prices, sizeof(tic_tariff_prices)) != 0))
+    {
+        memcpy(tic_tariff_prices, config.prices, sizeof(tic_tariff_prices));
+        tic_tariff_build_json(tic_tariff_json);
+        tic_tariff_dirty = false;
+    }
+    data = tic_tariff_json;
+}
+
+static void tic_demand_peak_json(String &data, const DemandTracker::Peak &peak)
+{
+    data.concat(F("{\"time\":"));
+    data.concat(peak.time);
+    data.concat(F(",\"va\":"));
+    data.concat(static_cast<uint32_t>(peak.va));
+    data.concat('}');
+}
+
+// puissances apparentes moyennes sur 10 et 30 minutes et puissance souscrite en VA:
+// {"limit":6000,"windows":[{"period":600,"current":1890,"last":{"time":...,"va":...},"day":[...],"month":[...]},...]}
+void tic_get_demand_json(String &data, bool restricted __attribute__((unused)))
+{
+    static const char *scopes[DemandTracker::NB_SCOPES] = {"day", "month"};
+
+    if (tic_demand.is_empty())
+    {
+        data = "{}";
+        return;
+    }
+
+    // ISOUSC en A (200 VA par A), PREF en kVA
+    uint32_t limit = tinfo.is_standard() ? tinfo.get_value_int(Label::PREF) * 1000 : tinfo.get_value_int(Label::ISOUSC) * 200;
+
+    data.reserve(320);
+    data = F("{\"limit\":");
+    data.concat(limit);
+    data.concat(F(",\"windows\":["));
+    for (uint8_t i = 0; i < DemandTracker::NB_WINDOWS; ++i)
+    {
+        data.concat((i == 0) ? F("{\"period\":") : F(",{\"period\":"));
+        data.concat(static_cast<uint32_t>(tic_demand.seconds(i)));
+        data.concat(F(",\"current\":"));
+        data.concat(static_cast<uint32_t>(tic_demand.current(i)));
+        data.concat(F(",\"last\":"));
+        tic_demand_peak_json(data, tic_demand.last(i));
+
+        for (uint8_t scope = 0; scope < DemandTracker::NB_SCOPES; ++scope)
+        {
+            const DemandTracker::Peak *top = tic_demand.top(i, static_cast<DemandTracker::Scope>(scope));
+            data.concat(F(",\""));
+            data.concat(scopes[scope]);
+            data.concat(F("\":["));
+            for (uint8_t k = 0; (k < DemandTracker::TOP) && (top[k].va != 0); ++k)
+            {
+                if (k != 0)
+                {
+                    data.concat(',');
+                }
+                tic_demand_peak_json(data, top[k]);
+            }
+            data.concat(']');
+        }
+        data.concat('}');
+    }
+    data.concat(F("]}"));
+}
+
+// envoie les dernières trames en JSON, décompressées au fil de l'envoi par morceaux d'1 Ko:
+// {"labels":["HCHC","HCHP","PAPP","IINST"],"samples":[[date,HCHC,HCHP,PAPP,IINST],...]}
+// points limite le nombre de trames, choisies sur la puissance apparente (0: toutes)
+void tic_send_series(ESP8266WebServer &server, size_t points)
+{
+    static const size_t CHUNK_SIZE = 1024;
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, mime::mimeTable[mime::json].mimeType, "");
+
+    String chunk;
+    chunk.reserve(CHUNK_SIZE + 64);
+    if (tic_standard)
+    {
+        chunk = F("{\"labels\":[\"EASF01\",\"EASF02\",\"SINSTS\",\"IRMS1\"],\"samples\":[");
+    }
+    else
+    {
+        chunk = F("{\"labels\":[\"HCHC\",\"HCHP\",\"PAPP\",\"IINST\"],\"samples\":[");
+    }
+
+    bool first = true;
+    auto send = [&](const TimeSample &s) {
+        char buf[80];
+        snprintf(buf, sizeof(buf), "%s[%" PRIu32 ".%03u,%" PRIu32 ",%" PRIu32 ",%" PRIu32 ",%" PRIu32 "]",
+                 first ? "" : ",",
+                 s.sec, s.ms, s.values[0], s.values[1], s.values[2], s.values[3]);
+        first = false;
+        chunk.concat(buf);
+        if (chunk.length() >= CHUNK_SIZE)
+        {
+            server.sendContent(chunk);
+            chunk = "";
+        }
+    };
+
+    if (points == 0)
+    {
+        tic_series.for_each(send);
+    }
+    else
+    {
+        lttb(tic_series, points, 2, send);
+    }
+
+    chunk.concat(F("]}"));
+    server.sendContent(chunk);
+    server.sendContent("");
+}
+
 // interface pour webserver http://wifinfo/<ETIQUETTE>
 const char *tic_get_value(const char *label)
 {
@@ -255,7 +1026,7 @@ const char *tic_get_value(const char *label)
 
     if (strcmp(label, "watt") == 0)
     {
-        buf = String(tinfo.watt());
+        buf = String(tic_power.watt(60));
         return buf.c_str();
     }
     if (strcmp(label, "seconds") == 0)
@@ -379,7 +1150,7 @@ static void http_notif(const char *notif)
 
 static void http_notif_periode_en_cours()
 {
-    const char *PTEC = tinfo.get_value("PTEC");
+    const char *PTEC = tinfo.get_value(tinfo.is_standard() ? Label::LTARF : Label::PTEC);
     if (PTEC == NULL)
     {
         return;
@@ -403,7 +1174,7 @@ static void http_notif_periode_en_cours()
 
 static void http_notif_adps()
 {
-    const char *ADPS = tinfo.get_value("ADPS");
+    const char *ADPS = tinfo.get_value(Label::ADPS);
 
     if (ADPS == NULL)
     {
@@ -427,7 +1198,7 @@ static void http_notif_adps()
 
 static void http_notif_seuils()
 {
-    const char *PAPP = tinfo.get_value("PAPP");
+    const char *PAPP = tinfo.get_value(tinfo.is_standard() ? Label::SINSTS : Label::PAPP);
     if (PAPP == NULL)
     {
         return;
@@ -473,7 +1244,7 @@ static void jeedom_notif()
 
     while (tinfo.get_value_next(label, value, &state))
     {
-        if (strcmp(label, "ADCO") == 0)
+        if (tic_label_find(label) == Label::ADCO)
         {
             // Config identifiant forcée ?
             if (config.jeedom.adco[0] != 0)
@@ -492,7 +1263,7 @@ static void jeedom_notif()
 }
 
 // construct the JSON (without " ???) part of emoncms url
-void tic_emoncms_data(String &url, bool restricted __attribute__((unused)))
+static void tic_json_build_emoncms(String &url)
 {
     const char *label;
     const char *value;
@@ -503,6 +1274,8 @@ void tic_emoncms_data(String &url, bool restricted __attribute__((unused)))
 
     while (tinfo.get_value_next(label, value, &state))
     {
+        Label id = tic_label_find(label);
+
         // On first item, do not add , separator
         if (first_item)
         {
@@ -519,7 +1292,7 @@ void tic_emoncms_data(String &url, bool restricted __attribute__((unused)))
         // EMONCMS ne sait traiter que des valeurs numériques, donc ici il faut faire une
         // table de mappage, tout à fait arbitraire, mais c"est celle-ci dont je me sers
         // depuis mes débuts avec la téléinfo
-        if (!strcmp(label, "OPTARIF"))
+        if (id == Label::OPTARIF)
         {
             // L'option tarifaire choisie (Groupe "OPTARIF") est codée sur 4 caractères alphanumériques
             /* J'ai pris un nombre arbitraire codé dans l'ordre ci-dessous
@@ -552,14 +1325,14 @@ void tic_emoncms_data(String &url, bool restricted __attribute__((unused)))
                 url += "0";
             }
         }
-        else if (!strcmp(label, "HHPHC"))
+        else if (id == Label::HHPHC)
         {
             // L'horaire heures pleines/heures creuses (Groupe "HHPHC") est codé par un caractère A à Y
             // J'ai choisi de prendre son code ASCII
             int code = *value;
             url += String(code);
         }
-        else if (!strcmp(label, "PTEC"))
+        else if (id == Label::PTEC)
         {
             // La période tarifaire en cours (Groupe "PTEC"), est codée sur 4 caractères
             /* J'ai pris un nombre arbitraire codé dans l'ordre ci-dessous
@@ -634,6 +1407,11 @@ void tic_emoncms_data(String &url, bool restricted __attribute__((unused)))
     url += "}";
 }
 
+void tic_emoncms_data(String &url, bool restricted __attribute__((unused)))
+{
+    url += tic_json_get(TIC_JSON_EMONCMS);
+}
+
 // emoncmsPost (called by main sketch on timer, if activated)
 static void emoncms_notif()
 {
@@ -669,8 +1447,40 @@ static void emoncms_notif()
 
 void tic_dump()
 {
-    char raw[Teleinfo::MAX_FRAME_SIZE];
-    tinfo.get_frame_ascii(raw, sizeof(raw));
+    const char *label;
+    const char *value;
+    const char *date;
+    const char *state = nullptr;
+
     Serial.println(tinfo.get_timestamp_iso8601());
-    Serial.println(raw);
+    Serial.println(tinfo.is_standard() ? F("mode standard") : F("mode historique"));
+
+    while (tinfo.get_value_next(label, value, &state, &date))
+    {
+        // l'unité est en flash: on la recopie en RAM pour printf
+        String unit;
+        PGM_P unit_P = tic_label_unit(tic_label_find(label));
+        if (unit_P != nullptr)
+        {
+            unit = FPSTR(unit_P);
+        }
+
+        Serial.printf_P(PSTR("%-10s %s %s%s%s\n"),
+                        label,
+                        value,
+                        unit.c_str(),
+                        date ? "  " : "",
+                        date ? date : "");
+    }
+
+    Serial.printf_P(PSTR("puissance: %u W (r² %u‰), %u W (r² %u‰) sur 10 s et 300 s\n"),
+                    tic_power.watt(10), tic_power.quality(10), tic_power.watt(300), tic_power.quality(300));
+
+    const TeleinfoDecoder::Stats &stats = tinfo_decoder.stats();
+    Serial.printf_P(PSTR("réception: %u bauds, %u octets, %u trames, %u+%u groupes\n"),
+                    tic_baudrate(), stats.bytes, stats.frames, stats.groups[0], stats.groups[1]);
+    Serial.printf_P(PSTR("erreurs: checksum %u, débordements %u, resync %u (%u octets hors trame), EOT %u\n"),
+                    stats.checksum_errors, stats.overflows, stats.resyncs, stats.stray_bytes, stats.interrupts);
+    Serial.printf_P(PSTR("intervalle: min %u ms, moy %u ms, max %u ms\n"),
+                    stats.interval_min, stats.interval_avg(), stats.interval_max);
 }
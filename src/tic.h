@@ -4,15 +4,27 @@
 #pragma once
 
 #include <Arduino.h>
+#include <ESP8266WebServer.h>
 
 void tic_decode(int c);
+size_t tic_decode_buffer(const uint8_t *buf, size_t len);
+void tic_setup();
+void tic_set_mode(uint8_t mode);
+uint32_t tic_baudrate();
 void tic_make_timers();
 void tic_notifs();
 
 const char *tic_get_value(const char *label);
-void tic_get_json_array(String &html, bool restricted);
+const String &tic_get_json_array(bool restricted);
 void tic_get_json_dict(String &html, bool restricted);
+const String &tic_get_json_dict(bool restricted);
 void tic_emoncms_data(String &url, bool restricted);
+void tic_get_stats_json(String &data, bool restricted);
+bool tic_send_history(ESP8266WebServer &server, const String &res);
+void tic_save_history();
+void tic_get_tariff_json(String &data, bool restricted);
+void tic_get_demand_json(String &data, bool restricted);
+void tic_send_series(ESP8266WebServer &server, size_t points);
 
 void tic_dump();
 
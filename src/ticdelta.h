@@ -0,0 +1,105 @@
+/*
+ * librairie Teleinfo: différences entre trames
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include "teleinfo.h"
+
+// Différences d'une trame avec la dernière trame diffusée, qui n'est pas forcément
+// la précédente reçue: add() cumule les étiquettes que le décodeur a marquées
+// modifiées dans chaque trame (cf. TeleinfoFrame::compare), update() les rend et
+// repart de zéro.
+//
+// Seules les étiquettes connues sont suivies, par leur identifiant: une étiquette
+// inconnue modifiée, une étiquette disparue ou une trame manquée demandent une trame
+// complète. Il en faut une aussi pour la première trame et toutes les
+// keyframe_interval trames, pour qu'un client qui aurait mal appliqué une
+// différence se resynchronise.
+class TeleinfoDelta
+{
+    uint8_t changed_[(TIC_LABEL_COUNT + 7) / 8]; // étiquettes modifiées depuis la dernière trame diffusée
+    uint32_t sequence_;                          // dernière trame cumulée
+    bool valid_;                                 // une trame a été diffusée, changed_ est à jour
+    uint16_t frames_;                            // différences depuis la dernière trame complète
+    uint16_t keyframe_interval_;
+
+public:
+    explicit TeleinfoDelta(uint16_t keyframe_interval) : sequence_(0), valid_(false), frames_(0), keyframe_interval_(keyframe_interval)
+    {
+        memset(changed_, 0, sizeof(changed_));
+    }
+
+    // la prochaine trame sera complète
+    void reset()
+    {
+        valid_ = false;
+    }
+
+    // cumule les étiquettes modifiées de la trame, à appeler pour chaque trame reçue
+    void add(const Teleinfo &tinfo)
+    {
+        uint32_t sequence = tinfo.get_sequence();
+        if (sequence == sequence_)
+        {
+            return; // déjà vue
+        }
+
+        if ((sequence != sequence_ + 1) || (tinfo.get_nb_removed() != 0))
+        {
+            valid_ = false;
+        }
+        sequence_ = sequence;
+
+        if (!valid_ || (tinfo.get_nb_changed() == 0))
+        {
+            return;
+        }
+
+        const char *label;
+        const char *value;
+        for (uint8_t i = 0; i < tinfo.get_nb_groups(); ++i)
+        {
+            if (tinfo.is_group_changed(i))
+            {
+                Label id = tinfo.get_group(i, label, value);
+                if (id == Label::unknown)
+                {
+                    valid_ = false;
+                    return;
+                }
+                changed_[static_cast<size_t>(id) / 8] |= 1 << (static_cast<size_t>(id) % 8);
+            }
+        }
+    }
+
+    // appelle changed(label, value) pour chaque groupe nouveau ou modifié depuis la
+    // dernière trame diffusée, puis retient celle-ci: false s'il faut une trame complète,
+    // les appels à changed() sont alors à ignorer
+    template <typename F>
+    bool update(const Teleinfo &tinfo, F changed)
+    {
+        add(tinfo);
+
+        bool delta = valid_ && (frames_ < keyframe_interval_) && !tinfo.is_empty();
+
+        if (delta)
+        {
+            const char *label;
+            const char *value;
+            for (uint8_t i = 0; i < tinfo.get_nb_groups(); ++i)
+            {
+                size_t id = static_cast<size_t>(tinfo.get_group(i, label, value));
+                if ((id < TIC_LABEL_COUNT) && ((changed_[id / 8] & (1 << (id % 8))) != 0))
+                {
+                    changed(label, value);
+                }
+            }
+        }
+
+        memset(changed_, 0, sizeof(changed_));
+        valid_ = !tinfo.is_empty();
+        frames_ = delta ? frames_ + 1 : 0;
+        return delta;
+    }
+};
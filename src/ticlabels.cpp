@@ -0,0 +1,112 @@
+// module téléinformation client
+// rene-d 2020
+
+#include "ticlabels.h"
+
+namespace
+{
+
+struct LabelInfo
+{
+    char name[10]; // SMAXSN1-1 est la plus longue étiquette
+    uint16_t hash;
+    LabelType type;
+    char unit[5];
+};
+
+// table des étiquettes, indexée par Label
+#define TIC_LABEL_INFO(id, name, type, unit) {name, tic_label_hash(name), LabelType::type, unit},
+
+const LabelInfo tic_labels_table[TIC_LABEL_COUNT] PROGMEM = {TIC_LABELS(TIC_LABEL_INFO)};
+
+#undef TIC_LABEL_INFO
+
+// index par empreinte, calculé à la compilation
+const size_t TIC_LABEL_BUCKETS = 32; // puissance de 2
+const uint8_t TIC_LABEL_NONE = 0xFF;
+
+struct LabelBuckets
+{
+    uint8_t first[TIC_LABEL_BUCKETS];
+    uint8_t next[TIC_LABEL_COUNT];
+};
+
+#define TIC_LABEL_HASH(id, name, type, unit) tic_label_hash(name),
+
+constexpr uint16_t tic_labels_hashes[TIC_LABEL_COUNT] = {TIC_LABELS(TIC_LABEL_HASH)};
+
+#undef TIC_LABEL_HASH
+
+constexpr LabelBuckets tic_labels_make_buckets()
+{
+    LabelBuckets b{};
+
+    for (size_t i = 0; i < TIC_LABEL_BUCKETS; ++i)
+    {
+        b.first[i] = TIC_LABEL_NONE;
+    }
+
+    // insertion en tête: on parcourt à l'envers pour garder l'ordre de la table
+    for (size_t i = TIC_LABEL_COUNT; i-- > 0;)
+    {
+        size_t bucket = tic_labels_hashes[i] & (TIC_LABEL_BUCKETS - 1);
+        b.next[i] = b.first[bucket];
+        b.first[bucket] = static_cast<uint8_t>(i);
+    }
+
+    return b;
+}
+
+const LabelBuckets tic_labels_buckets PROGMEM = tic_labels_make_buckets();
+
+} // namespace
+
+static_assert(TIC_LABEL_COUNT < TIC_LABEL_NONE, "trop d'étiquettes");
+
+// recherche une étiquette connue à partir de son nom et de son empreinte
+Label tic_label_find(const char *label, uint16_t hash)
+{
+    uint8_t i = pgm_read_byte(&tic_labels_buckets.first[hash & (TIC_LABEL_BUCKETS - 1)]);
+    while (i != TIC_LABEL_NONE)
+    {
+        const LabelInfo &info = tic_labels_table[i];
+        if ((pgm_read_word(&info.hash) == hash) && (strcmp_P(label, info.name) == 0))
+        {
+            return static_cast<Label>(i);
+        }
+        i = pgm_read_byte(&tic_labels_buckets.next[i]);
+    }
+    return Label::unknown;
+}
+
+Label tic_label_find(const char *label)
+{
+    return tic_label_find(label, tic_label_hash(label));
+}
+
+PGM_P tic_label_name(Label id)
+{
+    if (id >= Label::unknown)
+    {
+        return nullptr;
+    }
+    return tic_labels_table[static_cast<size_t>(id)].name;
+}
+
+LabelType tic_label_type(Label id)
+{
+    if (id >= Label::unknown)
+    {
+        return LabelType::text;
+    }
+    return static_cast<LabelType>(pgm_read_byte(&tic_labels_table[static_cast<size_t>(id)].type));
+}
+
+PGM_P tic_label_unit(Label id)
+{
+    if (id >= Label::unknown)
+    {
+        return nullptr;
+    }
+    return tic_labels_table[static_cast<size_t>(id)].unit;
+}
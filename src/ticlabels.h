@@ -0,0 +1,156 @@
+// module téléinformation client
+// rene-d 2020
+
+// dictionnaire des étiquettes de téléinformation (modes historique et standard)
+// cf. documentations Enedis-NOI-CPT_02E et Enedis-NOI-CPT_54E
+
+#pragma once
+
+#include <Arduino.h>
+
+// X(identifiant, étiquette, type, unité)
+#define TIC_LABELS(X)                       \
+    /* mode historique */                   \
+    X(ADCO, "ADCO", text, "")               \
+    X(OPTARIF, "OPTARIF", text, "")         \
+    X(ISOUSC, "ISOUSC", numeric, "A")       \
+    X(BASE, "BASE", numeric, "Wh")          \
+    X(HCHC, "HCHC", numeric, "Wh")          \
+    X(HCHP, "HCHP", numeric, "Wh")          \
+    X(EJPHN, "EJPHN", numeric, "Wh")        \
+    X(EJPHPM, "EJPHPM", numeric, "Wh")      \
+    X(BBRHCJB, "BBRHCJB", numeric, "Wh")    \
+    X(BBRHPJB, "BBRHPJB", numeric, "Wh")    \
+    X(BBRHCJW, "BBRHCJW", numeric, "Wh")    \
+    X(BBRHPJW, "BBRHPJW", numeric, "Wh")    \
+    X(BBRHCJR, "BBRHCJR", numeric, "Wh")    \
+    X(BBRHPJR, "BBRHPJR", numeric, "Wh")    \
+    X(PEJP, "PEJP", numeric, "min")         \
+    X(PTEC, "PTEC", text, "")               \
+    X(DEMAIN, "DEMAIN", text, "")           \
+    X(IINST, "IINST", numeric, "A")         \
+    X(IINST1, "IINST1", numeric, "A")       \
+    X(IINST2, "IINST2", numeric, "A")       \
+    X(IINST3, "IINST3", numeric, "A")       \
+    X(ADPS, "ADPS", numeric, "A")           \
+    X(ADIR1, "ADIR1", numeric, "A")         \
+    X(ADIR2, "ADIR2", numeric, "A")         \
+    X(ADIR3, "ADIR3", numeric, "A")         \
+    X(IMAX, "IMAX", numeric, "A")           \
+    X(IMAX1, "IMAX1", numeric, "A")         \
+    X(IMAX2, "IMAX2", numeric, "A")         \
+    X(IMAX3, "IMAX3", numeric, "A")         \
+    X(PMAX, "PMAX", numeric, "W")           \
+    X(PAPP, "PAPP", numeric, "VA")          \
+    X(HHPHC, "HHPHC", text, "")             \
+    X(MOTDETAT, "MOTDETAT", text, "")       \
+    X(PPOT, "PPOT", text, "")               \
+    /* mode standard */                     \
+    X(ADSC, "ADSC", text, "")               \
+    X(VTIC, "VTIC", text, "")               \
+    X(DATE, "DATE", date, "")               \
+    X(NGTF, "NGTF", text, "")               \
+    X(LTARF, "LTARF", text, "")             \
+    X(EAST, "EAST", numeric, "Wh")          \
+    X(EASF01, "EASF01", numeric, "Wh")      \
+    X(EASF02, "EASF02", numeric, "Wh")      \
+    X(EASF03, "EASF03", numeric, "Wh")      \
+    X(EASF04, "EASF04", numeric, "Wh")      \
+    X(EASF05, "EASF05", numeric, "Wh")      \
+    X(EASF06, "EASF06", numeric, "Wh")      \
+    X(EASF07, "EASF07", numeric, "Wh")      \
+    X(EASF08, "EASF08", numeric, "Wh")      \
+    X(EASF09, "EASF09", numeric, "Wh")      \
+    X(EASF10, "EASF10", numeric, "Wh")      \
+    X(EASD01, "EASD01", numeric, "Wh")      \
+    X(EASD02, "EASD02", numeric, "Wh")      \
+    X(EASD03, "EASD03", numeric, "Wh")      \
+    X(EASD04, "EASD04", numeric, "Wh")      \
+    X(EAIT, "EAIT", numeric, "Wh")          \
+    X(ERQ1, "ERQ1", numeric, "VArh")        \
+    X(ERQ2, "ERQ2", numeric, "VArh")        \
+    X(ERQ3, "ERQ3", numeric, "VArh")        \
+    X(ERQ4, "ERQ4", numeric, "VArh")        \
+    X(IRMS1, "IRMS1", numeric, "A")         \
+    X(IRMS2, "IRMS2", numeric, "A")         \
+    X(IRMS3, "IRMS3", numeric, "A")         \
+    X(URMS1, "URMS1", numeric, "V")         \
+    X(URMS2, "URMS2", numeric, "V")         \
+    X(URMS3, "URMS3", numeric, "V")         \
+    X(PREF, "PREF", numeric, "kVA")         \
+    X(PCOUP, "PCOUP", numeric, "kVA")       \
+    X(SINSTS, "SINSTS", numeric, "VA")      \
+    X(SINSTS1, "SINSTS1", numeric, "VA")    \
+    X(SINSTS2, "SINSTS2", numeric, "VA")    \
+    X(SINSTS3, "SINSTS3", numeric, "VA")    \
+    X(SMAXSN, "SMAXSN", numeric, "VA")      \
+    X(SMAXSN1, "SMAXSN1", numeric, "VA")    \
+    X(SMAXSN2, "SMAXSN2", numeric, "VA")    \
+    X(SMAXSN3, "SMAXSN3", numeric, "VA")    \
+    X(SMAXSN_1, "SMAXSN-1", numeric, "VA")  \
+    X(SMAXSN1_1, "SMAXSN1-1", numeric, "VA") \
+    X(SMAXSN2_1, "SMAXSN2-1", numeric, "VA") \
+    X(SMAXSN3_1, "SMAXSN3-1", numeric, "VA") \
+    X(SINSTI, "SINSTI", numeric, "VA")      \
+    X(SMAXIN, "SMAXIN", numeric, "VA")      \
+    X(SMAXIN_1, "SMAXIN-1", numeric, "VA")  \
+    X(CCASN, "CCASN", numeric, "W")         \
+    X(CCASN_1, "CCASN-1", numeric, "W")     \
+    X(CCAIN, "CCAIN", numeric, "W")         \
+    X(CCAIN_1, "CCAIN-1", numeric, "W")     \
+    X(UMOY1, "UMOY1", numeric, "V")         \
+    X(UMOY2, "UMOY2", numeric, "V")         \
+    X(UMOY3, "UMOY3", numeric, "V")         \
+    X(STGE, "STGE", text, "")               \
+    X(DPM1, "DPM1", date, "")               \
+    X(FPM1, "FPM1", date, "")               \
+    X(DPM2, "DPM2", date, "")               \
+    X(FPM2, "FPM2", date, "")               \
+    X(DPM3, "DPM3", date, "")               \
+    X(FPM3, "FPM3", date, "")               \
+    X(MSG1, "MSG1", text, "")               \
+    X(MSG2, "MSG2", text, "")               \
+    X(PRM, "PRM", text, "")                 \
+    X(RELAIS, "RELAIS", numeric, "")        \
+    X(NTARF, "NTARF", numeric, "")          \
+    X(NJOURF, "NJOURF", numeric, "")        \
+    X(NJOURF_1, "NJOURF+1", numeric, "")    \
+    X(PJOURF_1, "PJOURF+1", text, "")       \
+    X(PPOINTE, "PPOINTE", text, "")
+
+#define TIC_LABEL_ENUM(id, name, type, unit) id,
+
+// identifiant des étiquettes connues
+enum class Label : uint8_t
+{
+    TIC_LABELS(TIC_LABEL_ENUM)
+    unknown
+};
+
+#undef TIC_LABEL_ENUM
+
+static const size_t TIC_LABEL_COUNT = static_cast<size_t>(Label::unknown);
+
+enum class LabelType : uint8_t
+{
+    numeric, // valeur entière
+    text,    // chaîne de caractères
+    date,    // l'information est dans l'horodatage
+};
+
+// empreinte d'une étiquette (djb2 en 16 bits)
+static constexpr uint16_t tic_label_hash(const char *label)
+{
+    uint16_t h = 5381;
+    while (*label)
+    {
+        h = (h * 33) ^ static_cast<uint8_t>(*label++);
+    }
+    return h;
+}
+
+Label tic_label_find(const char *label, uint16_t hash);
+Label tic_label_find(const char *label);
+PGM_P tic_label_name(Label id);
+LabelType tic_label_type(Label id);
+PGM_P tic_label_unit(Label id);
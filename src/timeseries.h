@@ -0,0 +1,351 @@
+/*
+ * librairie Teleinfo: série temporelle compressée
+ * Copyright (c) 2020 rene-d. All right reserved.
+ */
+#pragma once
+
+#include <Arduino.h>
+
+// mesures d'une trame
+struct TimeSample
+{
+    enum : uint8_t
+    {
+        NB_VALUES = 4
+    };
+
+    uint32_t sec;               // date en secondes
+    uint16_t ms;                // et millisecondes
+    uint32_t values[NB_VALUES]; // index, puissance apparente, intensité...
+};
+
+// Série temporelle compressée à la manière de Gorilla (Facebook, 2015), adaptée
+// à des grandeurs entières: la date est codée par la variation de l'écart entre
+// deux trames (delta-of-delta), chaque grandeur par sa variation depuis la trame
+// précédente. Les index ne bougent presque jamais d'une trame à l'autre et ne
+// coûtent qu'un bit, la puissance et l'intensité une dizaine.
+//
+// Les codes sont préfixés par leur taille:
+//  date      0: pas de variation      grandeur  0: identique
+//            10 + 7 bits                        10 + 4 bits
+//            110 + 10 bits                      110 + 8 bits
+//            1110 + 16 bits                     1110 + 16 bits
+//            1111 + 32 bits                     1111 + 32 bits
+// les variations signées sont repliées en entiers positifs (zigzag).
+//
+// La série est découpée en blocs de taille fixe qui se décodent indépendamment:
+// chaque bloc commence par une trame complète, et le plus ancien est recyclé
+// quand tous sont remplis.
+template <size_t BLOCKS, size_t BLOCK_SIZE>
+class TimeSeries
+{
+    struct block
+    {
+        uint32_t sec;   // date de la première trame
+        uint16_t count; // nombre de trames
+        uint16_t bits;  // bits utilisés
+    };
+
+    uint8_t data_[BLOCKS][BLOCK_SIZE];
+    block blocks_[BLOCKS];
+    uint16_t first_{0}; // plus ancien bloc
+    uint16_t used_{0};  // blocs utilisés
+
+    // état du codeur pour le dernier bloc
+    uint32_t prev_time_{0};  // date en ms depuis le début du bloc
+    uint32_t prev_delta_{0}; // écart en ms avec la trame précédente
+    uint32_t prev_values_[TimeSample::NB_VALUES];
+
+    static uint32_t zigzag(int32_t v)
+    {
+        return (static_cast<uint32_t>(v) << 1) ^ static_cast<uint32_t>(v >> 31);
+    }
+
+    static int32_t unzigzag(uint32_t v)
+    {
+        return static_cast<int32_t>(v >> 1) ^ -static_cast<int32_t>(v & 1);
+    }
+
+    // écrit n bits (n <= 32), poids fort en tête
+    static void put_bits(uint8_t *buf, uint16_t &pos, uint32_t value, uint8_t n)
+    {
+        while (n != 0)
+        {
+            uint8_t room = 8 - (pos & 7);
+            uint8_t k = (n < room) ? n : room;
+            uint8_t chunk = (value >> (n - k)) & ((1u << k) - 1);
+            uint8_t &b = buf[pos >> 3];
+            if ((pos & 7) == 0)
+            {
+                b = 0;
+            }
+            b |= chunk << (room - k);
+            pos += k;
+            n -= k;
+        }
+    }
+
+    static uint32_t get_bits(const uint8_t *buf, uint16_t &pos, uint8_t n)
+    {
+        uint32_t value = 0;
+        while (n != 0)
+        {
+            uint8_t room = 8 - (pos & 7);
+            uint8_t k = (n < room) ? n : room;
+            uint8_t chunk = (buf[pos >> 3] >> (room - k)) & ((1u << k) - 1);
+            value = (value << k) | chunk;
+            pos += k;
+            n -= k;
+        }
+        return value;
+    }
+
+    // code à préfixe: 0, 10, 110, 1110, 1111 suivis de widths[i] bits
+    // retourne le nombre de bits, écrit seulement si buf n'est pas nul
+    static uint8_t put_code(uint8_t *buf, uint16_t &pos, uint32_t v, const uint8_t widths[4])
+    {
+        if (v == 0)
+        {
+            if (buf != nullptr)
+            {
+                put_bits(buf, pos, 0, 1);
+            }
+            return 1;
+        }
+
+        uint8_t i = 0;
+        while ((i < 3) && (v >> widths[i]) != 0)
+        {
+            ++i;
+        }
+
+        // préfixe: i + 1 bits à 1 puis un 0, sauf pour le dernier
+        uint8_t prefix_len = (i < 3) ? i + 2 : 4;
+        uint32_t prefix = (i < 3) ? ((1u << (i + 1)) - 1) << 1 : 0xF;
+        if (buf != nullptr)
+        {
+            put_bits(buf, pos, prefix, prefix_len);
+            put_bits(buf, pos, v, widths[i]);
+        }
+        return prefix_len + widths[i];
+    }
+
+    static uint32_t get_code(const uint8_t *buf, uint16_t &pos, const uint8_t widths[4])
+    {
+        uint8_t i = 0;
+        while ((i < 4) && (get_bits(buf, pos, 1) != 0))
+        {
+            ++i;
+        }
+        return (i == 0) ? 0 : get_bits(buf, pos, widths[i - 1]);
+    }
+
+    static const uint8_t *time_widths()
+    {
+        static const uint8_t widths[4] = {7, 10, 16, 32};
+        return widths;
+    }
+
+    static const uint8_t *value_widths()
+    {
+        static const uint8_t widths[4] = {4, 8, 16, 32};
+        return widths;
+    }
+
+    enum : uint16_t
+    {
+        HEADER_BITS = 10 + 32 * TimeSample::NB_VALUES, // ms puis grandeurs complètes
+        CAPACITY_BITS = BLOCK_SIZE * 8,
+    };
+
+    // code la trame à la suite du dernier bloc, ou compte seulement les bits si buf est nul
+    uint16_t encode(const TimeSample &s, uint32_t time, uint8_t *buf, uint16_t &pos)
+    {
+        uint16_t bits = 0;
+        uint32_t delta = time - prev_time_;
+        bits += put_code(buf, pos, zigzag(static_cast<int32_t>(delta - prev_delta_)), time_widths());
+        for (uint8_t i = 0; i < TimeSample::NB_VALUES; ++i)
+        {
+            bits += put_code(buf, pos, zigzag(static_cast<int32_t>(s.values[i] - prev_values_[i])), value_widths());
+        }
+        return bits;
+    }
+
+    void new_block(const TimeSample &s)
+    {
+        uint16_t index;
+        if (used_ < BLOCKS)
+        {
+            index = (first_ + used_) % BLOCKS;
+            ++used_;
+        }
+        else
+        {
+            // recycle le plus ancien
+            index = first_;
+            first_ = (first_ + 1) % BLOCKS;
+        }
+
+        block &b = blocks_[index];
+        b.sec = s.sec;
+        b.count = 1;
+        b.bits = 0;
+        put_bits(data_[index], b.bits, s.ms, 10);
+        for (uint8_t i = 0; i < TimeSample::NB_VALUES; ++i)
+        {
+            put_bits(data_[index], b.bits, s.values[i], 32);
+            prev_values_[i] = s.values[i];
+        }
+
+        prev_time_ = s.ms;
+        prev_delta_ = 0;
+    }
+
+public:
+    static_assert(BLOCK_SIZE * 8 < 65536, "BLOCK_SIZE too large");
+    static_assert(BLOCK_SIZE * 8 >= HEADER_BITS, "BLOCK_SIZE too small");
+
+    void clear()
+    {
+        first_ = 0;
+        used_ = 0;
+    }
+
+    void add(const TimeSample &s)
+    {
+        if (used_ == 0)
+        {
+            new_block(s);
+            return;
+        }
+
+        uint16_t last = (first_ + used_ - 1) % BLOCKS;
+        block &b = blocks_[last];
+
+        // date relative au début du bloc, en ms: un retour en arrière
+        // ou un trop long écart ouvre un nouveau bloc
+        uint32_t time = (s.sec - b.sec) * 1000 + s.ms;
+        if ((s.sec < b.sec) || (s.sec - b.sec > 86400) || (time < prev_time_) || (b.count == UINT16_MAX))
+        {
+            new_block(s);
+            return;
+        }
+
+        uint16_t pos = b.bits;
+        uint16_t bits = encode(s, time, nullptr, pos);
+        if (b.bits + bits > CAPACITY_BITS)
+        {
+            new_block(s);
+            return;
+        }
+
+        encode(s, time, data_[last], b.bits);
+        ++b.count;
+        prev_delta_ = time - prev_time_;
+        prev_time_ = time;
+        for (uint8_t i = 0; i < TimeSample::NB_VALUES; ++i)
+        {
+            prev_values_[i] = s.values[i];
+        }
+    }
+
+    // lecture des trames une à une, de la plus ancienne à la plus récente;
+    // plusieurs curseurs peuvent parcourir la série en même temps
+    class Cursor
+    {
+        const TimeSeries &series_;
+        uint16_t n_{0};   // bloc en cours de lecture, parmi les blocs utilisés
+        uint16_t k_{0};   // prochaine trame du bloc
+        uint16_t pos_{0}; // position en bits dans le bloc
+        uint32_t time_{0};
+        uint32_t delta_{0};
+        TimeSample s_;
+
+    public:
+        explicit Cursor(const TimeSeries &series) : series_(series)
+        {
+        }
+
+        // retourne false quand toutes les trames ont été lues
+        bool next(TimeSample &s)
+        {
+            while ((n_ < series_.used_) && (k_ == series_.blocks_[(series_.first_ + n_) % BLOCKS].count))
+            {
+                ++n_;
+                k_ = 0;
+            }
+            if (n_ >= series_.used_)
+            {
+                return false;
+            }
+
+            uint16_t index = (series_.first_ + n_) % BLOCKS;
+            const uint8_t *buf = series_.data_[index];
+
+            if (k_ == 0)
+            {
+                // trame complète en tête de bloc
+                pos_ = 0;
+                time_ = get_bits(buf, pos_, 10);
+                delta_ = 0;
+                for (uint8_t i = 0; i < TimeSample::NB_VALUES; ++i)
+                {
+                    s_.values[i] = get_bits(buf, pos_, 32);
+                }
+            }
+            else
+            {
+                delta_ += unzigzag(get_code(buf, pos_, time_widths()));
+                time_ += delta_;
+                for (uint8_t i = 0; i < TimeSample::NB_VALUES; ++i)
+                {
+                    s_.values[i] += unzigzag(get_code(buf, pos_, value_widths()));
+                }
+            }
+            ++k_;
+
+            s_.sec = series_.blocks_[index].sec + time_ / 1000;
+            s_.ms = time_ % 1000;
+            s = s_;
+            return true;
+        }
+    };
+
+    // appelle f pour chaque trame, de la plus ancienne à la plus récente
+    template <typename F>
+    size_t for_each(F f) const
+    {
+        size_t count = 0;
+        Cursor cursor(*this);
+        TimeSample s;
+
+        while (cursor.next(s))
+        {
+            f(s);
+            ++count;
+        }
+
+        return count;
+    }
+
+    size_t size() const
+    {
+        size_t count = 0;
+        for (uint16_t n = 0; n < used_; ++n)
+        {
+            count += blocks_[(first_ + n) % BLOCKS].count;
+        }
+        return count;
+    }
+
+    // octets occupés par les données compressées
+    size_t bytes() const
+    {
+        size_t bits = 0;
+        for (uint16_t n = 0; n < used_; ++n)
+        {
+            bits += blocks_[(first_ + n) % BLOCKS].bits;
+        }
+        return (bits + 7) / 8;
+    }
+};
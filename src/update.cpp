@@ -83,6 +83,7 @@ void sys_update_register(ESP8266WebServer &server)
                 {
                     Serial.println(F("upload terminated: restart"));
                     Serial.flush();
+                    tic_save_history();
 
                     // reboot dans 0.5s
                     blink.once_ms(500, [] {
@@ -3,6 +3,7 @@
 
 #include "wifinfo.h"
 #include "webserver.h"
+#include "chunkedoutput.h"
 #include "config.h"
 #include "cpuload.h"
 #include "filesystem.h"
@@ -91,6 +92,48 @@ void server_send_json()
     yield(); //Let a chance to other threads to work
 }
 
+// variante pour un JSON déjà rendu et partagé: envoyé sans recopie
+template <const String &(*get_json)(bool restricted)>
+void server_send_shared_json()
+{
+    AccessType access = webserver_get_auth();
+    if (access == NO_ACCESS)
+    {
+        return;
+    }
+
+    Serial.printf_P("server %s page\n", server.uri().c_str());
+
+    ESP.wdtFeed(); //Force software watchdog to restart from 0
+    server.send(200, mime::mimeTable[mime::json].mimeType, get_json(access == RESTRICTED));
+    yield(); //Let a chance to other threads to work
+}
+
+// variante qui envoie le JSON au client par morceaux pendant sa construction:
+// pas de String de la taille de la réponse, ni de Content-Length à calculer
+template <void (*get_json)(ChunkedOutput &, bool restricted)>
+void server_stream_json()
+{
+    AccessType access = webserver_get_auth();
+    if (access == NO_ACCESS)
+    {
+        return;
+    }
+
+    Serial.printf_P("server %s page (chunked)\n", server.uri().c_str());
+
+    ESP.wdtFeed(); //Force software watchdog to restart from 0
+
+    server.setContentLength(CONTENT_LENGTH_UNKNOWN);
+    server.send(200, mime::mimeTable[mime::json].mimeType, "");
+
+    ChunkedOutput output(server);
+    get_json(output, access == RESTRICTED);
+    output.end();
+
+    yield(); //Let a chance to other threads to work
+}
+
 void webserver_handle_notfound()
 {
     const char *value = nullptr;
@@ -151,11 +194,29 @@ void webserver_setup()
             config_handle_form(server, access == RESTRICTED);
         }
     });
-    server.on(F("/json"), server_send_json<tic_get_json_dict>);
-    server.on(F("/tinfo.json"), server_send_json<tic_get_json_array>);
+    server.on(F("/json"), server_send_shared_json<tic_get_json_dict>);
+    server.on(F("/tinfo.json"), server_send_shared_json<tic_get_json_array>);
     server.on(F("/emoncms.json"), server_send_json<tic_emoncms_data>);
-    server.on(F("/system.json"), server_send_json<sys_get_info_json>);
-    server.on(F("/config.json"), server_send_json<config_get_json>);
+    server.on(F("/tic/stats"), server_send_json<tic_get_stats_json>);
+    server.on(F("/history.json"), [] {
+        if (webserver_access_ok())
+        {
+            if (!tic_send_history(server, server.arg("res")))
+            {
+                server.send(400, mime::mimeTable[mime::txt].mimeType, F("res: minute, hour ou day"));
+            }
+        }
+    });
+    server.on(F("/tariff.json"), server_send_json<tic_get_tariff_json>);
+    server.on(F("/demand.json"), server_send_json<tic_get_demand_json>);
+    server.on(F("/series.json"), [] {
+        if (webserver_access_ok())
+        {
+            tic_send_series(server, server.arg("points").toInt());
+        }
+    });
+    server.on(F("/system.json"), server_stream_json<sys_get_info_json>);
+    server.on(F("/config.json"), server_stream_json<config_get_json>);
     server.on(F("/spiffs.json"), server_send_json<fs_get_json>);
     server.on(F("/wifiscan.json"), server_send_json<sys_wifi_scan_json>);
 
@@ -232,7 +293,7 @@ void webserver_setup()
     server.onNotFound(webserver_handle_notfound);
 
     //ask server to track these headers
-    const char *headerkeys[] = {"User-Agent", "X-Forwarded-For"};
+    const char *headerkeys[] = {"User-Agent", "X-Forwarded-For", "Last-Event-ID"};
     size_t headerkeyssize = sizeof(headerkeys) / sizeof(char *);
     server.collectHeaders(headerkeys, headerkeyssize);
 
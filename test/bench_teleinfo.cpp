@@ -0,0 +1,501 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// mesures de performance du décodage de la téléinformation
+//
+
+#include "mock.h"
+#include "mock_time.h"
+
+#include "teleinfo.h"
+#include "jsonbuilder.h"
+#include "lttb.h"
+#include "power.h"
+#include "sse.h"
+#include "ticdelta.h"
+#include "timeseries.h"
+
+#include <chrono>
+#include <vector>
+#if defined(__x86_64__) || defined(__i386__)
+#include <x86intrin.h>
+#endif
+
+// taille du buffer de réception lu dans loop()
+static const size_t BENCH_CHUNK = 64;
+
+// trame en mode standard d'un compteur Linky monophasé
+static void bench_standard_frame(TeleinfoBuilder &trame, uint32_t east, uint32_t sinsts)
+{
+    trame.add_group("ADSC", "041876097321");
+    trame.add_group("VTIC", "02");
+    trame.add_dated_group("DATE", "E200520164452", "");
+    trame.add_group("NGTF", "      BASE      ");
+    trame.add_group("LTARF", "      BASE      ");
+    trame.add_group("EAST", east, 9);
+    trame.add_group("EASF01", east, 9);
+    for (auto label : {"EASF02", "EASF03", "EASF04", "EASF05", "EASF06", "EASF07", "EASF08", "EASF09", "EASF10"})
+    {
+        trame.add_group(label, 0, 9);
+    }
+    trame.add_group("EASD01", east, 9);
+    for (auto label : {"EASD02", "EASD03", "EASD04"})
+    {
+        trame.add_group(label, 0, 9);
+    }
+    trame.add_group("IRMS1", sinsts / 230, 3);
+    trame.add_group("URMS1", 232, 3);
+    trame.add_group("PREF", 9, 2);
+    trame.add_group("PCOUP", 9, 2);
+    trame.add_group("SINSTS", sinsts, 5);
+    trame.add_dated_group("SMAXSN", "E200520095010", "01858");
+    trame.add_dated_group("SMAXSN-1", "E200519191314", "02143");
+    trame.add_dated_group("CCASN", "E200520163000", "00412");
+    trame.add_dated_group("CCASN-1", "E200520160000", "00388");
+    trame.add_dated_group("UMOY1", "E200520164000", "232");
+    trame.add_group("STGE", "003A0001");
+    trame.add_group("MSG1", "PAS DE          MESSAGE         ");
+    trame.add_group("PRM", "01234567890123");
+    trame.add_group("RELAIS", "000");
+    trame.add_group("NTARF", "01");
+    trame.add_group("NJOURF", "00");
+    trame.add_group("NJOURF+1", "00");
+    trame.add_group("PJOURF+1", "00008001 NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE");
+}
+
+// simule un enregistrement de plusieurs heures de trames
+static std::string bench_stream(size_t nb_frames, bool standard = false)
+{
+    std::string stream;
+    uint32_t hchp = 49126843;
+
+    for (size_t i = 0; i < nb_frames; ++i)
+    {
+        uint32_t papp = 300 + (i * 37) % 5000;
+        hchp += papp / 2500;
+
+        TeleinfoBuilder trame(standard);
+        if (standard)
+        {
+            bench_standard_frame(trame, hchp, papp);
+        }
+        else
+        {
+            trame.add_group("ADCO", "111111111111");
+            trame.add_group("OPTARIF", "HC..");
+            trame.add_group("ISOUSC", "30");
+            trame.add_group("HCHC", 52890470, 9);
+            trame.add_group("HCHP", hchp, 9);
+            trame.add_group("PTEC", "HP..");
+            trame.add_group("IINST", papp / 230, 3);
+            trame.add_group("IMAX", 42, 3);
+            trame.add_group("PAPP", papp, 5);
+            trame.add_group("HHPHC", "D");
+            trame.add_group("MOTDETAT", 0, 6);
+        }
+        stream += trame.get();
+    }
+
+    return stream;
+}
+
+template <typename F>
+static double bench_run(F f)
+{
+    auto start = std::chrono::steady_clock::now();
+    f();
+    auto end = std::chrono::steady_clock::now();
+    return std::chrono::duration<double>(end - start).count();
+}
+
+static void bench_decoder(const char *mode, bool standard)
+{
+    const size_t nb_frames = 5000;
+    const std::string stream = bench_stream(nb_frames, standard);
+    const uint8_t *data = reinterpret_cast<const uint8_t *>(stream.data());
+    size_t frames_byte = 0;
+    size_t frames_bulk = 0;
+
+    // un octet par appel
+    double t_byte = bench_run([&] {
+        TeleinfoDecoder decode;
+        for (size_t i = 0; i < stream.length(); ++i)
+        {
+            decode.put(data[i]);
+            if (decode.ready())
+            {
+                ++frames_byte;
+            }
+        }
+    });
+
+    // un buffer de réception par appel
+    double t_bulk = bench_run([&] {
+        TeleinfoDecoder decode;
+        for (size_t i = 0; i < stream.length(); i += BENCH_CHUNK)
+        {
+            const uint8_t *buf = data + i;
+            size_t len = std::min(BENCH_CHUNK, stream.length() - i);
+            while (len != 0)
+            {
+                size_t n = decode.put(buf, len);
+                buf += n;
+                len -= n;
+                if (decode.ready())
+                {
+                    ++frames_bulk;
+                }
+            }
+        }
+    });
+
+    ASSERT_EQ(frames_byte, nb_frames);
+    ASSERT_EQ(frames_bulk, nb_frames);
+
+    printf("bench decoder %s: %zu bytes, per-byte %.1f MB/s, bulk %.1f MB/s\n",
+           mode,
+           stream.length(),
+           stream.length() / t_byte / 1e6,
+           stream.length() / t_bulk / 1e6);
+}
+
+TEST(bench, decoder_bulk)
+{
+    bench_decoder("historique", false);
+    bench_decoder("standard", true);
+}
+
+// recherche séquentielle avec comparaison de toutes les étiquettes
+// (ancienne implémentation de Teleinfo::get_value)
+static const char *bench_scan_value(const Teleinfo &tinfo, const char *label)
+{
+    const char *current_label;
+    const char *value;
+    const char *state = nullptr;
+
+    while (tinfo.get_value_next(current_label, value, &state))
+    {
+        if (strcmp(current_label, label) == 0)
+        {
+            return value;
+        }
+    }
+    return nullptr;
+}
+
+TEST(bench, get_value)
+{
+    // 30 étiquettes d'une trame en mode standard
+    static const char *labels[] = {
+        "ADSC", "VTIC", "NGTF", "LTARF", "EAST",
+        "EASF01", "EASF02", "EASF03", "EASF04", "EASF05",
+        "EASF06", "EASF07", "EASF08", "EASF09", "EASF10",
+        "EASD01", "EASD02", "EASD03", "EASD04", "IRMS1",
+        "URMS1", "PREF", "PCOUP", "SINSTS", "SMAXSN",
+        "CCASN", "UMOY1", "STGE", "MSG1", "PRM"};
+    const size_t nb_labels = sizeof(labels) / sizeof(labels[0]);
+
+    TeleinfoBuilder trame(true);
+    bench_standard_frame(trame, 1538257, 460);
+
+    TeleinfoDecoder decode;
+    for (auto c : trame.get())
+    {
+        decode.put(c);
+    }
+    ASSERT_TRUE(decode.ready());
+
+    Teleinfo tinfo;
+    tinfo.update_from(decode);
+
+    Label ids[nb_labels];
+    for (size_t i = 0; i < nb_labels; ++i)
+    {
+        ids[i] = tic_label_find(labels[i]);
+        ASSERT_NE(ids[i], Label::unknown);
+    }
+
+    const size_t loops = 20000;
+    size_t found_scan = 0;
+    size_t found_index = 0;
+    size_t found_id = 0;
+
+    double t_scan = bench_run([&] {
+        for (size_t n = 0; n < loops; ++n)
+        {
+            for (size_t i = 0; i < nb_labels; ++i)
+            {
+                found_scan += bench_scan_value(tinfo, labels[i]) != nullptr;
+            }
+        }
+    });
+
+    double t_index = bench_run([&] {
+        for (size_t n = 0; n < loops; ++n)
+        {
+            for (size_t i = 0; i < nb_labels; ++i)
+            {
+                found_index += tinfo.get_value(labels[i]) != nullptr;
+            }
+        }
+    });
+
+    double t_id = bench_run([&] {
+        for (size_t n = 0; n < loops; ++n)
+        {
+            for (size_t i = 0; i < nb_labels; ++i)
+            {
+                found_id += tinfo.get_value(ids[i]) != nullptr;
+            }
+        }
+    });
+
+    ASSERT_EQ(found_scan, loops * nb_labels);
+    ASSERT_EQ(found_index, loops * nb_labels);
+    ASSERT_EQ(found_id, loops * nb_labels);
+
+    printf("bench get_value: %zu labels, scan %.2f Mlookups/s, index %.2f Mlookups/s, id %.2f Mlookups/s\n",
+           nb_labels,
+           loops * nb_labels / t_scan / 1e6,
+           loops * nb_labels / t_index / 1e6,
+           loops * nb_labels / t_id / 1e6);
+}
+
+// compteur de cycles du processeur hôte, à défaut des nanosecondes
+static uint64_t bench_cycles()
+{
+#if defined(__x86_64__) || defined(__i386__)
+    return __rdtsc();
+#else
+    return std::chrono::duration_cast<std::chrono::nanoseconds>(std::chrono::steady_clock::now().time_since_epoch()).count();
+#endif
+}
+
+TEST(bench, power)
+{
+    const size_t loops = 200000;
+    PowerEstimator power{10, 60, 300};
+    uint32_t ms = 0;
+    uint32_t wh = 1000000;
+    uint64_t sum = 0;
+
+    // une mesure toutes les 1.25 s à environ 2 kW: les fenêtres se remplissent puis glissent
+    uint64_t start = bench_cycles();
+    for (size_t i = 0; i < loops; ++i)
+    {
+        ms += 1250;
+        wh += (i % 3 != 0);
+        power.add(ms, wh);
+    }
+    uint64_t c_add = bench_cycles() - start;
+
+    start = bench_cycles();
+    for (size_t i = 0; i < loops; ++i)
+    {
+        sum += power.watt(60 + (i & 1));
+    }
+    uint64_t c_watt = bench_cycles() - start;
+
+    start = bench_cycles();
+    for (size_t i = 0; i < loops; ++i)
+    {
+        sum += power.quality(60 + (i & 1));
+    }
+    uint64_t c_quality = bench_cycles() - start;
+
+    ASSERT_NE(sum, 0u);
+
+    printf("bench power: cycles per call, add %.1f, watt %.1f, quality %.1f\n",
+           double(c_add) / loops,
+           double(c_watt) / loops,
+           double(c_quality) / loops);
+}
+
+TEST(bench, timeseries)
+{
+    const size_t nb_frames = 5000;
+    const std::string stream = bench_stream(nb_frames);
+    std::vector<TimeSample> samples;
+
+    // grandeurs des trames décodées, datées comme à la réception: toutes les 1.2 à 1.5 s
+    TeleinfoDecoder decode;
+    Teleinfo tinfo;
+    uint32_t ms = 0;
+    for (auto c : stream)
+    {
+        decode.put(c);
+        if (decode.ready())
+        {
+            tinfo.update_from(decode);
+            ms += 1200 + (samples.size() * 97) % 300;
+
+            TimeSample s;
+            s.sec = 1589932800 + ms / 1000;
+            s.ms = ms % 1000;
+            s.values[0] = tinfo.get_value_int(Label::HCHC);
+            s.values[1] = tinfo.get_value_int(Label::HCHP);
+            s.values[2] = tinfo.get_value_int(Label::PAPP);
+            s.values[3] = tinfo.get_value_int(Label::IINST);
+            samples.push_back(s);
+        }
+    }
+    ASSERT_EQ(samples.size(), nb_frames);
+
+    // assez de blocs pour tout garder
+    static TimeSeries<256, 512> series;
+    series.clear();
+
+    uint64_t start = bench_cycles();
+    for (const auto &s : samples)
+    {
+        series.add(s);
+    }
+    uint64_t c_encode = bench_cycles() - start;
+
+    uint64_t sum = 0;
+    start = bench_cycles();
+    size_t count = series.for_each([&](const TimeSample &s) { sum += s.values[2]; });
+    uint64_t c_decode = bench_cycles() - start;
+
+    start = bench_cycles();
+    size_t points = lttb(series, 500, 2, [&](const TimeSample &s) { sum += s.values[2]; });
+    uint64_t c_lttb = bench_cycles() - start;
+
+    ASSERT_EQ(count, nb_frames);
+    ASSERT_EQ(points, 500u);
+    ASSERT_NE(sum, 0u);
+
+    // date (6 octets) et quatre grandeurs de 32 bits
+    const size_t raw = sizeof(uint32_t) + sizeof(uint16_t) + TimeSample::NB_VALUES * sizeof(uint32_t);
+    printf("bench timeseries: %zu frames, %.2f bytes/frame, ratio %.1f, cycles per frame, encode %.1f, decode %.1f, lttb %.1f\n",
+           nb_frames,
+           double(series.bytes()) / nb_frames,
+           double(raw * nb_frames) / series.bytes(),
+           double(c_encode) / nb_frames,
+           double(c_decode) / nb_frames,
+           double(c_lttb) / nb_frames);
+}
+
+// une journée de trames en mode historique, une toutes les 1.4 s: heures creuses
+// de 22h à 6h, pointes de consommation le matin et le soir
+static void bench_day_frame(TeleinfoBuilder &trame, size_t i, uint32_t hchc, uint32_t hchp, uint32_t papp)
+{
+    uint32_t hour = (i * 14 / 10) / 3600;
+    bool hc = (hour < 6) || (hour >= 22);
+
+    trame.add_group("ADCO", "111111111111");
+    trame.add_group("OPTARIF", "HC..");
+    trame.add_group("ISOUSC", "30");
+    trame.add_group("HCHC", hchc, 9);
+    trame.add_group("HCHP", hchp, 9);
+    trame.add_group("PTEC", hc ? "HC.." : "HP..");
+    trame.add_group("IINST", papp / 230, 3);
+    trame.add_group("IMAX", 42, 3);
+    trame.add_group("PAPP", papp, 5);
+    trame.add_group("HHPHC", "D");
+    trame.add_group("MOTDETAT", 0, 6);
+}
+
+// le dict JSON de la trame, comme pour /json et les clients SSE
+static void bench_json_dict(const Teleinfo &tinfo, String &data)
+{
+    JSONBuilder js(data, 256);
+    const char *label;
+    const char *value;
+    const char *state = nullptr;
+
+    js.append("timestamp", tinfo.get_timestamp_iso8601().c_str());
+    js.append("seconds", tinfo.get_seconds().c_str());
+    while (tinfo.get_value_next(label, value, &state))
+    {
+        if (Teleinfo::get_integer(value))
+            js.append_without_quote(label, value);
+        else
+            js.append(label, value);
+    }
+    js.finalize();
+}
+
+TEST(bench, sse_delta)
+{
+    const size_t nb_frames = 86400 * 10 / 14;
+    uint32_t hchc = 52890470;
+    uint32_t hchp = 49126843;
+    uint32_t mwh = 0; // énergie pas encore comptée dans les index
+    size_t bytes_full = 0;
+    size_t bytes_delta = 0;
+    size_t keyframes = 0;
+    uint64_t c_full = 0;
+    uint64_t c_delta = 0;
+
+    TeleinfoDecoder decode;
+    Teleinfo tinfo;
+    TeleinfoDelta delta(SSE_KEYFRAME_INTERVAL);
+
+    for (size_t i = 0; i < nb_frames; ++i)
+    {
+        uint32_t hour = (i * 14 / 10) / 3600;
+        uint32_t papp = 350 + (i * 37) % 150;
+        if ((hour == 7) || (hour >= 18 && hour < 21))
+        {
+            papp += 2500 + (i * 13) % 400;
+        }
+
+        // index au Wh près
+        mwh += papp * 1400 / 3600;
+        uint32_t wh = mwh / 1000;
+        mwh %= 1000;
+        if ((hour < 6) || (hour >= 22))
+            hchc += wh;
+        else
+            hchp += wh;
+
+        TeleinfoBuilder trame;
+        bench_day_frame(trame, i, hchc, hchp, papp);
+        for (auto c : trame.get())
+        {
+            decode.put(c);
+        }
+        ASSERT_TRUE(decode.ready());
+        tinfo.update_from(decode);
+
+        // une trame complète par événement
+        uint64_t start = bench_cycles();
+        String full;
+        bench_json_dict(tinfo, full);
+        SseEvent event_full(i + 1, "", full);
+        c_full += bench_cycles() - start;
+        bytes_full += event_full.text().length();
+
+        // les différences, sauf pour les trames complètes: le dict est déjà rendu
+        start = bench_cycles();
+        String data;
+        JSONBuilder js(data, 64);
+        js.append("timestamp", tinfo.get_timestamp_iso8601().c_str());
+        js.append("seconds", tinfo.get_seconds().c_str());
+        bool is_delta = delta.update(tinfo, [&js](const char *label, const char *value) {
+            if (Teleinfo::get_integer(value))
+                js.append_without_quote(label, value);
+            else
+                js.append(label, value);
+        });
+        js.finalize();
+        size_t n = is_delta ? SseEvent(i + 1, "delta", data).text().length() : event_full.text().length();
+        c_delta += bench_cycles() - start;
+        bytes_delta += n;
+        keyframes += !is_delta;
+    }
+
+    ASSERT_LT(bytes_delta, bytes_full * 2 / 3);
+
+    printf("bench sse delta: %zu frames, %zu keyframes, bytes per event full %.1f, delta %.1f (%.0f%%), "
+           "cycles per frame full %.1f, delta %.1f\n",
+           nb_frames,
+           keyframes,
+           double(bytes_full) / nb_frames,
+           double(bytes_delta) / nb_frames,
+           100.0 * bytes_delta / bytes_full,
+           double(c_full) / nb_frames,
+           double(c_delta) / nb_frames);
+}
@@ -13,6 +13,11 @@ void tic_make_timers()
 {
 }
 
+void tic_set_mode(uint8_t mode)
+{
+    config.tic_mode = mode;
+}
+
 // class EmulateWebServer : public ESP8266WebServer
 // {
 // public:
@@ -58,6 +63,8 @@ int main(int argc, char *argv[])
     strncpy_s(config.ap_psk, "motdepasse", CFG_PSK_LENGTH);
     config.httpreq.freq = 300;
     config.httpreq.trigger_ptec = 1;
+    config.prices[0] = 1327;
+    config.prices[1] = 1654;
 
     config_save();
 
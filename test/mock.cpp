@@ -29,74 +29,17 @@ const std::string trame_teleinfo = "\
 \nMOTDETAT 000000 B\r\
 \x03";
 
-class TeleinfoBuilder
-{
-    std::string frame_;
-
-public:
-    TeleinfoBuilder()
-    {
-        reset();
-    }
-
-    void reset()
-    {
-        frame_ = '\x02';
-    }
-
-    void add_group(const char *label, const char *value)
-    {
-        if (frame_[frame_.length() - 1] == '\x03')
-            return;
-
-        frame_ += '\n';
-        frame_ += label;
-        frame_ += ' ';
-        frame_ += value;
-        frame_ += ' ';
-
-        int sum = 32; // l'espace de séparation
-        for (const char *p = label; *p; sum += *p++)
-            ;
-        for (const char *p = value; *p; sum += *p++)
-            ;
-        frame_ += (sum & 63) + 32;
-
-        frame_ += '\r';
-    }
-
-    void add_group(const char *label, uint32_t value, uint8_t width)
-    {
-        char s[16];
-        if (width > 15)
-            width = 15;
-        s[width] = 0;
-        while (width != 0)
-        {
-            s[--width] = '0' + (value % 10);
-            value /= 10;
-        }
-        add_group(label, s);
-    }
-
-    const std::string &get() const
-    {
-        if (frame_[frame_.length() - 1] != '\x03')
-            const_cast<std::string &>(frame_) += '\x03';
-        return frame_;
-    }
-};
-
 // initialise Teleinfo avec la trame d'exemple
 void tinfo_init()
 {
-    TeleinfoDecoder decode;
+    // tinfo référence la trame du décodeur: il doit lui survivre
+    static TeleinfoDecoder decode;
     for (auto c : trame_teleinfo)
     {
         decode.put(c);
     }
     assert(decode.ready());
-    tinfo.copy_from(decode);
+    tinfo.update_from(decode);
 }
 
 void tinfo_init(uint32_t papp, bool heures_creuses, uint32_t adps)
@@ -119,12 +62,12 @@ void tinfo_init(uint32_t papp, bool heures_creuses, uint32_t adps)
     trame.add_group("MOTDETAT", 0, 6);
 
     // décode la trame
-    TeleinfoDecoder decode;
+    static TeleinfoDecoder decode;
     for (auto c : trame.get())
     {
         decode.put(c);
     }
     ASSERT_TRUE(decode.ready());
 
-    tinfo.copy_from(decode);
+    tinfo.update_from(decode);
 }
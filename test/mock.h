@@ -16,5 +16,90 @@ const char *test_time_marker();
 
 extern const std::string trame_teleinfo;
 
+// construit une trame de téléinformation avec des checksums valides
+// en mode historique (séparateur espace) ou standard (séparateur tabulation)
+class TeleinfoBuilder
+{
+    std::string frame_;
+    bool standard_;
+
+public:
+    TeleinfoBuilder(bool standard = false) : standard_(standard)
+    {
+        reset();
+    }
+
+    void reset()
+    {
+        frame_ = '\x02';
+    }
+
+    void add_group(const char *label, const char *value)
+    {
+        add_fields(label, nullptr, value);
+    }
+
+    // groupe horodaté (mode standard uniquement)
+    void add_dated_group(const char *label, const char *date, const char *value)
+    {
+        add_fields(label, date, value);
+    }
+
+    void add_group(const char *label, uint32_t value, uint8_t width)
+    {
+        char s[16];
+        if (width > 15)
+            width = 15;
+        s[width] = 0;
+        while (width != 0)
+        {
+            s[--width] = '0' + (value % 10);
+            value /= 10;
+        }
+        add_group(label, s);
+    }
+
+    const std::string &get() const
+    {
+        if (frame_[frame_.length() - 1] != '\x03')
+            const_cast<std::string &>(frame_) += '\x03';
+        return frame_;
+    }
+
+private:
+    void add_fields(const char *label, const char *date, const char *value)
+    {
+        if (frame_[frame_.length() - 1] == '\x03')
+            return;
+
+        const char sep = standard_ ? '\t' : ' ';
+
+        std::string group = label;
+        group += sep;
+        if (date != nullptr)
+        {
+            group += date;
+            group += sep;
+        }
+        group += value;
+
+        // mode n°2: le dernier séparateur est inclus dans le checksum
+        if (standard_)
+            group += sep;
+
+        int sum = 0;
+        for (auto c : group)
+            sum += c;
+
+        if (!standard_)
+            group += sep;
+
+        frame_ += '\n';
+        frame_ += group;
+        frame_ += (sum & 63) + 32;
+        frame_ += '\r';
+    }
+};
+
 void tinfo_init();
 void tinfo_init(uint32_t papp, bool heures_creuses, uint32_t adps = 0);
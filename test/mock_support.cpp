@@ -8,14 +8,18 @@
 #include <EEPROM.h>
 #include <ESP8266WiFi.h>
 #include <FS.h>
+#include <flash_hal.h>
 #include <Arduino.h>
 #include <stdarg.h>
 
+unsigned long mock_millis = 1000;
+
 ESPClass ESP;
 EEPROMClass EEPROM;
 WiFiClass WiFi;
 SerialClass Serial;
 FS ERFS;
+FlashHalSim flash_hal_sim;
 
 int pinMode_called = 0;
 int digitalRead_called = 0;
@@ -36,6 +40,9 @@ int HTTPClient::addHeader_called = 0;
 
 int ESP8266WebServer::send_called = 0;
 int ESP8266WebServer::send_code = 0;
+int ESP8266WebServer::sendContent_called = 0;
+String ESP8266WebServer::content;
+std::vector<std::string> ESP8266WebServer::chunks;
 int ESP8266WebServer::hasArg_called = 0;
 int ESP8266WebServer::arg_called = 0;
 
@@ -26,7 +26,8 @@ struct tm *mock_localtime(const time_t *t)
     }
     else
     {
-        return nullptr;
+        // les autres dates, en UTC
+        return gmtime(t);
     }
 }
 
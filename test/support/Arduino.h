@@ -11,7 +11,8 @@ extern int pinMode_called;
 extern int digitalRead_called;
 extern int digitalWrite_called;
 
-static inline unsigned long millis() { return 1000u; }
+extern unsigned long mock_millis; // 1000 par défaut
+static inline unsigned long millis() { return mock_millis; }
 static inline unsigned long micros() { return 1000000u; }
 static inline uint64_t micros64() { return 1000000u; }
 static inline void delay(unsigned) {}
@@ -42,6 +43,9 @@ typedef const char *PGM_P;
 #define sprintf_P sprintf
 #define strcpy_P strcpy
 #define strcasecmp_P strcasecmp
+#define strcmp_P strcmp
+#define pgm_read_byte(addr) (*reinterpret_cast<const uint8_t *>(addr))
+#define pgm_read_word(addr) (*reinterpret_cast<const uint16_t *>(addr))
 #define snprintf_P snprintf
 
 class Printable;
@@ -148,6 +152,12 @@ public:
         return 1;
     }
 
+    unsigned char concat(char c)
+    {
+        s.append(1, c);
+        return 1;
+    }
+
     unsigned char concat(unsigned o)
     {
         s.append(std::to_string(o));
@@ -181,7 +191,8 @@ public:
 
     int toInt() const
     {
-        return std::stoi(s);
+        // comme Arduino: 0 si la chaîne n'est pas un nombre
+        return atoi(s.c_str());
     }
 
     const char *data() const
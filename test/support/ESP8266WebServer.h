@@ -6,18 +6,31 @@
 #include "WiFiClient.h"
 #include "mimetable.h"
 
+#include <map>
+#include <string>
+#include <vector>
+
+#define CONTENT_LENGTH_UNKNOWN ((size_t)-1)
+
 class ESP8266WebServer
 {
 public:
     static int send_called;
     static int send_code;
+    static int sendContent_called;
+    static String content; // contenu envoyé par morceaux
+    static std::vector<std::string> chunks; // un élément par appel à sendContent()
     static int hasArg_called;
     static int arg_called;
 
+    WiFiClient current_client; // client de la requête en cours
+    std::map<std::string, String> headers; // en-têtes de la requête en cours
+    std::map<std::string, String> query;   // arguments de la requête, sinon ils valent tous "1"
+
 public:
     WiFiClient client()
     {
-        return WiFiClient();
+        return current_client;
     }
 
     void send(int code, const String &, const String &)
@@ -26,6 +39,22 @@ public:
         send_code = code;
     }
 
+    void setContentLength(size_t)
+    {
+    }
+
+    void sendContent(const String &data)
+    {
+        sendContent(data.c_str(), data.length());
+    }
+
+    void sendContent(const char *data, size_t size)
+    {
+        ++sendContent_called;
+        chunks.emplace_back(data, size);
+        content.concat(chunks.back().c_str());
+    }
+
     void on(const char *, ...)
     {
     }
@@ -34,9 +63,14 @@ public:
     {
     }
 
-    virtual String arg(const String &) const
+    virtual String arg(const String &name) const
     {
         ++arg_called;
+        if (!query.empty())
+        {
+            auto it = query.find(name.s);
+            return (it == query.end()) ? String() : it->second;
+        }
         return "1";
     }
     virtual String arg(int) const
@@ -44,10 +78,10 @@ public:
         ++arg_called;
         return "1";
     }
-    virtual bool hasArg(const String &) const
+    virtual bool hasArg(const String &name) const
     {
         ++hasArg_called;
-        return true;
+        return query.empty() || (query.count(name.s) != 0);
     }
 
     virtual int args() const
@@ -55,6 +89,12 @@ public:
         return 1;
     }
 
+    String header(const String &name)
+    {
+        auto it = headers.find(name.s);
+        return (it == headers.end()) ? String() : it->second;
+    }
+
     String argName(int i) const
     {
         return "argName";
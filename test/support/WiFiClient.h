@@ -5,6 +5,12 @@
 
 #include <Arduino.h>
 
+#include <algorithm>
+#include <cstdint>
+#include <memory>
+#include <string>
+#include <vector>
+
 class IPAddress
 {
 public:
@@ -17,15 +23,47 @@ public:
 class WiFiClient
 {
 public:
+    // état de la connexion, partagé par les copies du client comme dans le SDK
+    struct Socket
+    {
+        size_t window = SIZE_MAX; // écriture possible sans attendre, 0 pour une socket bloquée
+        std::string sent;     // tout ce qui a été écrit
+        bool connected = true;
+    };
+
+private:
+    std::shared_ptr<Socket> socket_ = std::make_shared<Socket>();
+
+public:
+    Socket &socket()
+    {
+        return *socket_;
+    }
+
+    size_t availableForWrite()
+    {
+        return socket_->window;
+    }
+
+    // comme dans le SDK, write() attend que tout soit écrit: seule la place libre diminue
+    size_t write(const uint8_t *buf, size_t size)
+    {
+        socket_->window -= std::min(size, socket_->window);
+        socket_->sent.append(reinterpret_cast<const char *>(buf), size);
+        return size;
+    }
     void println(const char *) {}
     void println() {}
     void print(const char *) {}
     void print(const String &) {}
     void flush() {}
-    void stop() {}
+    void stop()
+    {
+        socket_->connected = false;
+    }
     bool connected()
     {
-        return true;
+        return socket_->connected;
     }
     operator bool() const
     {
@@ -0,0 +1,116 @@
+// module téléinformation client
+// rene-d 2020
+
+#pragma once
+
+#include <algorithm>
+#include <vector>
+#include <inttypes.h>
+
+#define FLASH_HAL_OK (0)
+#define FLASH_HAL_READ_ERROR (-1)
+#define FLASH_HAL_WRITE_ERROR (-2)
+#define FLASH_HAL_ERASE_ERROR (-3)
+
+#ifndef FLASH_SECTOR_SIZE
+#define FLASH_SECTOR_SIZE 0x1000
+#endif
+
+// carte 4 Mo avec eagle.flash.4m1m.ld
+#define FS_PHYS_ADDR 0x300000
+#define FS_PHYS_SIZE 0xFB000
+
+// simulation d'une mémoire flash NOR de la zone du filesystem:
+//  - l'effacement se fait par secteur et met les octets à 0xFF
+//  - l'écriture ne peut que passer des bits de 1 à 0
+//  - une coupure de courant peut être provoquée au milieu d'une écriture
+class FlashHalSim
+{
+public:
+    std::vector<uint8_t> data;
+    std::vector<uint32_t> erase_count; // nombre d'effacements par secteur
+    uint32_t writes;                   // nombre d'appels à flash_hal_write
+    int32_t power_cut;                 // octets encore écrits avant la coupure, -1 sinon
+
+    FlashHalSim()
+    {
+        reset();
+    }
+
+    // flash vierge
+    void reset()
+    {
+        data.assign(FS_PHYS_SIZE, 0xFF);
+        erase_count.assign(FS_PHYS_SIZE / FLASH_SECTOR_SIZE, 0);
+        writes = 0;
+        power_cut = -1;
+    }
+
+    bool in_range(uint32_t addr, uint32_t size) const
+    {
+        return (addr >= FS_PHYS_ADDR) && (addr + size <= FS_PHYS_ADDR + FS_PHYS_SIZE);
+    }
+
+    int32_t read(uint32_t addr, uint32_t size, uint8_t *dst) const
+    {
+        if (!in_range(addr, size))
+        {
+            return FLASH_HAL_READ_ERROR;
+        }
+        std::copy(data.begin() + (addr - FS_PHYS_ADDR), data.begin() + (addr - FS_PHYS_ADDR + size), dst);
+        return FLASH_HAL_OK;
+    }
+
+    int32_t write(uint32_t addr, uint32_t size, const uint8_t *src)
+    {
+        if (!in_range(addr, size) || (power_cut == 0))
+        {
+            return FLASH_HAL_WRITE_ERROR;
+        }
+        ++writes;
+        for (uint32_t i = 0; i < size; ++i)
+        {
+            if (power_cut == 0)
+            {
+                return FLASH_HAL_WRITE_ERROR;
+            }
+            if (power_cut > 0)
+            {
+                --power_cut;
+            }
+            data[addr - FS_PHYS_ADDR + i] &= src[i];
+        }
+        return FLASH_HAL_OK;
+    }
+
+    int32_t erase(uint32_t addr, uint32_t size)
+    {
+        if (!in_range(addr, size) || (addr % FLASH_SECTOR_SIZE != 0) || (size % FLASH_SECTOR_SIZE != 0) || (power_cut == 0))
+        {
+            return FLASH_HAL_ERASE_ERROR;
+        }
+        for (uint32_t sector = 0; sector < size / FLASH_SECTOR_SIZE; ++sector)
+        {
+            ++erase_count[(addr - FS_PHYS_ADDR) / FLASH_SECTOR_SIZE + sector];
+        }
+        std::fill(data.begin() + (addr - FS_PHYS_ADDR), data.begin() + (addr - FS_PHYS_ADDR + size), 0xFF);
+        return FLASH_HAL_OK;
+    }
+};
+
+extern FlashHalSim flash_hal_sim;
+
+inline int32_t flash_hal_read(uint32_t addr, uint32_t size, uint8_t *dst)
+{
+    return flash_hal_sim.read(addr, size, dst);
+}
+
+inline int32_t flash_hal_write(uint32_t addr, uint32_t size, const uint8_t *src)
+{
+    return flash_hal_sim.write(addr, size, src);
+}
+
+inline int32_t flash_hal_erase(uint32_t addr, uint32_t size)
+{
+    return flash_hal_sim.erase(addr, size);
+}
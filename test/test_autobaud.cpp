@@ -0,0 +1,277 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests de la détection automatique de la vitesse de la téléinformation
+//
+
+#include "mock.h"
+#include "mock_time.h"
+
+#include "autobaud.h"
+
+#include <vector>
+
+// simule la ligne série: un flux d'octets émis en boucle en 7E1 par le compteur
+// à une vitesse donnée et lu par l'UART à une autre vitesse (ou la même)
+class UartLine
+{
+    std::vector<uint8_t> bits_; // niveau de la ligne, un élément par bit émis
+    uint32_t baudrate_;
+    double next_; // instant à partir duquel l'UART attend un bit de start
+
+    void add_byte(uint8_t c)
+    {
+        uint8_t parity = 0;
+        bits_.push_back(0); // start
+        for (int i = 0; i < 7; ++i)
+        {
+            bits_.push_back((c >> i) & 1);
+            parity ^= (c >> i) & 1;
+        }
+        bits_.push_back(parity); // parité paire
+        bits_.push_back(1);      // stop
+    }
+
+    int level(double t) const
+    {
+        return bits_[static_cast<size_t>(t * baudrate_) % bits_.size()];
+    }
+
+public:
+    UartLine(const std::string &frames, uint32_t baudrate) : baudrate_(baudrate), next_(0)
+    {
+        for (auto c : frames)
+        {
+            add_byte(c);
+            if (c == '\x03')
+            {
+                // silence entre deux trames
+                bits_.insert(bits_.end(), baudrate / 20, 1);
+            }
+        }
+    }
+
+    // octets reçus par l'UART entre t0 et t1 (en ms)
+    std::string read(uint32_t t0, uint32_t t1, uint32_t baudrate)
+    {
+        std::string received;
+        double t = std::max(next_, t0 / 1000.);
+        double bit = 1. / baudrate;
+
+        while (t < t1 / 1000.)
+        {
+            if (level(t) != 0)
+            {
+                // attend le front descendant du bit de start
+                t += bit / 8;
+                continue;
+            }
+
+            // échantillonne au milieu des bits
+            if (level(t + bit / 2) != 0)
+            {
+                t += bit / 8; // parasite
+                continue;
+            }
+
+            uint8_t c = 0;
+            for (int i = 0; i < 7; ++i)
+            {
+                c |= level(t + (i + 1.5) * bit) << i;
+            }
+            if (level(t + 9.5 * bit) == 1)
+            {
+                // stop bit valide (la parité n'est pas vérifiée)
+                received += static_cast<char>(c);
+            }
+            t += 9.5 * bit;
+        }
+
+        next_ = t;
+        return received;
+    }
+};
+
+static std::string test_frames(bool standard, size_t nb)
+{
+    std::string frames;
+    for (size_t i = 0; i < nb; ++i)
+    {
+        TeleinfoBuilder trame(standard);
+        if (standard)
+        {
+            trame.add_group("ADSC", "041876097321");
+            trame.add_group("VTIC", "02");
+            trame.add_dated_group("DATE", "E200520164452", "");
+            trame.add_group("NGTF", "      BASE      ");
+            trame.add_group("LTARF", "      BASE      ");
+            trame.add_group("EAST", 1538257 + i, 9);
+            trame.add_group("IRMS1", 2, 3);
+            trame.add_group("URMS1", 232, 3);
+            trame.add_group("PREF", 9, 2);
+            trame.add_group("SINSTS", 460, 5);
+            trame.add_dated_group("SMAXSN", "E200520095010", "01858");
+            trame.add_group("STGE", "003A0001");
+            trame.add_group("MSG1", "PAS DE          MESSAGE         ");
+            trame.add_group("PRM", "01234567890123");
+        }
+        else
+        {
+            trame.add_group("ADCO", "111111111111");
+            trame.add_group("OPTARIF", "BASE");
+            trame.add_group("ISOUSC", "30");
+            trame.add_group("BASE", 52890470 + i, 9);
+            trame.add_group("PTEC", "TH..");
+            trame.add_group("IINST", 2, 3);
+            trame.add_group("IMAX", 42, 3);
+            trame.add_group("PAPP", 460, 5);
+            trame.add_group("MOTDETAT", 0, 6);
+        }
+        frames += trame.get();
+    }
+    return frames;
+}
+
+// fait tourner la détection pendant la durée indiquée, par pas de 20 ms (la boucle principale)
+static uint32_t run(UartLine &line, TeleinfoDecoder &decoder, TeleinfoAutoBaud &autobaud,
+                    uint32_t &now, uint32_t duration, size_t *frames = nullptr)
+{
+    uint32_t changes = 0;
+
+    for (uint32_t end = now + duration; now < end; now += 20)
+    {
+        std::string buf = line.read(now, now + 20, autobaud.baudrate());
+        const uint8_t *p = reinterpret_cast<const uint8_t *>(buf.data());
+        size_t len = buf.length();
+
+        while (len != 0)
+        {
+            size_t n = decoder.put(p, len);
+            p += n;
+            len -= n;
+            if (frames != nullptr && decoder.ready())
+            {
+                ++*frames;
+            }
+        }
+
+        if (autobaud.update(decoder.stats(), now + 20))
+        {
+            ++changes;
+        }
+    }
+
+    return changes;
+}
+
+TEST(autobaud, uart_line)
+{
+    // vérifie le simulateur: à la bonne vitesse, on relit le flux émis
+    std::string frames = test_frames(false, 1);
+    UartLine line(frames, 1200);
+    ASSERT_EQ(line.read(0, 2000, 1200).substr(0, frames.length()), frames);
+
+    UartLine line_std(test_frames(true, 1), 9600);
+    ASSERT_EQ(line_std.read(0, 2000, 1200).find("ADSC"), std::string::npos);
+}
+
+TEST(autobaud, historique)
+{
+    UartLine line(test_frames(false, 4), 1200);
+    TeleinfoDecoder decoder;
+    TeleinfoAutoBaud autobaud;
+    uint32_t now = 0;
+    size_t frames = 0;
+
+    // commence par la mauvaise vitesse
+    autobaud.start(TeleinfoAutoBaud::MODE_STANDARD, decoder.stats(), now);
+    ASSERT_EQ(autobaud.baudrate(), 9600u);
+    ASSERT_FALSE(autobaud.locked());
+
+    run(line, decoder, autobaud, now, 10000, &frames);
+
+    ASSERT_TRUE(autobaud.locked());
+    ASSERT_EQ(autobaud.mode(), TeleinfoAutoBaud::MODE_HISTORIQUE);
+    ASSERT_EQ(autobaud.baudrate(), 1200u);
+    ASSERT_GT(frames, 0u);
+    ASSERT_EQ(decoder.stats().groups[1], 0u);
+}
+
+TEST(autobaud, standard)
+{
+    UartLine line(test_frames(true, 4), 9600);
+    TeleinfoDecoder decoder;
+    TeleinfoAutoBaud autobaud;
+    uint32_t now = 0;
+
+    // commence par la mauvaise vitesse
+    autobaud.start(TeleinfoAutoBaud::MODE_HISTORIQUE, decoder.stats(), now);
+    ASSERT_EQ(autobaud.baudrate(), 1200u);
+
+    uint32_t changes = run(line, decoder, autobaud, now, 10000);
+
+    ASSERT_TRUE(autobaud.locked());
+    ASSERT_EQ(autobaud.mode(), TeleinfoAutoBaud::MODE_STANDARD);
+    ASSERT_EQ(autobaud.baudrate(), 9600u);
+    ASSERT_EQ(changes, 1u);
+
+    // à 1200 bauds, le flux à 9600 bauds n'a donné aucun groupe valide
+    ASSERT_EQ(decoder.stats().groups[0], 0u);
+    ASSERT_NE(decoder.stats().groups[1], 0u);
+}
+
+TEST(autobaud, bonne_vitesse)
+{
+    UartLine line(test_frames(true, 4), 9600);
+    TeleinfoDecoder decoder;
+    TeleinfoAutoBaud autobaud;
+    uint32_t now = 0;
+
+    // le dernier mode détecté est le bon: verrouillage sans changer de vitesse
+    autobaud.start(TeleinfoAutoBaud::MODE_STANDARD, decoder.stats(), now);
+    uint32_t changes = run(line, decoder, autobaud, now, 2000);
+
+    ASSERT_TRUE(autobaud.locked());
+    ASSERT_EQ(autobaud.mode(), TeleinfoAutoBaud::MODE_STANDARD);
+    ASSERT_EQ(changes, 0u);
+}
+
+TEST(autobaud, ligne_muette)
+{
+    UartLine line(std::string(1, '\x03'), 1200);
+    TeleinfoDecoder decoder;
+    TeleinfoAutoBaud autobaud;
+    uint32_t now = 0;
+
+    // pas de compteur: la détection alterne entre les deux vitesses sans conclure
+    autobaud.start(TeleinfoAutoBaud::MODE_HISTORIQUE, decoder.stats(), now);
+    uint32_t changes = run(line, decoder, autobaud, now, 4 * TeleinfoAutoBaud::SAMPLE_MS);
+
+    ASSERT_FALSE(autobaud.locked());
+    ASSERT_EQ(changes, 4u);
+}
+
+TEST(autobaud, relock)
+{
+    UartLine line_hist(test_frames(false, 4), 1200);
+    UartLine line_std(test_frames(true, 4), 9600);
+    TeleinfoDecoder decoder;
+    TeleinfoAutoBaud autobaud;
+    uint32_t now = 0;
+
+    autobaud.start(TeleinfoAutoBaud::MODE_HISTORIQUE, decoder.stats(), now);
+    run(line_hist, decoder, autobaud, now, 5000);
+    ASSERT_TRUE(autobaud.locked());
+    ASSERT_EQ(autobaud.mode(), TeleinfoAutoBaud::MODE_HISTORIQUE);
+
+    // le compteur passe en mode standard: rien ne change tant que les erreurs ne durent pas
+    run(line_std, decoder, autobaud, now, TeleinfoAutoBaud::RELOCK_MS - 1000);
+    ASSERT_TRUE(autobaud.locked());
+    ASSERT_EQ(autobaud.mode(), TeleinfoAutoBaud::MODE_HISTORIQUE);
+
+    // puis la détection est relancée et trouve le mode standard
+    run(line_std, decoder, autobaud, now, 5000);
+    ASSERT_TRUE(autobaud.locked());
+    ASSERT_EQ(autobaud.mode(), TeleinfoAutoBaud::MODE_STANDARD);
+}
@@ -26,6 +26,7 @@ TEST(config, get_json)
     EXPECT_EQ(j1["ssid"], config.ssid);
     EXPECT_EQ(j1["host"], config.host);
     EXPECT_EQ(j1["httpreq_port"], config.httpreq.port);
+    EXPECT_EQ(j1["tic_mode"], TIC_MODE_AUTO);
 }
 
 TEST(config, show)
@@ -45,6 +46,60 @@ TEST(config, setup)
     EXPECT_EQ(config.httpreq.port, 1515);
 }
 
+TEST(config, prices)
+{
+    String r;
+
+    config_reset();
+    EXPECT_TRUE(config_parse_prices(" 0.1296, 0.1582 ,,1,0.12345,6.5535"));
+    EXPECT_EQ(config.prices[0], 1296);
+    EXPECT_EQ(config.prices[1], 1582);
+    EXPECT_EQ(config.prices[2], 0);
+    EXPECT_EQ(config.prices[3], 10000);
+    EXPECT_EQ(config.prices[4], 1234);
+    EXPECT_EQ(config.prices[5], 65535);
+    EXPECT_EQ(config.prices[9], 0);
+
+    config_get_json(r, false);
+    EXPECT_EQ(json::parse(r.s)["prices"], "0.1296,0.1582,0.0000,1.0000,0.1234,6.5535");
+
+    // valeurs refusées: les prix ne changent pas
+    EXPECT_FALSE(config_parse_prices("0.1,6.5536"));
+    EXPECT_FALSE(config_parse_prices("500000"));
+    EXPECT_FALSE(config_parse_prices("99999999999999"));
+    EXPECT_FALSE(config_parse_prices("0.1,abc"));
+    EXPECT_EQ(config.prices[0], 1296);
+    EXPECT_EQ(config.prices[5], 65535);
+
+    EXPECT_TRUE(config_parse_prices(""));
+    config_get_json(r, false);
+    EXPECT_EQ(json::parse(r.s)["prices"], "");
+}
+
+// prix absents ou refusés dans le formulaire
+TEST(config, form_prices)
+{
+    ESP8266WebServer server;
+
+    config_reset();
+    config.prices[0] = 1296;
+
+    server.query["save"] = "1";
+    config_handle_form(server, false);
+    EXPECT_EQ(ESP8266WebServer::send_code, 200);
+    EXPECT_EQ(config.prices[0], 1296);
+
+    server.query["prices"] = "500000";
+    config_handle_form(server, false);
+    EXPECT_EQ(ESP8266WebServer::send_code, 400);
+    EXPECT_EQ(config.prices[0], 1296);
+
+    server.query["prices"] = "0.2";
+    config_handle_form(server, false);
+    EXPECT_EQ(ESP8266WebServer::send_code, 200);
+    EXPECT_EQ(config.prices[0], 2000);
+}
+
 TEST(config, form)
 {
     ESP8266WebServer server;
@@ -0,0 +1,133 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests des pointes de puissance moyenne
+//
+
+#include "mock.h"
+
+#include "demand.h"
+
+// 2020-05-20 00:00:00 UTC
+static const uint32_t DEMAND_T0 = 1589932800;
+
+// date locale simplifiée: UTC
+static struct tm demand_tm(uint32_t sec)
+{
+    time_t t = sec;
+    struct tm tm;
+    gmtime_r(&t, &tm);
+    return tm;
+}
+
+// une trame toutes les 1.5 s de t0 à t1 exclu, à puissance constante
+static bool demand_run(DemandTracker &demand, uint32_t &ms, uint32_t t1_ms, uint16_t va)
+{
+    bool closed = false;
+    for (; ms < t1_ms; ms += 1500)
+    {
+        uint32_t sec = DEMAND_T0 + ms / 1000;
+        closed |= demand.add(sec, ms % 1000, va, demand_tm(sec));
+    }
+    return closed;
+}
+
+TEST(demand, vide)
+{
+    DemandTracker demand;
+
+    ASSERT_TRUE(demand.is_empty());
+    ASSERT_EQ(demand.seconds(0), 600);
+    ASSERT_EQ(demand.seconds(1), 1800);
+    ASSERT_EQ(demand.current(0), 0);
+    ASSERT_EQ(demand.last(0).va, 0);
+    ASSERT_EQ(demand.top(1, DemandTracker::MONTH)[0].va, 0);
+
+    demand.add(DEMAND_T0, 0, 1000, demand_tm(DEMAND_T0));
+    ASSERT_FALSE(demand.is_empty());
+    ASSERT_EQ(demand.current(0), 0);
+}
+
+TEST(demand, fenetres)
+{
+    DemandTracker demand;
+    uint32_t ms = 0;
+
+    // 5 min à 1000 VA puis 5 min à 3000 VA: 2000 VA sur 10 min
+    ASSERT_FALSE(demand_run(demand, ms, 300000, 1000));
+    ASSERT_EQ(demand.current(0), 1000);
+    ASSERT_FALSE(demand_run(demand, ms, 600000, 3000));
+
+    // la trame qui suit la fin de la fenêtre la termine
+    ASSERT_TRUE(demand_run(demand, ms, 601000, 500));
+    ASSERT_EQ(demand.last(0).time, DEMAND_T0);
+    ASSERT_EQ(demand.last(0).va, 2000);
+
+    // 20 min à 500 VA puis 10 min à 4000 VA
+    demand_run(demand, ms, 1800000, 500);
+    demand_run(demand, ms, 2401000, 4000);
+
+    // la fenêtre de 30 min fait (1000 * 5 + 3000 * 5 + 500 * 20) / 30
+    ASSERT_EQ(demand.last(1).time, DEMAND_T0);
+    ASSERT_EQ(demand.last(1).va, 1000);
+
+    // pointes du jour et du mois par ordre décroissant
+    const DemandTracker::Peak *top = demand.top(0, DemandTracker::DAY);
+    ASSERT_EQ(top[0].va, 4000);
+    ASSERT_EQ(top[0].time, DEMAND_T0 + 1800);
+    ASSERT_EQ(top[1].va, 2000);
+    ASSERT_EQ(top[1].time, DEMAND_T0);
+    ASSERT_EQ(top[2].va, 500);
+    ASSERT_EQ(demand.top(0, DemandTracker::MONTH)[1].va, 2000);
+}
+
+TEST(demand, interruption)
+{
+    DemandTracker demand;
+    uint32_t ms = 0;
+
+    // 2 min de trames seulement: la fenêtre de 10 min est ignorée
+    demand_run(demand, ms, 120000, 1000);
+    ms = 650000;
+    ASSERT_FALSE(demand_run(demand, ms, 651000, 2500));
+    ASSERT_EQ(demand.last(0).va, 0);
+    ASSERT_EQ(demand.top(0, DemandTracker::DAY)[0].va, 0);
+
+    // 6 min sur 10: la moyenne porte sur la durée couverte
+    demand_run(demand, ms, 1000000, 2500);
+    ms = 1250000;
+    ASSERT_TRUE(demand_run(demand, ms, 1251000, 2500));
+    ASSERT_EQ(demand.last(0).time, DEMAND_T0 + 600);
+    ASSERT_EQ(demand.last(0).va, 2500);
+
+    // retour de l'horloge en arrière: la fenêtre en cours repart de zéro
+    uint32_t sec = DEMAND_T0 + 100;
+    ASSERT_FALSE(demand.add(sec, 0, 500, demand_tm(sec)));
+    ASSERT_EQ(demand.current(0), 0);
+    ASSERT_EQ(demand.top(0, DemandTracker::DAY)[0].va, 2500);
+}
+
+TEST(demand, jours)
+{
+    DemandTracker demand;
+
+    // 23h50 à minuit le 31 mai à 6000 VA
+    uint32_t ms = (11 * 86400 + 23 * 3600 + 50 * 60) * 1000u;
+    demand_run(demand, ms, ms + 600000, 6000);
+    ASSERT_EQ(demand.top(0, DemandTracker::DAY)[0].va, 0);
+
+    // la fenêtre se termine le 1er juin: elle compte pour le 31 mai et pour mai
+    ASSERT_TRUE(demand_run(demand, ms, ms + 1000, 1000));
+    ASSERT_EQ(demand.last(0).va, 6000);
+    ASSERT_EQ(demand.top(0, DemandTracker::DAY)[0].va, 0);
+    ASSERT_EQ(demand.top(0, DemandTracker::MONTH)[0].va, 0);
+
+    demand_run(demand, ms, ms + 600000, 1000);
+    ASSERT_EQ(demand.top(0, DemandTracker::DAY)[0].va, 1000);
+    ASSERT_EQ(demand.top(0, DemandTracker::MONTH)[0].va, 1000);
+
+    demand.clear();
+    ASSERT_TRUE(demand.is_empty());
+    ASSERT_EQ(demand.top(0, DemandTracker::MONTH)[0].va, 0);
+}
@@ -32,6 +32,7 @@ class EEPRomTestCase(unittest.TestCase):
         self.assertEqual(config["psk"], "motdepasse")
         self.assertEqual(config["httpreq_freq"], 300)
         self.assertEqual(config["httpreq_port"], 80)
+        self.assertEqual(config["prices"], "0.1327,0.1654")
 
         eeprom2 = write_eeprom(config)
         self.assertEqual(eeprom2, eeprom)
@@ -0,0 +1,202 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests du journal en flash
+//
+
+#include "mock.h"
+
+#include "flashlog.h"
+
+static const uint8_t LOG_SECTORS = 4;
+static const uint32_t LOG_START = FS_PHYS_ADDR + FS_PHYS_SIZE - LOG_SECTORS * FLASH_SECTOR_SIZE;
+
+// relit le journal après un redémarrage
+static std::vector<FlashLog::Record> flashlog_reboot(FlashLog &log)
+{
+    std::vector<FlashLog::Record> records;
+    log.begin();
+    log.replay([&](const FlashLog::Record &r) { records.push_back(r); });
+    return records;
+}
+
+TEST(flashlog, vide)
+{
+    flash_hal_sim.reset();
+    FlashLog log(LOG_START, LOG_SECTORS);
+
+    ASSERT_EQ(flashlog_reboot(log).size(), 0u);
+    ASSERT_EQ(log.erases(), 0u);
+
+    // rien n'est écrit avant que le lot soit complet
+    log.append(1, 100, 1000);
+    ASSERT_EQ(log.pending(), 1u);
+    ASSERT_EQ(flash_hal_sim.writes, 0u);
+
+    log.flush();
+    ASSERT_EQ(log.pending(), 0u);
+    ASSERT_EQ(log.erases(), 1u);
+
+    auto records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), 1u);
+    ASSERT_EQ(records[0].period, 1u);
+    ASSERT_EQ(records[0].energy, 100u);
+    ASSERT_EQ(records[0].peak, 1000u);
+}
+
+TEST(flashlog, lots)
+{
+    flash_hal_sim.reset();
+    FlashLog log(LOG_START, LOG_SECTORS);
+    log.begin();
+
+    for (uint32_t i = 0; i < 10 * FlashLog::BATCH; ++i)
+    {
+        log.append(i, i * 10, i);
+    }
+
+    // un en-tête, puis une écriture par lot
+    ASSERT_EQ(log.pending(), 0u);
+    ASSERT_EQ(flash_hal_sim.writes, 1u + 10);
+
+    // les ajouts reprennent après le dernier enregistrement
+    auto records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), 10u * FlashLog::BATCH);
+    log.append(1000, 1, 1);
+    log.flush();
+
+    records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), 10u * FlashLog::BATCH + 1);
+    for (uint32_t i = 0; i < 10 * FlashLog::BATCH; ++i)
+    {
+        ASSERT_EQ(records[i].period, i);
+        ASSERT_EQ(records[i].energy, i * 10);
+    }
+    ASSERT_EQ(records.back().period, 1000u);
+}
+
+TEST(flashlog, usure)
+{
+    flash_hal_sim.reset();
+    FlashLog log(LOG_START, LOG_SECTORS);
+    log.begin();
+
+    // l'équivalent de 10 tours du journal, avec des redémarrages
+    const uint32_t total = 10 * LOG_SECTORS * FlashLog::records_per_sector();
+    for (uint32_t i = 0; i < total; ++i)
+    {
+        log.append(i, i, 0);
+        if (i % 1000 == 999)
+        {
+            log.flush();
+            log.begin();
+        }
+    }
+    log.flush();
+
+    // les secteurs sont effacés à tour de rôle
+    uint32_t first = (LOG_START - FS_PHYS_ADDR) / FLASH_SECTOR_SIZE;
+    for (uint8_t i = 0; i < LOG_SECTORS; ++i)
+    {
+        ASSERT_GE(flash_hal_sim.erase_count[first + i], 10u);
+        ASSERT_LE(flash_hal_sim.erase_count[first + i], 11u);
+    }
+
+    // les autres secteurs ne sont pas touchés
+    ASSERT_EQ(flash_hal_sim.erase_count[first - 1], 0u);
+
+    // le journal garde au moins sa capacité, dans l'ordre
+    auto records = flashlog_reboot(log);
+    ASSERT_GE(records.size(), log.capacity());
+    ASSERT_LE(records.size(), LOG_SECTORS * FlashLog::records_per_sector());
+    for (size_t i = 0; i < records.size(); ++i)
+    {
+        ASSERT_EQ(records[i].period, total - records.size() + i);
+    }
+}
+
+TEST(flashlog, coupure)
+{
+    flash_hal_sim.reset();
+    FlashLog log(LOG_START, LOG_SECTORS);
+    log.begin();
+
+    for (uint32_t i = 0; i < 2 * FlashLog::BATCH; ++i)
+    {
+        log.append(i, 100, 1000);
+    }
+
+    // coupure au milieu du second enregistrement du lot
+    flash_hal_sim.power_cut = sizeof(FlashLog::Record) + 5;
+    for (uint32_t i = 0; i < FlashLog::BATCH; ++i)
+    {
+        log.append(100 + i, 100, 1000);
+    }
+    ASSERT_EQ(log.errors(), 1u);
+    flash_hal_sim.power_cut = -1;
+
+    // l'enregistrement tronqué est ignoré, son emplacement n'est pas réutilisé
+    auto records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), 2u * FlashLog::BATCH + 1);
+    ASSERT_EQ(records.back().period, 100u);
+
+    log.append(200, 100, 1000);
+    log.flush();
+    records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), 2u * FlashLog::BATCH + 2);
+    ASSERT_EQ(records.back().period, 200u);
+    ASSERT_EQ(records[records.size() - 2].period, 100u);
+}
+
+TEST(flashlog, coupure_entete)
+{
+    flash_hal_sim.reset();
+    FlashLog log(LOG_START, LOG_SECTORS);
+    log.begin();
+
+    // remplit le premier secteur
+    for (uint32_t i = 0; i < FlashLog::records_per_sector(); ++i)
+    {
+        log.append(i, 1, 1);
+    }
+    log.flush();
+
+    // coupure pendant l'écriture de l'en-tête du second secteur
+    flash_hal_sim.power_cut = 6;
+    log.append(5000, 1, 1);
+    log.flush();
+    ASSERT_GE(log.errors(), 1u);
+    flash_hal_sim.power_cut = -1;
+
+    // le premier secteur est intact, le second sera effacé à nouveau
+    auto records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), FlashLog::records_per_sector());
+
+    log.append(6000, 1, 1);
+    log.flush();
+    records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), FlashLog::records_per_sector() + 1);
+    ASSERT_EQ(records.back().period, 6000u);
+}
+
+TEST(flashlog, corruption)
+{
+    flash_hal_sim.reset();
+    FlashLog log(LOG_START, LOG_SECTORS);
+    log.begin();
+
+    for (uint32_t i = 0; i < 3; ++i)
+    {
+        log.append(i, 100, 1000);
+    }
+    log.flush();
+
+    // un bit perdu dans le deuxième enregistrement
+    flash_hal_sim.data[LOG_START - FS_PHYS_ADDR + 12 + sizeof(FlashLog::Record) + 4] ^= 0x10;
+
+    auto records = flashlog_reboot(log);
+    ASSERT_EQ(records.size(), 2u);
+    ASSERT_EQ(records[0].period, 0u);
+    ASSERT_EQ(records[1].period, 2u);
+}
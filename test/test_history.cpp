@@ -0,0 +1,231 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests de l'historique de la consommation
+//
+
+#include "mock.h"
+
+#include "history.h"
+
+// 2020-05-20 00:00:00 UTC
+static const uint32_t HISTORY_T0 = 1589932800;
+
+TEST(history, vide)
+{
+    EnergyHistory history;
+
+    ASSERT_TRUE(history.is_empty());
+    ASSERT_EQ(history.minutes().size(), 0u);
+
+    history.add(HISTORY_T0 + 10, 1000, 500);
+    ASSERT_FALSE(history.is_empty());
+    ASSERT_EQ(history.minutes().size(), 0u);
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).period, (HISTORY_T0 + 10) / 60);
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).energy, 0u);
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).peak, 500u);
+}
+
+TEST(history, cumuls)
+{
+    EnergyHistory history;
+    uint32_t wh = 1000;
+
+    // 3 heures à 1 Wh toutes les 2 s, avec une pointe à la fin de chaque heure
+    for (uint32_t t = 0; t < 3 * 3600; t += 2)
+    {
+        history.add(HISTORY_T0 + t, wh, (t % 3600 == 3598) ? 6000 : 1800);
+        wh += 1;
+    }
+
+    const EnergyHistory::Minutes &minutes = history.minutes();
+    ASSERT_EQ(minutes.size(), 3u * 60 - 1);
+    ASSERT_EQ(minutes.first_period(), HISTORY_T0 / 60);
+
+    // l'énergie mesurée par une trame va à la période de la trame précédente
+    for (size_t i = 0; i < minutes.size(); ++i)
+    {
+        ASSERT_EQ(minutes.energy(i), 30u);
+        ASSERT_EQ(minutes.peak(i), (i % 60 == 59) ? 6000u : 1800u);
+    }
+
+    const EnergyHistory::Hours &hours = history.hours();
+    ASSERT_EQ(hours.size(), 2u);
+    ASSERT_EQ(hours.first_period(), HISTORY_T0 / 3600);
+    ASSERT_EQ(hours.energy(0), 1800u);
+    ASSERT_EQ(hours.energy(1), 1800u);
+    ASSERT_EQ(hours.peak(0), 6000u);
+
+    // la période en cours cumule les périodes plus fines pas encore versées
+    EnergyHistory::Current hour = history.current(EnergyHistory::HOUR);
+    ASSERT_EQ(hour.period, HISTORY_T0 / 3600 + 2);
+    ASSERT_EQ(hour.energy, 1799u);
+    ASSERT_EQ(hour.peak, 6000u);
+
+    EnergyHistory::Current day = history.current(EnergyHistory::DAY);
+    ASSERT_EQ(history.days().size(), 0u);
+    ASSERT_EQ(day.energy, 3u * 1800 - 1);
+    ASSERT_EQ(day.peak, 6000u);
+}
+
+TEST(history, capacite)
+{
+    EnergyHistory history;
+    uint32_t wh = 0;
+
+    // 3 jours à une mesure par minute
+    for (uint32_t t = 0; t <= 3 * 86400; t += 60)
+    {
+        history.add(HISTORY_T0 + t, wh, 100);
+        wh += 2;
+    }
+
+    // les minutes sont limitées à 24 h, glissantes
+    const EnergyHistory::Minutes &minutes = history.minutes();
+    ASSERT_EQ(minutes.size(), EnergyHistory::Minutes::CAPACITY);
+    ASSERT_EQ(minutes.first_period(), (HISTORY_T0 + 3 * 86400) / 60 - EnergyHistory::Minutes::CAPACITY);
+    ASSERT_EQ(minutes.energy(0), 2u);
+    ASSERT_EQ(minutes.energy(minutes.size() - 1), 2u);
+
+    ASSERT_EQ(history.hours().size(), 72u);
+    ASSERT_EQ(history.hours().energy(71), 120u);
+
+    ASSERT_EQ(history.days().size(), 3u);
+    ASSERT_EQ(history.days().energy(2), 2880u);
+    ASSERT_EQ(history.days().peak(2), 100u);
+}
+
+TEST(history, interruption)
+{
+    EnergyHistory history;
+
+    history.add(HISTORY_T0, 1000, 100);
+    history.add(HISTORY_T0 + 30, 1001, 200);
+
+    // 10 minutes sans téléinformation: périodes vides
+    history.add(HISTORY_T0 + 630, 1011, 300);
+
+    const EnergyHistory::Minutes &minutes = history.minutes();
+    ASSERT_EQ(minutes.size(), 10u);
+    ASSERT_EQ(minutes.first_period(), HISTORY_T0 / 60);
+
+    // l'énergie de l'interruption va à la dernière période connue
+    ASSERT_EQ(minutes.energy(0), 11u);
+    ASSERT_EQ(minutes.peak(0), 200u);
+    for (size_t i = 1; i < 10; ++i)
+    {
+        ASSERT_EQ(minutes.energy(i), 0u);
+        ASSERT_EQ(minutes.peak(i), 0u);
+    }
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).peak, 300u);
+
+    // deux jours sans téléinformation: les minutes repartent de zéro
+    history.add(HISTORY_T0 + 2 * 86400 + 30, 1020, 400);
+    ASSERT_EQ(minutes.size(), 1u);
+    ASSERT_EQ(minutes.first_period() + minutes.size(), history.current(EnergyHistory::MINUTE).period);
+    ASSERT_EQ(history.days().size(), 2u);
+    ASSERT_EQ(history.days().energy(0), 20u);
+}
+
+TEST(history, horloge)
+{
+    EnergyHistory history;
+
+    // avant la mise à l'heure: secondes depuis le démarrage, ou date par défaut
+    ASSERT_FALSE(history.add(10, 1000, 100));
+    ASSERT_FALSE(history.add(1510592825, 1010, 100));
+    ASSERT_TRUE(history.is_empty());
+
+    history.add(HISTORY_T0, 1020, 100);
+    history.add(HISTORY_T0 + 120, 1030, 100);
+    ASSERT_EQ(history.minutes().size(), 2u);
+
+    // petit recul de l'horloge (correction NTP): la mesure compte dans la minute en cours
+    history.add(HISTORY_T0 + 119, 1040, 100);
+    ASSERT_EQ(history.minutes().size(), 2u);
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).energy, 10u);
+    history.add(HISTORY_T0 + 60, 1045, 100);
+    ASSERT_EQ(history.minutes().size(), 2u);
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).period, (HISTORY_T0 + 120) / 60);
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).energy, 15u);
+
+    // puis l'historique continue quand l'heure a rattrapé la dernière mesure
+    history.add(HISTORY_T0 + 180, 1050, 100);
+    ASSERT_EQ(history.minutes().size(), 3u);
+    ASSERT_EQ(history.minutes().energy(2), 20u);
+
+    // l'horloge recule de plus d'une heure: l'historique recommence
+    history.add(HISTORY_T0 - 3600, 1060, 100);
+    ASSERT_EQ(history.minutes().size(), 0u);
+    ASSERT_EQ(history.current(EnergyHistory::MINUTE).energy, 0u);
+}
+
+TEST(history, heure_terminee)
+{
+    EnergyHistory history;
+
+    ASSERT_FALSE(history.add(HISTORY_T0 + 3000, 1000, 100));
+    ASSERT_FALSE(history.add(HISTORY_T0 + 3590, 1100, 900));
+    ASSERT_TRUE(history.add(HISTORY_T0 + 3610, 1200, 100));
+    ASSERT_EQ(history.closed_hour().period, HISTORY_T0 / 3600);
+    ASSERT_EQ(history.closed_hour().energy, 200u);
+    ASSERT_EQ(history.closed_hour().peak, 900u);
+    ASSERT_FALSE(history.add(HISTORY_T0 + 3620, 1200, 100));
+}
+
+TEST(history, rechargement)
+{
+    EnergyHistory history;
+    uint32_t hour0 = HISTORY_T0 / 3600;
+
+    // 36 heures sauvegardées: la veille entière et 12 heures du jour
+    for (uint32_t h = 0; h < 36; ++h)
+    {
+        history.restore(hour0 + h, 100 + h, 1000 + h);
+    }
+
+    // ignorée: déjà connue
+    history.restore(hour0 + 10, 5000, 9000);
+
+    ASSERT_TRUE(history.is_empty());
+    ASSERT_EQ(history.hours().size(), 36u);
+    ASSERT_EQ(history.hours().energy(10), 110u);
+
+    // redémarrage à 12h30 le même jour
+    history.add(HISTORY_T0 + 86400 + 12 * 3600 + 1800, 50000, 200);
+
+    ASSERT_EQ(history.days().size(), 1u);
+    ASSERT_EQ(history.days().first_period(), HISTORY_T0 / 86400);
+    ASSERT_EQ(history.days().energy(0), 24u * 100 + 23 * 24 / 2);
+    ASSERT_EQ(history.days().peak(0), 1023u);
+
+    // le jour en cours contient les heures rechargées
+    EnergyHistory::Current day = history.current(EnergyHistory::DAY);
+    ASSERT_EQ(day.period, HISTORY_T0 / 86400 + 1);
+    ASSERT_EQ(day.energy, 12u * 124 + 11 * 12 / 2);
+    ASSERT_EQ(day.peak, 1035u);
+
+    // l'heure en cours suit les heures rechargées
+    history.add(HISTORY_T0 + 86400 + 13 * 3600 + 10, 50100, 200);
+    ASSERT_EQ(history.hours().size(), 37u);
+    ASSERT_EQ(history.hours().last_period(), hour0 + 36);
+    ASSERT_EQ(history.hours().energy(36), 100u);
+}
+
+TEST(history, rechargement_ancien)
+{
+    EnergyHistory history;
+    uint32_t hour0 = HISTORY_T0 / 3600;
+
+    history.restore(hour0, 100, 1000);
+    history.restore(hour0 + 1, 100, 1000);
+
+    // redémarrage trois jours plus tard
+    history.add(HISTORY_T0 + 3 * 86400, 1000, 100);
+
+    ASSERT_EQ(history.days().size(), 3u);
+    ASSERT_EQ(history.days().energy(0), 200u);
+    ASSERT_EQ(history.days().energy(2), 0u);
+    ASSERT_EQ(history.current(EnergyHistory::DAY).energy, 0u);
+}
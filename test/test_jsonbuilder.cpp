@@ -0,0 +1,129 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests des constructeurs JSON et de l'envoi par morceaux
+//
+
+#include "mock.h"
+
+#include "chunkedoutput.h"
+#include "jsonbuilder.h"
+
+// vérifie le découpage en morceaux et retourne le texte transmis
+static std::string jsonbuilder_dechunk(const std::vector<std::string> &chunks)
+{
+    std::string text;
+
+    // un sendContent() par morceau, un vide pour terminer la réponse
+    EXPECT_GE(chunks.size(), 1u);
+    EXPECT_EQ(chunks.back(), "");
+
+    for (size_t i = 0; i + 1 < chunks.size(); ++i)
+    {
+        EXPECT_NE(chunks[i].size(), 0u);
+        EXPECT_LE(chunks[i].size(), static_cast<size_t>(ChunkedOutput::BUFFER_SIZE));
+        text += chunks[i];
+    }
+    return text;
+}
+
+TEST(jsonbuilder, vide)
+{
+    ESP8266WebServer server;
+    ESP8266WebServer::chunks.clear();
+
+    ChunkedOutput output(server);
+    BasicJSONBuilder<ChunkedOutput> js(output, 100);
+    js.finalize();
+    output.end();
+
+    ASSERT_EQ(output.chunks(), 1u);
+    ASSERT_EQ(ESP8266WebServer::chunks.size(), 2u);
+    ASSERT_EQ(ESP8266WebServer::chunks[0], "{}");
+
+    ESP8266WebServer::chunks.clear();
+
+    ChunkedOutput table(server);
+    BasicJSONTableBuilder<ChunkedOutput> jt(table);
+    jt.finalize();
+    table.end();
+
+    ASSERT_EQ(jsonbuilder_dechunk(ESP8266WebServer::chunks), "[]");
+}
+
+TEST(jsonbuilder, morceaux)
+{
+    ESP8266WebServer server;
+    ESP8266WebServer::chunks.clear();
+
+    String s;
+    JSONBuilder js(s, 0);
+
+    ChunkedOutput output(server);
+    BasicJSONBuilder<ChunkedOutput> jc(output);
+
+    char name[16];
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        sprintf(name, "label%u", i);
+        js.append(name, i * 1000003);
+        jc.append(name, i * 1000003);
+        js.append(F("texte"), "valeur");
+        jc.append(F("texte"), "valeur");
+    }
+    js.append("ADCO", "012345678901", true);
+    jc.append("ADCO", "012345678901", true);
+    output.end();
+
+    ASSERT_GT(s.length(), 3000u);
+    ASSERT_EQ(output.length(), s.length());
+    ASSERT_EQ(jsonbuilder_dechunk(ESP8266WebServer::chunks), s.s);
+
+    // morceaux pleins, sauf le dernier
+    ASSERT_EQ(output.chunks(), ESP8266WebServer::chunks.size() - 1);
+    ASSERT_EQ(output.chunks(), (s.length() + ChunkedOutput::BUFFER_SIZE - ChunkedOutput::KEEP - 1) /
+                                   (ChunkedOutput::BUFFER_SIZE - ChunkedOutput::KEEP));
+    ASSERT_EQ(ESP8266WebServer::chunks[0].size(), ChunkedOutput::BUFFER_SIZE - ChunkedOutput::KEEP);
+}
+
+TEST(jsonbuilder, finalize)
+{
+    ESP8266WebServer server;
+
+    // finalize() modifie la fin du texte: toutes les positions par rapport aux morceaux
+    for (size_t pad = 0; pad < 2 * ChunkedOutput::BUFFER_SIZE; ++pad)
+    {
+        std::string value(pad, 'x');
+
+        String s;
+        JSONBuilder js(s);
+        js.append("a", value.c_str());
+        js.append("b", pad);
+        js.finalize();
+
+        ESP8266WebServer::chunks.clear();
+        ChunkedOutput output(server);
+        BasicJSONBuilder<ChunkedOutput> jc(output);
+        jc.append("a", value.c_str());
+        jc.append("b", pad);
+        jc.finalize();
+        output.end();
+
+        ASSERT_EQ(jsonbuilder_dechunk(ESP8266WebServer::chunks), s.s);
+
+        String t;
+        JSONTableBuilder jt(t);
+        jt.append("a", value.c_str());
+        jt.finalize();
+
+        ESP8266WebServer::chunks.clear();
+        ChunkedOutput table(server);
+        BasicJSONTableBuilder<ChunkedOutput> jct(table);
+        jct.append("a", value.c_str());
+        jct.finalize();
+        table.end();
+
+        ASSERT_EQ(jsonbuilder_dechunk(ESP8266WebServer::chunks), t.s);
+    }
+}
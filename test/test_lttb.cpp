@@ -0,0 +1,139 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests du sous-échantillonnage des séries temporelles
+//
+
+#include "mock.h"
+
+#include "timeseries.h"
+#include "lttb.h"
+
+#include <vector>
+
+typedef TimeSeries<64, 256> LttbSeries;
+
+// 2020-05-20 00:00:00 UTC
+static const uint32_t LTTB_T0 = 1589932800;
+
+// une trame toutes les 1.2 à 1.5 s, puissance en dents de scie avec quelques pointes
+static std::vector<TimeSample> lttb_samples(LttbSeries &series, size_t n)
+{
+    std::vector<TimeSample> samples;
+    uint32_t ms = 0;
+
+    series.clear();
+    for (size_t i = 0; i < n; ++i)
+    {
+        TimeSample s;
+        ms += 1200 + (i * 97) % 300;
+        s.sec = LTTB_T0 + ms / 1000;
+        s.ms = ms % 1000;
+        s.values[0] = 52890470;
+        s.values[1] = 49126843 + i / 3;
+        s.values[2] = (i % 397 == 200) ? 9000 : 500 + (i * 37) % 1500;
+        s.values[3] = s.values[2] / 230;
+        series.add(s);
+        samples.push_back(s);
+    }
+    return samples;
+}
+
+// LTTB d'après la description originale, sur toute la série en mémoire
+static std::vector<size_t> lttb_reference(const std::vector<TimeSample> &data, size_t points)
+{
+    size_t n = data.size();
+    size_t buckets = points - 2;
+    auto date = [&](size_t i) { return (static_cast<int64_t>(data[i].sec) - data[0].sec) * 1000 + data[i].ms; };
+    auto start = [&](size_t b) { return 1 + b * (n - 2) / buckets; };
+
+    std::vector<size_t> selected{0};
+    for (size_t b = 0; b < buckets; ++b)
+    {
+        size_t from = start(b + 1);
+        size_t end = (b + 1 < buckets) ? start(b + 2) : n;
+        int64_t ct = 0, cv = 0;
+        for (size_t i = from; i < end; ++i)
+        {
+            ct += date(i);
+            cv += data[i].values[2];
+        }
+        ct /= static_cast<int64_t>(end - from);
+        cv /= static_cast<int64_t>(end - from);
+
+        size_t a = selected.back();
+        int64_t best_area = -1;
+        size_t best = 0;
+        for (size_t i = start(b); i < start(b + 1); ++i)
+        {
+            int64_t area = std::abs((date(a) - ct) * (static_cast<int64_t>(data[i].values[2]) - data[a].values[2]) -
+                                    (date(a) - date(i)) * (cv - data[a].values[2]));
+            if (area > best_area)
+            {
+                best_area = area;
+                best = i;
+            }
+        }
+        selected.push_back(best);
+    }
+    selected.push_back(n - 1);
+    return selected;
+}
+
+TEST(lttb, petite_serie)
+{
+    LttbSeries series;
+    std::vector<TimeSample> samples = lttb_samples(series, 40);
+    std::vector<TimeSample> out;
+
+    // moins de trames que de points: tout est transmis
+    ASSERT_EQ(lttb(series, 100, 2, [&](const TimeSample &s) { out.push_back(s); }), 40u);
+    ASSERT_EQ(out.size(), 40u);
+    ASSERT_EQ(out[39].values[2], samples[39].values[2]);
+
+    // au moins 3 points: la première, la dernière et une au milieu
+    out.clear();
+    ASSERT_EQ(lttb(series, 1, 2, [&](const TimeSample &s) { out.push_back(s); }), 3u);
+    ASSERT_EQ(out.size(), 3u);
+    ASSERT_EQ(out[0].sec, samples[0].sec);
+    ASSERT_EQ(out[2].sec, samples[39].sec);
+
+    series.clear();
+    ASSERT_EQ(lttb(series, 10, 2, [&](const TimeSample &) {}), 0u);
+}
+
+TEST(lttb, reference)
+{
+    LttbSeries series;
+    std::vector<TimeSample> samples = lttb_samples(series, 3000);
+    ASSERT_EQ(series.size(), 3000u);
+
+    for (size_t points : {3, 17, 100, 500, 2999})
+    {
+        std::vector<TimeSample> out;
+        ASSERT_EQ(lttb(series, points, 2, [&](const TimeSample &s) { out.push_back(s); }), points);
+        ASSERT_EQ(out.size(), points);
+
+        std::vector<size_t> expected = lttb_reference(samples, points);
+        for (size_t i = 0; i < points; ++i)
+        {
+            const TimeSample &s = samples[expected[i]];
+            ASSERT_EQ(out[i].sec, s.sec);
+            ASSERT_EQ(out[i].ms, s.ms);
+            ASSERT_EQ(out[i].values[1], s.values[1]);
+            ASSERT_EQ(out[i].values[2], s.values[2]);
+        }
+    }
+}
+
+TEST(lttb, pointes)
+{
+    LttbSeries series;
+    lttb_samples(series, 3000);
+
+    // les pointes à 9000 VA survivent à une réduction par 30
+    size_t spikes = 0;
+    lttb(series, 100, 2, [&](const TimeSample &s) { spikes += (s.values[2] == 9000); });
+    ASSERT_EQ(spikes, 8u);
+}
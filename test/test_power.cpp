@@ -0,0 +1,321 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests de l'estimation de la puissance
+//
+
+#include "mock.h"
+
+#include "power.h"
+
+#include <deque>
+#include <random>
+
+TEST(power, vide)
+{
+    PowerEstimator power{10, 60, 300};
+
+    ASSERT_EQ(power.watt(60), 0u);
+
+    // une seule mesure: pas d'écart
+    power.add(1000, 52890470);
+    ASSERT_EQ(power.watt(10), 0u);
+    ASSERT_EQ(power.watt(60), 0u);
+    ASSERT_EQ(power.quality(60), 0u);
+
+    // l'index ne bouge pas
+    for (int i = 1; i <= 10; ++i)
+    {
+        power.add(1000 + i * 1500, 52890470);
+    }
+    ASSERT_EQ(power.watt(60), 0u);
+    ASSERT_EQ(power.quality(60), 0u);
+}
+
+TEST(power, constante)
+{
+    PowerEstimator power{10, 60, 300};
+    uint32_t ms = 0;
+
+    // 1800 W: 1 Wh toutes les 2 s
+    for (int i = 0; i <= 200; ++i)
+    {
+        power.add(ms, 1000 + i);
+        ms += 2000;
+    }
+
+    ASSERT_EQ(power.watt(10), 1800u);
+    ASSERT_EQ(power.watt(60), 1800u);
+    ASSERT_EQ(power.watt(300), 1800u);
+    ASSERT_EQ(power.quality(300), 1000u);
+
+    // les fenêtres ne dépassent pas leur durée
+    ASSERT_EQ(power.span_ms(10), 10000u);
+    ASSERT_EQ(power.span_ms(60), 60000u);
+    ASSERT_EQ(power.span_ms(300), 300000u);
+
+    // fenêtre inexistante: la plus proche
+    ASSERT_EQ(power.span_ms(50), 60000u);
+}
+
+TEST(power, fenetres)
+{
+    PowerEstimator power{10, 60, 300};
+    uint32_t ms = 0;
+    uint32_t wh = 0;
+
+    // 5 minutes à 720 W (1 Wh toutes les 5 s)...
+    for (int i = 0; i < 60; ++i)
+    {
+        power.add(ms, wh);
+        ms += 5000;
+        wh += 1;
+    }
+
+    // ... puis 20 secondes à 3600 W (1 Wh par seconde)
+    for (int i = 0; i < 20; ++i)
+    {
+        power.add(ms, wh);
+        ms += 1000;
+        wh += 1;
+    }
+    power.add(ms, wh);
+
+    ASSERT_EQ(power.watt(10), 3600u);
+    ASSERT_EQ(power.quality(10), 1000u);
+
+    // la régression suit la pente récente plus que la moyenne sur la fenêtre
+    ASSERT_GT(power.watt(60), power.watt_endpoints(60));
+    ASSERT_LT(power.watt(60), 3600u);
+    ASSERT_GT(power.watt(300), 720u);
+    ASSERT_LT(power.watt(300), power.watt(60));
+
+    // deux régimes: l'alignement n'est pas parfait
+    ASSERT_LT(power.quality(60), 1000u);
+    ASSERT_GT(power.quality(60), 800u);
+}
+
+TEST(power, capacite)
+{
+    PowerEstimator power{10, 60, 300};
+    uint32_t ms = 0;
+
+    // plus de mesures que l'historique n'en contient pour 5 minutes:
+    // la fenêtre de 300 s est limitée à CAPACITY écarts
+    for (size_t i = 0; i <= 2 * PowerEstimator::CAPACITY; ++i)
+    {
+        power.add(ms, 1000 + i);
+        ms += 500;
+    }
+
+    ASSERT_EQ(power.span_ms(300), PowerEstimator::CAPACITY * 500);
+    ASSERT_EQ(power.watt(300), 7200u);
+    ASSERT_EQ(power.watt(10), 7200u);
+}
+
+TEST(power, ruptures)
+{
+    PowerEstimator power{10, 60};
+
+    power.add(0, 1000);
+    power.add(2000, 1001);
+    ASSERT_EQ(power.watt(10), 1800u);
+
+    // même instant: ignoré
+    power.add(2000, 1005);
+    ASSERT_EQ(power.watt(10), 1800u);
+
+    // l'index diminue (changement de compteur): on repart de zéro
+    power.add(4000, 10);
+    ASSERT_EQ(power.watt(10), 0u);
+    power.add(6000, 11);
+    ASSERT_EQ(power.watt(10), 1800u);
+
+    // interruption trop longue
+    power.add(6000 + 70000, 12);
+    ASSERT_EQ(power.watt(60), 0u);
+
+    // saut d'horloge en arrière
+    power.add(1000, 13);
+    ASSERT_EQ(power.watt(60), 0u);
+    power.add(3000, 14);
+    ASSERT_EQ(power.watt(60), 1800u);
+}
+
+TEST(power, debordement_horloge)
+{
+    PowerEstimator power{10, 60};
+
+    // millis() repasse par zéro au bout de 49 jours
+    uint32_t ms = UINT32_MAX - 20000;
+    for (int i = 0; i <= 20; ++i)
+    {
+        power.add(ms, 1000 + i);
+        ms += 2000;
+    }
+
+    ASSERT_EQ(power.watt(10), 1800u);
+    ASSERT_EQ(power.watt(60), 1800u);
+    ASSERT_EQ(power.span_ms(60), 40000u);
+    ASSERT_EQ(power.quality(60), 1000u);
+}
+
+// flux de mesures à la manière de tools/simutic.py: une trame toutes les 1.2 à 1.5 s,
+// puissance tirée avec un cos φ aléatoire, index arrondi au Wh
+class SimuPower
+{
+    std::mt19937 rng_{1234};
+    std::deque<std::pair<uint32_t, double>> history_; // énergie exacte à chaque mesure
+
+public:
+    uint32_t ms{0};
+    double energy{100000.5};
+
+    template <typename F>
+    void step(PowerEstimator &power, F papp)
+    {
+        uint32_t dt = std::uniform_int_distribution<uint32_t>(1200, 1500)(rng_);
+        double cos_phi = std::uniform_real_distribution<double>(0.85, 1.15)(rng_);
+        energy += papp(ms) * cos_phi * dt / 3600000.;
+        ms += dt;
+
+        power.add(ms, static_cast<uint32_t>(std::lround(energy)));
+
+        history_.emplace_back(ms, energy);
+        while (history_.size() > 512)
+        {
+            history_.pop_front();
+        }
+    }
+
+    // puissance moyenne exacte sur la durée couverte par l'estimateur
+    double reference(uint32_t span_ms) const
+    {
+        for (const auto &h : history_)
+        {
+            if (h.first == ms - span_ms)
+            {
+                return (energy - h.second) * 3600000. / span_ms;
+            }
+        }
+        return -1;
+    }
+};
+
+// erreurs moyennes par rapport à la puissance exacte et variation moyenne d'une mesure à l'autre
+struct SimuErrors
+{
+    double regression{0};
+    double endpoints{0};
+    double step_regression{0};
+    double step_endpoints{0};
+    uint16_t quality_min{1000};
+};
+
+// compare la régression et la pente entre les mesures extrêmes à la puissance exacte
+template <typename F>
+static SimuErrors simu_errors(uint32_t seconds, F papp)
+{
+    PowerEstimator power{10, 60, 300};
+    SimuPower simu;
+    SimuErrors err;
+    uint32_t prev_regression = 0;
+    uint32_t prev_endpoints = 0;
+    int n = 0;
+
+    for (int i = 0; i < 2000; ++i)
+    {
+        simu.step(power, papp);
+
+        // la fenêtre doit être remplie
+        if (i < 300)
+        {
+            continue;
+        }
+
+        double ref = simu.reference(power.span_ms(seconds));
+        uint32_t regression = power.watt(seconds);
+        uint32_t endpoints = power.watt_endpoints(seconds);
+
+        err.regression += fabs(regression - ref);
+        err.endpoints += fabs(endpoints - ref);
+        if (n != 0)
+        {
+            err.step_regression += abs(static_cast<int>(regression - prev_regression));
+            err.step_endpoints += abs(static_cast<int>(endpoints - prev_endpoints));
+        }
+        err.quality_min = std::min(err.quality_min, power.quality(seconds));
+
+        prev_regression = regression;
+        prev_endpoints = endpoints;
+        ++n;
+    }
+
+    err.regression /= n;
+    err.endpoints /= n;
+    err.step_regression /= n - 1;
+    err.step_endpoints /= n - 1;
+    return err;
+}
+
+TEST(power, simu_constante)
+{
+    auto constante = [](uint32_t) { return 1000.; };
+
+    for (uint32_t seconds : {10, 60, 300})
+    {
+        SimuErrors err = simu_errors(seconds, constante);
+
+        // l'arrondi de l'index au Wh fait sauter la pente entre les extrêmes,
+        // la régression en est beaucoup moins affectée
+        ASSERT_LT(err.regression, 0.6 * err.endpoints);
+        ASSERT_LT(err.step_regression, 0.6 * err.step_endpoints);
+        ASSERT_GT(err.quality_min, (seconds == 10) ? 800 : 990);
+    }
+}
+
+TEST(power, simu_rampe)
+{
+    // de 500 W à 3500 W en 40 minutes
+    auto rampe = [](uint32_t ms) { return 500. + 3000. * ms / 2400000.; };
+
+    for (uint32_t seconds : {10, 60, 300})
+    {
+        SimuErrors err = simu_errors(seconds, rampe);
+
+        ASSERT_LT(err.step_regression, err.step_endpoints);
+        ASSERT_LT(err.regression, (seconds == 10) ? 100 : 15);
+        ASSERT_GT(err.quality_min, (seconds == 10) ? 800 : 990);
+    }
+
+    // la fenêtre courte est dominée par la résolution de l'index
+    SimuErrors err = simu_errors(10, rampe);
+    ASSERT_LT(err.regression, err.endpoints);
+}
+
+TEST(power, simu_sinus)
+{
+    // intensité de simutic.py: 20 A * |sin(t / 100 s)|
+    auto sinus = [](uint32_t ms) { return 20. * 230. * fabs(sin(ms / 100000.)); };
+
+    // sur 300 s, la pente entre les extrêmes est une moyenne sur une longue durée:
+    // elle varie moins d'une trame à l'autre que la régression, qui pondère le milieu
+    for (uint32_t seconds : {10, 60})
+    {
+        SimuErrors err = simu_errors(seconds, sinus);
+
+        ASSERT_LT(err.step_regression, err.step_endpoints);
+    }
+
+    // la puissance varie vite: la régression pondère davantage le milieu de la fenêtre
+    // et s'écarte un peu de la moyenne, sans dépasser la résolution sur 10 s
+    SimuErrors err = simu_errors(10, sinus);
+    ASSERT_LT(err.regression, err.endpoints);
+    err = simu_errors(60, sinus);
+    ASSERT_LT(err.regression, 60);
+
+    // sur 300 s la puissance passe par zéro: la droite s'écarte des mesures
+    err = simu_errors(300, sinus);
+    ASSERT_LT(err.quality_min, 980u);
+}
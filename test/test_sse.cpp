@@ -0,0 +1,358 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests des Server-sent Events
+//
+
+#include "mock.h"
+
+#include "sse.h"
+
+static const char sse_headers_end[] = "Cache-Control: no-cache\r\n\r\n";
+
+// ouvre une connexion SSE et retourne sa socket
+static WiFiClient::Socket &sse_connect(SseClients &clients, ESP8266WebServer &server)
+{
+    server.query.insert({"labels", ""}); // toutes les étiquettes sauf indication contraire
+    server.current_client = WiFiClient();
+    clients.handle_sse_data(server);
+    return server.current_client.socket();
+}
+
+TEST(sse, envoi)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+
+    WiFiClient::Socket &socket = sse_connect(clients, server);
+    ASSERT_EQ(clients.count(), 1u);
+    ASSERT_EQ(socket.sent.find("HTTP/1.1 200 OK\r\n"), 0u);
+
+    size_t headers = socket.sent.find(sse_headers_end);
+    ASSERT_NE(headers, std::string::npos);
+    socket.sent.erase(0, headers + strlen(sse_headers_end));
+
+    String data("{\"PAPP\":1890}");
+    clients.handle_clients(&data);
+    clients.handle_clients(&data, "demand");
+    ASSERT_EQ(socket.sent, "id: 1\r\ndata: {\"PAPP\":1890}\r\n\r\n"
+                           "id: 2\r\nevent: demand\r\ndata: {\"PAPP\":1890}\r\n\r\n");
+
+    // client déconnecté: il est supprimé au passage suivant
+    socket.connected = false;
+    clients.handle_clients();
+    ASSERT_EQ(clients.count(), 0u);
+}
+
+TEST(sse, socket_bloquee)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+
+    WiFiClient::Socket &slow = sse_connect(clients, server);
+    WiFiClient::Socket &fast = sse_connect(clients, server);
+    ASSERT_EQ(clients.count(), 2u);
+    slow.sent.clear();
+    fast.sent.clear();
+
+    // la socket du premier client n'accepte que 10 octets
+    slow.window = 10;
+
+    String data;
+    for (int i = 0; i < 20; ++i)
+    {
+        data = "trame " + String(i);
+        clients.handle_clients(&data);
+        clients.handle_clients(&data, "demand");
+    }
+
+    // le client rapide a tout reçu
+    ASSERT_NE(fast.sent.find("id: 39\r\ndata: trame 19\r\n\r\nid: 40\r\nevent: demand\r\n"), std::string::npos);
+
+    // le client lent n'a reçu que ce que sa socket acceptait, sans bloquer
+    ASSERT_EQ(slow.sent, "id: 1\r\ndat");
+    ASSERT_EQ(slow.window, 0u);
+
+    // la socket se débloque: fin de l'événement en cours puis le plus récent de chaque nom
+    slow.window = SIZE_MAX;
+    clients.handle_clients();
+    ASSERT_EQ(slow.sent, "id: 1\r\ndata: trame 0\r\n\r\n"
+                         "id: 39\r\ndata: trame 19\r\n\r\n"
+                         "id: 40\r\nevent: demand\r\ndata: trame 19\r\n\r\n");
+}
+
+TEST(sse, file_pleine)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+
+    WiFiClient::Socket &socket = sse_connect(clients, server);
+    socket.sent.clear();
+    socket.window = 0;
+
+    // 3 noms d'événement pour 2 places: le plus ancien est perdu
+    String a("a"), b("b"), c("c"), d("d");
+    clients.handle_clients(&a, "un");
+    clients.handle_clients(&b, "deux");
+    clients.handle_clients(&c, "trois");
+    clients.handle_clients(&d, "trois");
+    ASSERT_EQ(socket.sent, "");
+
+    socket.window = SIZE_MAX;
+    clients.handle_clients();
+    ASSERT_EQ(socket.sent, "id: 2\r\nevent: deux\r\ndata: b\r\n\r\nid: 4\r\nevent: trois\r\ndata: d\r\n\r\n");
+}
+
+TEST(sse, pool)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+    WiFiClient::Socket *sockets[SSE_MAX_CLIENTS];
+
+    for (size_t i = 0; i < SseClients::capacity(); ++i)
+    {
+        sockets[i] = &sse_connect(clients, server);
+    }
+    ASSERT_EQ(clients.count(), static_cast<size_t>(SSE_MAX_CLIENTS));
+
+    // pool plein
+    ESP8266WebServer::send_called = 0;
+    WiFiClient::Socket &refused = sse_connect(clients, server);
+    ASSERT_EQ(ESP8266WebServer::send_called, 1);
+    ASSERT_EQ(ESP8266WebServer::send_code, 503);
+    ASSERT_EQ(refused.sent, "");
+
+    // tous envoient le même événement
+    String data("{}");
+    clients.handle_clients(&data);
+    for (auto socket : sockets)
+    {
+        ASSERT_EQ(socket->sent.substr(socket->sent.length() - 19), "id: 1\r\ndata: {}\r\n\r\n");
+    }
+
+    // une déconnexion libère un emplacement
+    sockets[1]->connected = false;
+    clients.handle_clients();
+    ASSERT_EQ(clients.count(), static_cast<size_t>(SSE_MAX_CLIENTS - 1));
+    WiFiClient::Socket &socket = sse_connect(clients, server);
+    ASSERT_EQ(socket.sent.find("HTTP/1.1 200 OK\r\n"), 0u);
+    ASSERT_EQ(clients.count(), static_cast<size_t>(SSE_MAX_CLIENTS));
+
+    // le pool ne contient que les sockets, les curseurs et les abonnements
+    ASSERT_LE(SseClients::client_size(), sizeof(WiFiClient) + SSE_LABELS_LENGTH + 64);
+}
+
+TEST(sse, reprise)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+
+    // un client reçoit des événements puis est déconnecté
+    WiFiClient::Socket &first = sse_connect(clients, server);
+    String data;
+    for (int i = 1; i <= SSE_REPLAY_EVENTS + 2; ++i)
+    {
+        data = String(i);
+        clients.handle_clients(&data);
+    }
+    first.connected = false;
+    clients.handle_clients();
+    ASSERT_EQ(clients.count(), 0u);
+
+    // reconnexion après l'événement 7: reprise des 8 à 10
+    server.headers["Last-Event-ID"] = "7";
+    WiFiClient::Socket &socket = sse_connect(clients, server);
+    socket.sent.erase(0, socket.sent.find(sse_headers_end) + strlen(sse_headers_end));
+    ASSERT_EQ(socket.sent, "id: 8\r\ndata: 8\r\n\r\nid: 9\r\ndata: 9\r\n\r\nid: 10\r\ndata: 10\r\n\r\n");
+
+    // trop ancien: ce qui reste de l'historique
+    server.headers["Last-Event-ID"] = "1";
+    WiFiClient::Socket &old = sse_connect(clients, server);
+    ASSERT_NE(old.sent.find("\r\n\r\nid: 3\r\ndata: 3\r\n\r\n"), std::string::npos);
+    ASSERT_EQ(old.sent.find("id: 2\r\n"), std::string::npos);
+
+    // client abonné à certaines étiquettes: pas de reprise des trames entières
+    server.headers["Last-Event-ID"] = "7";
+    server.query["labels"] = "PAPP";
+    WiFiClient::Socket &gauge = sse_connect(clients, server);
+    ASSERT_EQ(gauge.sent.find("id: "), std::string::npos);
+    server.query["labels"] = "";
+    gauge.connected = false;
+    clients.handle_clients();
+
+    // numéro d'avant un redémarrage, ou pas de numéro: pas de reprise
+    server.headers["Last-Event-ID"] = "1234";
+    WiFiClient::Socket &reboot = sse_connect(clients, server);
+    ASSERT_EQ(reboot.sent.find("id: "), std::string::npos);
+
+    // socket lente pendant la reprise: la reprise passe avant les nouveaux événements, sans doublon
+    server.headers["Last-Event-ID"] = "8";
+    server.current_client = WiFiClient();
+    server.current_client.socket().window = 0;
+    clients.handle_sse_data(server);
+    WiFiClient::Socket &slow = server.current_client.socket();
+
+    data = "11";
+    clients.handle_clients(&data);
+    data = "12";
+    clients.handle_clients(&data);
+    slow.window = SIZE_MAX;
+    clients.handle_clients();
+    slow.sent.erase(0, slow.sent.find(sse_headers_end) + strlen(sse_headers_end));
+    ASSERT_EQ(slow.sent, "id: 9\r\ndata: 9\r\n\r\nid: 10\r\ndata: 10\r\n\r\n"
+                         "id: 11\r\ndata: 11\r\n\r\nid: 12\r\ndata: 12\r\n\r\n");
+}
+
+TEST(sse, etiquettes)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+    static int projections;
+
+    auto project = [](String &data, const char *labels) {
+        ++projections;
+        data = "{";
+        data += labels;
+        data += "}";
+    };
+
+    WiFiClient::Socket &all = sse_connect(clients, server);
+    server.query["labels"] = "papp, iinst";
+    WiFiClient::Socket &gauge1 = sse_connect(clients, server);
+    WiFiClient::Socket &gauge2 = sse_connect(clients, server);
+    server.query["labels"] = "PAPP";
+    server.query["min_interval"] = "5";
+    WiFiClient::Socket &slow = sse_connect(clients, server);
+    for (auto socket : {&all, &gauge1, &gauge2, &slow})
+    {
+        socket->sent.clear();
+    }
+
+    // une projection par liste d'étiquettes, partagée entre les clients
+    projections = 0;
+    String data("{trame}");
+    mock_millis = 10000;
+    clients.handle_clients(&data, nullptr, project);
+    ASSERT_EQ(projections, 2);
+    ASSERT_EQ(all.sent, "id: 1\r\ndata: {trame}\r\n\r\n");
+    ASSERT_EQ(gauge1.sent, "id: 1\r\ndata: {PAPP,IINST}\r\n\r\n");
+    ASSERT_EQ(gauge2.sent, gauge1.sent);
+    ASSERT_EQ(slow.sent, "id: 1\r\ndata: {PAPP}\r\n\r\n");
+
+    // min_interval: pas de trame avant 5 s, les autres événements passent
+    mock_millis = 14999;
+    clients.handle_clients(&data, nullptr, project);
+    ASSERT_EQ(projections, 3);
+    String demand("{}");
+    clients.handle_clients(&demand, "demand");
+    ASSERT_EQ(slow.sent, "id: 1\r\ndata: {PAPP}\r\n\r\nid: 3\r\nevent: demand\r\ndata: {}\r\n\r\n");
+
+    mock_millis = 15000;
+    clients.handle_clients(&data, nullptr, project);
+    ASSERT_NE(slow.sent.find("id: 4\r\ndata: {PAPP}\r\n\r\n"), std::string::npos);
+    ASSERT_NE(gauge1.sent.find("id: 2\r\ndata: {PAPP,IINST}\r\n\r\n"), std::string::npos);
+    mock_millis = 1000;
+}
+
+TEST(sse, delta)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+    static int projections;
+
+    auto project = [](String &data, const char *) {
+        ++projections;
+        data = "{projection}";
+    };
+
+    WiFiClient::Socket &all = sse_connect(clients, server);
+    ASSERT_FALSE(clients.has_delta_clients());
+    server.query["delta"] = "1";
+    WiFiClient::Socket &delta = sse_connect(clients, server);
+    ASSERT_TRUE(clients.has_delta_clients());
+    server.query["labels"] = "PAPP";
+    WiFiClient::Socket &gauge = sse_connect(clients, server);
+    for (auto socket : {&all, &delta, &gauge})
+    {
+        socket->sent.clear();
+    }
+
+    // d'abord une trame complète, puis les différences
+    String frame("{trame}"), diff("{diff}");
+    clients.handle_clients(&frame, nullptr, project, &diff);
+    ASSERT_EQ(delta.sent, "id: 1\r\ndata: {trame}\r\n\r\n");
+    clients.handle_clients(&frame, nullptr, project, &diff);
+    ASSERT_EQ(delta.sent, "id: 1\r\ndata: {trame}\r\n\r\nid: 2\r\nevent: delta\r\ndata: {diff}\r\n\r\n");
+
+    // sans différences (trame complète périodique): tous reçoivent la trame
+    clients.handle_clients(&frame, nullptr, project);
+    ASSERT_NE(delta.sent.find("id: 3\r\ndata: {trame}\r\n\r\n"), std::string::npos);
+
+    // les autres clients n'en voient rien, et les étiquettes ont priorité sur le mode delta
+    ASSERT_EQ(all.sent.find("event: delta"), std::string::npos);
+    ASSERT_EQ(gauge.sent.find("event: delta"), std::string::npos);
+    ASSERT_EQ(projections, 3);
+
+    // socket bloquée: les différences ne remplacent pas une trame en attente,
+    // c'est une trame complète qui part au déblocage
+    delta.sent.clear();
+    delta.window = 0;
+    clients.handle_clients(&frame, nullptr, project, &diff);
+    clients.handle_clients(&frame, nullptr, project, &diff);
+    delta.window = SIZE_MAX;
+    clients.handle_clients();
+    ASSERT_EQ(delta.sent, "id: 5\r\ndata: {trame}\r\n\r\n");
+
+    // puis de nouveau les différences
+    clients.handle_clients(&frame, nullptr, project, &diff);
+    ASSERT_EQ(delta.sent, "id: 5\r\ndata: {trame}\r\n\r\nid: 6\r\nevent: delta\r\ndata: {diff}\r\n\r\n");
+
+    // une trame perdue dans une file pleine impose une trame complète
+    delta.sent.clear();
+    delta.window = 0;
+    String a("a"), b("b");
+    clients.handle_clients(&frame, nullptr, project, &diff);
+    clients.handle_clients(&a, "un");
+    clients.handle_clients(&b, "deux");
+    delta.window = SIZE_MAX;
+    clients.handle_clients(&frame, nullptr, project, &diff);
+    ASSERT_EQ(delta.sent, "id: 9\r\nevent: deux\r\ndata: b\r\n\r\n"
+                          "id: 10\r\ndata: {trame}\r\n\r\n");
+}
+
+TEST(sse, sans_client)
+{
+    ESP8266WebServer server;
+    SseClients clients;
+    String data("x");
+
+    // jamais de client: rien n'est gardé
+    clients.handle_clients(&data);
+    server.headers["Last-Event-ID"] = "1";
+    WiFiClient::Socket &socket = sse_connect(clients, server);
+    ASSERT_EQ(socket.sent.find("id: "), std::string::npos);
+
+    clients.handle_clients(&data);
+    ASSERT_NE(socket.sent.find("id: 2\r\n"), std::string::npos);
+    socket.connected = false;
+    clients.handle_clients();
+
+    // juste après le départ du dernier client, l'historique est encore tenu
+    mock_millis += 1000;
+    clients.handle_clients(&data);
+    server.headers["Last-Event-ID"] = "2";
+    WiFiClient::Socket &back = sse_connect(clients, server);
+    ASSERT_NE(back.sent.find("id: 3\r\n"), std::string::npos);
+    back.connected = false;
+    clients.handle_clients();
+
+    // plus tard, il est libéré et les événements ne sont plus gardés
+    mock_millis += SSE_REPLAY_DELAY * 1000;
+    clients.handle_clients(&data);
+    server.headers["Last-Event-ID"] = "3";
+    WiFiClient::Socket &late = sse_connect(clients, server);
+    ASSERT_EQ(late.sent.find("id: "), std::string::npos);
+
+    mock_millis = 1000;
+}
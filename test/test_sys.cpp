@@ -25,6 +25,9 @@ TEST(sys, get_json)
     auto j1 = json::parse(data.s);
 
     ASSERT_TRUE(j1.is_array());
+
+    EXPECT_NE(data.s.find("\"SSE Clients\",\"va\":\"0 / 4\""), std::string::npos);
+    EXPECT_NE(data.s.find("SSE Mémoire par client"), std::string::npos);
 }
 
 TEST(sys, wifi_scan)
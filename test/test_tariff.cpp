@@ -0,0 +1,145 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests de la consommation par période tarifaire
+//
+
+#include "mock.h"
+
+#include "tariff.h"
+
+static struct tm tariff_date(int year, int month, int mday)
+{
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = year - 1900;
+    tm.tm_mon = month - 1;
+    tm.tm_mday = mday;
+    return tm;
+}
+
+TEST(tariff, vide)
+{
+    TariffAccounting tariff;
+    const uint16_t prices[TariffAccounting::NB_INDEX] = {1000, 2000};
+
+    ASSERT_TRUE(tariff.is_empty());
+    ASSERT_EQ(tariff.active(), 0);
+    ASSERT_FALSE(tariff.has_period(1));
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 1), 0u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 0), 0u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 11), 0u);
+    ASSERT_EQ(tariff.cost(TariffAccounting::MONTH, prices), 0u);
+    ASSERT_STREQ(tariff.name(0), "");
+}
+
+TEST(tariff, heures_creuses)
+{
+    TariffAccounting tariff;
+    uint32_t index[TariffAccounting::NB_INDEX] = {52890470, 49126843};
+
+    tariff.set_name(1, "HC..");
+    tariff.set_name(2, "HP..");
+
+    // premier relevé: rien à compter
+    ASSERT_TRUE(tariff.add(tariff_date(2020, 5, 20), index, 2));
+    ASSERT_FALSE(tariff.is_empty());
+    ASSERT_EQ(tariff.active(), 2);
+    ASSERT_STREQ(tariff.name(tariff.active()), "HP..");
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 2), 0u);
+
+    // même relevé: rien n'a changé
+    ASSERT_FALSE(tariff.add(tariff_date(2020, 5, 20), index, 2));
+
+    index[1] += 1500;
+    ASSERT_TRUE(tariff.add(tariff_date(2020, 5, 20), index, 2));
+
+    // passage en heures creuses: l'index HP qui avance encore est compté en HP
+    index[0] += 200;
+    index[1] += 10;
+    ASSERT_TRUE(tariff.add(tariff_date(2020, 5, 20), index, 1));
+    ASSERT_EQ(tariff.active(), 1);
+
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 1), 200u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 2), 1510u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::MONTH, 2), 1510u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::YESTERDAY, 2), 0u);
+
+    // 0.1 €/kWh en HC, 0.15 €/kWh en HP: 0.02 + 0.2265 €
+    const uint16_t prices[TariffAccounting::NB_INDEX] = {1000, 1500};
+    ASSERT_EQ(tariff.cost(TariffAccounting::TODAY, prices), 2465u);
+}
+
+TEST(tariff, jours)
+{
+    TariffAccounting tariff;
+    uint32_t index[TariffAccounting::NB_INDEX] = {0, 0, 1000, 2000, 3000, 4000};
+
+    tariff.add(tariff_date(2020, 1, 30), index, 3);
+    index[2] += 100;
+    tariff.add(tariff_date(2020, 1, 30), index, 3);
+
+    // le lendemain: l'énergie de la première trame compte déjà pour le nouveau jour
+    index[2] += 10;
+    index[5] += 20;
+    ASSERT_TRUE(tariff.add(tariff_date(2020, 1, 31), index, 6));
+    ASSERT_EQ(tariff.energy(TariffAccounting::YESTERDAY, 3), 100u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 3), 10u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 6), 20u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::MONTH, 3), 110u);
+
+    // nouveau mois
+    index[5] += 5;
+    tariff.add(tariff_date(2020, 2, 1), index, 6);
+    ASSERT_EQ(tariff.energy(TariffAccounting::YESTERDAY, 3), 10u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::YESTERDAY, 6), 20u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::MONTH, 3), 0u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::MONTH, 6), 5u);
+
+    // jour sauté (coupure): hier est vide, février 2020 compte 29 jours
+    tariff.add(tariff_date(2020, 2, 3), index, 6);
+    ASSERT_EQ(tariff.energy(TariffAccounting::YESTERDAY, 6), 0u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::MONTH, 6), 5u);
+
+    index[5] += 1;
+    tariff.add(tariff_date(2020, 2, 29), index, 6);
+    tariff.add(tariff_date(2020, 3, 1), index, 6);
+    ASSERT_EQ(tariff.energy(TariffAccounting::YESTERDAY, 6), 1u);
+    ASSERT_EQ(tariff.energy(TariffAccounting::MONTH, 6), 0u);
+
+    // la fin d'année se suit aussi
+    tariff.add(tariff_date(2020, 12, 31), index, 6);
+    index[5] += 7;
+    tariff.add(tariff_date(2020, 12, 31), index, 6);
+    tariff.add(tariff_date(2021, 1, 1), index, 6);
+    ASSERT_EQ(tariff.energy(TariffAccounting::YESTERDAY, 6), 7u);
+}
+
+TEST(tariff, changement_index)
+{
+    TariffAccounting tariff;
+    uint32_t index[TariffAccounting::NB_INDEX] = {5000};
+
+    tariff.add(tariff_date(2020, 5, 20), index, 1);
+
+    // nouveau compteur: l'index recule et repart de là
+    index[0] = 10;
+    tariff.add(tariff_date(2020, 5, 20), index, 1);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 1), 0u);
+
+    index[0] = 15;
+    tariff.add(tariff_date(2020, 5, 20), index, 1);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 1), 5u);
+
+    // index absent de la trame: rien n'est compté
+    index[0] = 0;
+    tariff.add(tariff_date(2020, 5, 20), index, 1);
+    index[0] = 20;
+    tariff.add(tariff_date(2020, 5, 20), index, 1);
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 1), 10u);
+
+    tariff.clear();
+    ASSERT_TRUE(tariff.is_empty());
+    ASSERT_EQ(tariff.energy(TariffAccounting::TODAY, 1), 0u);
+}
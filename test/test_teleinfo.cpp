@@ -167,6 +167,9 @@ TEST(teleinfo, decode_int)
     ASSERT_TRUE(Teleinfo::get_integer(value));
     ASSERT_STREQ(value, "0");
 
+    value = "";
+    ASSERT_FALSE(Teleinfo::get_integer(value));
+
     value = "000123a";
     ASSERT_FALSE(Teleinfo::get_integer(value));
     ASSERT_STREQ(value, "000123a");
@@ -191,7 +194,7 @@ TEST(teleinfo, decode_ko_getters)
     ASSERT_FALSE(tinfo_decode.ready());
 
     // ni copiée
-    tinfo.copy_from(tinfo_decode);
+    tinfo.update_from(tinfo_decode);
     ASSERT_TRUE(tinfo.is_empty());
 
     // pas de valeur
@@ -297,7 +300,7 @@ TEST(teleinfo, copy)
         tinfo_decode.put(c);
     }
 
-    tinfo.copy_from(tinfo_decode);
+    tinfo.update_from(tinfo_decode);
 
     // la trame doit être décodée
     ASSERT_FALSE(tinfo.is_empty());
@@ -321,6 +324,177 @@ TEST(teleinfo, copy)
     ASSERT_EQ(tinfo.get_timestamp(), mock_time_timestamp());
 }
 
+// sans trame, pas de trame vide en mémoire: les accesseurs rendent les valeurs par défaut
+TEST(teleinfo, sans_trame)
+{
+    Teleinfo tinfo;
+    const char *label;
+    const char *value;
+    const char *state = nullptr;
+    char ascii[16];
+
+    ASSERT_TRUE(tinfo.is_empty());
+    ASSERT_FALSE(tinfo.is_standard());
+    ASSERT_FALSE(tinfo.has_changed());
+    ASSERT_EQ(tinfo.get_sequence(), 0u);
+    ASSERT_EQ(tinfo.get_timestamp(), 0);
+    ASSERT_EQ(tinfo.get_seconds(), "0.000");
+    ASSERT_EQ(tinfo.energy(), 0u);
+    ASSERT_EQ(tinfo.get_value("PAPP"), nullptr);
+    ASSERT_FALSE(tinfo.is_changed("PAPP"));
+    ASSERT_FALSE(tinfo.get_value_next(label, value, &state));
+    ASSERT_EQ(tinfo.get_frame_ascii(ascii, sizeof(ascii)), 0u);
+
+    // la trame publiée d'un décodeur neuf est un de ses deux buffers
+    TeleinfoDecoder decode;
+    tinfo.update_from(decode);
+    ASSERT_TRUE(tinfo.is_empty());
+    ASSERT_NE(tinfo.get_frame_id(), nullptr);
+}
+
+TEST(teleinfo, double_buffer)
+{
+    TeleinfoDecoder tinfo_decode;
+    Teleinfo tinfo;
+    std::string trames[2];
+
+    for (int i = 0; i < 2; ++i)
+    {
+        TeleinfoBuilder trame;
+        trame.add_group("ADCO", "111111111111");
+        trame.add_group("BASE", 52890470 + i, 9);
+        trame.add_group("PAPP", 1000 + i, 5);
+        trames[i] = trame.get();
+    }
+
+    for (auto c : trames[0])
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_TRUE(tinfo_decode.ready());
+    tinfo.update_from(tinfo_decode);
+
+    // pas de recopie: la valeur est dans le buffer du décodeur
+    const char *papp = tinfo.get_value("PAPP");
+    ASSERT_EQ(papp, tinfo_decode.get_value("PAPP"));
+    ASSERT_STREQ(papp, "01000");
+
+    // la trame suivante est reçue dans l'autre buffer, la trame publiée reste intacte
+    for (size_t i = 0; i < trames[1].length() - 1; ++i)
+    {
+        tinfo_decode.put(trames[1][i]);
+    }
+    ASSERT_FALSE(tinfo_decode.ready());
+    ASSERT_STREQ(tinfo.get_value("PAPP"), "01000");
+    ASSERT_EQ(tinfo.get_value_int("BASE"), 52890470u);
+
+    // ETX: la nouvelle trame est publiée
+    tinfo_decode.put(trames[1].back());
+    ASSERT_TRUE(tinfo_decode.ready());
+    ASSERT_STREQ(tinfo.get_value("PAPP"), "01000");
+    tinfo.update_from(tinfo_decode);
+    ASSERT_STREQ(tinfo.get_value("PAPP"), "01001");
+    ASSERT_NE(tinfo.get_value("PAPP"), papp);
+
+    // une trame invalide ne remplace pas la dernière trame complète
+    for (auto c : test_trame_ko)
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_FALSE(tinfo_decode.ready());
+    ASSERT_STREQ(tinfo_decode.get_value("PAPP"), "01001");
+}
+
+TEST(teleinfo, changes)
+{
+    TeleinfoDecoder tinfo_decode;
+    const char *label;
+    const char *value;
+    const char *state;
+
+    auto decode = [&](uint32_t papp, const char *ptec, bool adps, const char *option) {
+        TeleinfoBuilder trame;
+        trame.add_group("ADCO", "111111111111");
+        trame.add_group("HCHC", 52890470, 9);
+        trame.add_group("PTEC", ptec);
+        trame.add_group("PAPP", papp, 5);
+        if (adps)
+            trame.add_group("ADPS", 31, 3);
+        if (option != nullptr)
+            trame.add_group("OPTION", option); // étiquette inconnue
+        for (auto c : trame.get())
+        {
+            tinfo_decode.put(c);
+        }
+        ASSERT_TRUE(tinfo_decode.ready());
+    };
+
+    // pas de trame
+    ASSERT_FALSE(tinfo_decode.has_changed());
+    ASSERT_FALSE(tinfo_decode.is_changed(Label::PAPP));
+    ASSERT_EQ(tinfo_decode.get_sequence(), 0u);
+
+    // première trame: tout est nouveau
+    decode(1000, "HP..", false, "A");
+    ASSERT_EQ(tinfo_decode.get_sequence(), 1u);
+    ASSERT_TRUE(tinfo_decode.has_changed());
+    ASSERT_EQ(tinfo_decode.get_nb_changed(), 5);
+    ASSERT_EQ(tinfo_decode.get_nb_removed(), 0);
+    ASSERT_TRUE(tinfo_decode.is_changed("ADCO"));
+    ASSERT_TRUE(tinfo_decode.is_changed("OPTION"));
+    ASSERT_FALSE(tinfo_decode.is_changed(Label::ADPS));
+
+    // trame identique
+    decode(1000, "HP..", false, "A");
+    ASSERT_EQ(tinfo_decode.get_sequence(), 2u);
+    ASSERT_FALSE(tinfo_decode.has_changed());
+    ASSERT_FALSE(tinfo_decode.is_changed(Label::PAPP));
+    ASSERT_FALSE(tinfo_decode.is_changed("OPTION"));
+    state = nullptr;
+    ASSERT_FALSE(tinfo_decode.get_changed_next(label, value, &state));
+
+    // la puissance change, ADPS apparaît
+    decode(7000, "HP..", true, "A");
+    ASSERT_EQ(tinfo_decode.get_nb_changed(), 2);
+    ASSERT_TRUE(tinfo_decode.is_changed(Label::PAPP));
+    ASSERT_TRUE(tinfo_decode.is_changed("ADPS"));
+    ASSERT_FALSE(tinfo_decode.is_changed("HCHC"));
+    ASSERT_FALSE(tinfo_decode.is_changed(Label::PTEC));
+
+    state = nullptr;
+    ASSERT_TRUE(tinfo_decode.get_changed_next(label, value, &state));
+    ASSERT_STREQ(label, "PAPP");
+    ASSERT_STREQ(value, "07000");
+    ASSERT_TRUE(tinfo_decode.get_changed_next(label, value, &state));
+    ASSERT_STREQ(label, "ADPS");
+    ASSERT_FALSE(tinfo_decode.get_changed_next(label, value, &state));
+
+    // ADPS et OPTION disparaissent, la période change
+    decode(7000, "HC..", false, nullptr);
+    ASSERT_EQ(tinfo_decode.get_nb_changed(), 1);
+    ASSERT_EQ(tinfo_decode.get_nb_removed(), 2);
+    ASSERT_TRUE(tinfo_decode.is_changed(Label::PTEC));
+    ASSERT_TRUE(tinfo_decode.is_changed(Label::ADPS));
+    ASSERT_FALSE(tinfo_decode.is_changed("OPTION"));
+    ASSERT_FALSE(tinfo_decode.is_changed(Label::PAPP));
+
+    // une trame invalide ne compte pas: la comparaison se fait avec la dernière trame publiée
+    for (auto c : test_trame_ko)
+    {
+        tinfo_decode.put(c);
+    }
+    decode(7000, "HC..", false, nullptr);
+    ASSERT_FALSE(tinfo_decode.has_changed());
+
+    // le lecteur voit les différences de la trame qu'il a reprise
+    Teleinfo tinfo;
+    decode(7500, "HC..", false, nullptr);
+    tinfo.update_from(tinfo_decode);
+    ASSERT_EQ(tinfo.get_sequence(), tinfo_decode.get_sequence());
+    ASSERT_TRUE(tinfo.is_changed(Label::PAPP));
+    ASSERT_EQ(tinfo.get_nb_changed(), 1);
+}
+
 TEST(teleinfo, ascii)
 {
     TeleinfoDecoder tinfo_decode;
@@ -331,7 +505,7 @@ TEST(teleinfo, ascii)
         tinfo_decode.put(c);
     }
 
-    tinfo.copy_from(tinfo_decode);
+    tinfo.update_from(tinfo_decode);
 
     char output[Teleinfo::MAX_FRAME_SIZE];
     size_t sz = tinfo.get_frame_ascii(output, sizeof(output));
@@ -350,7 +524,7 @@ TEST(teleinfo, iterate)
         tinfo_decode.put(c);
     }
 
-    tinfo.copy_from(tinfo_decode);
+    tinfo.update_from(tinfo_decode);
 
     const char *label;
     const char *value;
@@ -379,3 +553,388 @@ TEST(teleinfo, iterate)
     // 11 valeurs dans la trame de téléinformation
     ASSERT_EQ(nb, 11u);
 }
+
+TEST(teleinfo, put_buffer)
+{
+    TeleinfoDecoder tinfo_decode;
+    std::string stream = test_trame_partielle_fin + trame_teleinfo + trame_teleinfo;
+    const uint8_t *buf = reinterpret_cast<const uint8_t *>(stream.data());
+    size_t len = stream.length();
+    size_t n;
+
+    // le décodeur s'arrête après la première trame complète
+    n = tinfo_decode.put(buf, len);
+    ASSERT_EQ(n, test_trame_partielle_fin.length() + trame_teleinfo.length());
+    ASSERT_TRUE(tinfo_decode.ready());
+    ASSERT_STREQ(tinfo_decode.get_value("PAPP"), "01890");
+
+    // puis après la deuxième
+    n = tinfo_decode.put(buf + n, len - n);
+    ASSERT_EQ(n, trame_teleinfo.length());
+    ASSERT_TRUE(tinfo_decode.ready());
+
+    // trame partielle: tout est consommé, pas de trame
+    n = tinfo_decode.put(reinterpret_cast<const uint8_t *>(test_trame_partielle_debut.data()), test_trame_partielle_debut.length());
+    ASSERT_EQ(n, test_trame_partielle_debut.length());
+    ASSERT_FALSE(tinfo_decode.ready());
+
+    // buffer vide
+    n = tinfo_decode.put(buf, 0);
+    ASSERT_EQ(n, 0u);
+    ASSERT_FALSE(tinfo_decode.ready());
+}
+
+TEST(teleinfo, index)
+{
+    TeleinfoDecoder tinfo_decode;
+    TeleinfoBuilder trame;
+
+    trame.add_group("ISOUSC", "30");
+    trame.add_group("PAPP", "01890");
+    trame.add_group("ISOUSC", "45");
+    trame.add_group("X", "");
+
+    for (auto c : trame.get())
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_TRUE(tinfo_decode.ready());
+
+    // en cas de doublon, c'est la première occurrence qui est retournée
+    ASSERT_STREQ(tinfo_decode.get_value("ISOUSC"), "30");
+    ASSERT_STREQ(tinfo_decode.get_value("PAPP"), "01890");
+    ASSERT_STREQ(tinfo_decode.get_value("X"), "");
+    ASSERT_EQ(tinfo_decode.get_value("PAP"), nullptr);
+    ASSERT_EQ(tinfo_decode.get_value(""), nullptr);
+
+    // accès par identifiant
+    ASSERT_STREQ(tinfo_decode.get_value(Label::ISOUSC), "30");
+    ASSERT_STREQ(tinfo_decode.get_value(Label::PAPP, nullptr, true), "1890");
+    ASSERT_EQ(tinfo_decode.get_value_int(Label::PAPP), 1890u);
+    ASSERT_EQ(tinfo_decode.get_value(Label::PTEC), nullptr);
+    ASSERT_STREQ(tinfo_decode.get_value(Label::PTEC, "?"), "?");
+    ASSERT_EQ(tinfo_decode.get_value(Label::unknown), nullptr);
+
+    // l'empreinte est calculable à la compilation
+    static_assert(Teleinfo::label_hash("PAPP") != Teleinfo::label_hash("PTEC"), "label_hash");
+
+    // trop de groupes pour l'index
+    trame.reset();
+    for (size_t i = 0; i <= Teleinfo::MAX_GROUPS; ++i)
+    {
+        trame.add_group("A", "1");
+    }
+    for (auto c : trame.get())
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_FALSE(tinfo_decode.ready());
+}
+
+TEST(teleinfo, decode_standard)
+{
+    TeleinfoDecoder tinfo_decode;
+    TeleinfoBuilder trame(true);
+
+    trame.add_group("ADSC", "041876097321");
+    trame.add_group("VTIC", "02");
+    trame.add_dated_group("DATE", "E200520164452", "");
+    trame.add_group("NGTF", "      BASE      ");
+    trame.add_group("LTARF", "HEURE  PLEINE");
+    trame.add_group("EAST", "001538257");
+    trame.add_group("EASF01", "001538257");
+    trame.add_group("SINSTS", "00460");
+    trame.add_dated_group("SMAXSN", "E200520095010", "01858");
+    trame.add_group("MSG1", "PAS DE          MESSAGE");
+
+    for (auto c : trame.get())
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_TRUE(tinfo_decode.ready());
+    ASSERT_TRUE(tinfo_decode.is_standard());
+
+    ASSERT_STREQ(tinfo_decode.get_value("ADSC"), "041876097321");
+    ASSERT_STREQ(tinfo_decode.get_value(Label::VTIC), "02");
+    ASSERT_STREQ(tinfo_decode.get_value(Label::DATE), "");
+    ASSERT_STREQ(tinfo_decode.get_date(Label::DATE), "E200520164452");
+    ASSERT_STREQ(tinfo_decode.get_value("NGTF"), "      BASE      ");
+    ASSERT_STREQ(tinfo_decode.get_value(Label::LTARF), "HEURE  PLEINE");
+    ASSERT_EQ(tinfo_decode.get_value_int(Label::SINSTS), 460u);
+    ASSERT_STREQ(tinfo_decode.get_value(Label::SMAXSN), "01858");
+    ASSERT_STREQ(tinfo_decode.get_date("SMAXSN"), "E200520095010");
+    ASSERT_EQ(tinfo_decode.get_date(Label::EAST), nullptr);
+    ASSERT_EQ(tinfo_decode.get_date("XXX"), nullptr);
+    ASSERT_STREQ(tinfo_decode.get_value("MSG1"), "PAS DE          MESSAGE");
+
+    ASSERT_EQ(tinfo_decode.energy(), 1538257u);
+
+    // le parcours de la trame retourne aussi les horodatages
+    const char *label;
+    const char *value;
+    const char *date;
+    const char *state = nullptr;
+    size_t nb = 0;
+    size_t nb_dates = 0;
+    while (tinfo_decode.get_value_next(label, value, &state, &date))
+    {
+        if (date != nullptr)
+        {
+            ++nb_dates;
+        }
+        ++nb;
+    }
+    ASSERT_EQ(nb, 10u);
+    ASSERT_EQ(nb_dates, 2u);
+
+    char raw[Teleinfo::MAX_FRAME_SIZE];
+    tinfo_decode.get_frame_ascii(raw, sizeof(raw));
+    ASSERT_EQ(strncmp(raw, "ADSC\t041876097321\nVTIC\t02\nDATE\tE200520164452\t\n", 45), 0);
+
+    // groupe relevé sur un compteur Linky
+    std::string vtic = "\x02\nVTIC\t02\tJ\r\x03";
+    for (auto c : vtic)
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_TRUE(tinfo_decode.ready());
+    ASSERT_STREQ(tinfo_decode.get_value(Label::VTIC), "02");
+
+    // checksum calculé en mode n°1 au lieu du mode n°2
+    vtic = "\x02\nVTIC\t02\tA\r\x03";
+    for (auto c : vtic)
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_FALSE(tinfo_decode.ready());
+}
+
+TEST(teleinfo, decode_mixed_modes)
+{
+    TeleinfoDecoder tinfo_decode;
+    TeleinfoBuilder historique;
+    TeleinfoBuilder standard(true);
+
+    historique.add_group("ADCO", "111111111111");
+    standard.add_group("EAST", "001538257");
+
+    // une trame ne peut pas mélanger les deux modes
+    std::string stream = historique.get();
+    stream.pop_back();
+    stream += standard.get().substr(1);
+
+    for (auto c : stream)
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_FALSE(tinfo_decode.ready());
+
+    // horodatage en mode historique: l'espace fait partie de la valeur
+    historique.reset();
+    historique.add_group("PTEC", "HP.. X");
+    for (auto c : historique.get())
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_TRUE(tinfo_decode.ready());
+    ASSERT_FALSE(tinfo_decode.is_standard());
+    ASSERT_STREQ(tinfo_decode.get_value("PTEC"), "HP.. X");
+    ASSERT_EQ(tinfo_decode.get_date("PTEC"), nullptr);
+
+    // trop de champs en mode standard
+    standard.reset();
+    standard.add_dated_group("SMAXSN", "E200520095010", "01858\t1");
+    for (auto c : standard.get())
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_FALSE(tinfo_decode.ready());
+}
+
+TEST(teleinfo, frame_too_long)
+{
+    TeleinfoDecoder tinfo_decode;
+    TeleinfoBuilder trame(true);
+    std::string value(40, 'A');
+
+    // moins de groupes que MAX_GROUPS mais plus d'octets que MAX_FRAME_SIZE
+    for (size_t i = 0; i < Teleinfo::MAX_FRAME_SIZE / value.length(); ++i)
+    {
+        trame.add_group("MSG1", value.c_str());
+    }
+    for (auto c : trame.get())
+    {
+        tinfo_decode.put(c);
+    }
+    ASSERT_FALSE(tinfo_decode.ready());
+}
+
+static int stats_time_ms = 0;
+
+static int stats_gettimeofday(struct timeval *tv, void *)
+{
+    tv->tv_sec = 1590000000 + stats_time_ms / 1000;
+    tv->tv_usec = (stats_time_ms % 1000) * 1000;
+    return 0;
+}
+
+TEST(teleinfo, stats)
+{
+    TeleinfoDecoder tinfo_decode;
+    tinfo_decode.set_time_cb(stats_gettimeofday);
+    const TeleinfoDecoder::Stats &stats = tinfo_decode.stats();
+
+    auto decode = [&](const std::string &data) {
+        for (auto c : data)
+        {
+            tinfo_decode.put(c);
+        }
+    };
+
+    ASSERT_EQ(stats.frames, 0u);
+    ASSERT_EQ(stats.interval_avg(), 0u);
+
+    // trois trames à 1.4 s puis 1.6 s d'intervalle
+    stats_time_ms = 0;
+    decode(trame_teleinfo);
+    stats_time_ms = 1400;
+    decode(trame_teleinfo);
+    stats_time_ms = 3000;
+    decode(trame_teleinfo);
+
+    ASSERT_EQ(stats.bytes, 3 * trame_teleinfo.length());
+    ASSERT_EQ(stats.frames, 3u);
+    ASSERT_EQ(stats.groups[0], 33u);
+    ASSERT_EQ(stats.intervals, 2u);
+    ASSERT_EQ(stats.interval_min, 1400u);
+    ASSERT_EQ(stats.interval_max, 1600u);
+    ASSERT_EQ(stats.interval_avg(), 1500u);
+
+    // trame interrompue par EOT
+    decode(test_trame_partielle_debut);
+    decode("\x04");
+    ASSERT_EQ(stats.interrupts, 1u);
+
+    // EOT hors trame: pas d'interruption
+    decode("\x04");
+    ASSERT_EQ(stats.interrupts, 1u);
+
+    // trame trop longue
+    TeleinfoBuilder trame;
+    std::string value(40, 'A');
+    for (size_t i = 0; i < Teleinfo::MAX_FRAME_SIZE / value.length(); ++i)
+    {
+        trame.add_group("MSG", value.c_str());
+    }
+    decode(trame.get());
+    ASSERT_EQ(stats.overflows, 1u);
+
+    // trop de groupes
+    TeleinfoBuilder groupes;
+    for (size_t i = 0; i <= Teleinfo::MAX_GROUPS; ++i)
+    {
+        groupes.add_group("A", "1");
+    }
+    decode(groupes.get());
+    ASSERT_EQ(stats.overflows, 2u);
+
+    // parasites entre deux trames: une seule resynchronisation
+    decode(trame_teleinfo);
+    uint32_t resyncs0 = stats.resyncs;
+    uint32_t stray0 = stats.stray_bytes;
+    decode(std::string(40, 'x'));
+    ASSERT_EQ(stats.resyncs, resyncs0 + 1);
+    ASSERT_EQ(stats.stray_bytes, stray0 + 40);
+
+    // trame coupée par un parasite: une seule aussi, pour elle et la suite
+    decode(test_trame_partielle_debut);
+    decode("xyz\n");
+    ASSERT_EQ(stats.resyncs, resyncs0 + 2);
+
+    // la trame suivante est valide, l'intervalle inclut les trames perdues
+    stats_time_ms = 10000;
+    uint32_t resyncs = stats.resyncs;
+    uint32_t checksum_errors = stats.checksum_errors;
+    decode(test_trame_ko);
+    ASSERT_GT(stats.checksum_errors + stats.resyncs, checksum_errors + resyncs);
+    decode(trame_teleinfo);
+    ASSERT_EQ(stats.frames, 5u);
+    ASSERT_EQ(stats.interval_max, 7000u);
+}
+
+TEST(teleinfo, parity_bit)
+{
+    TeleinfoDecoder tinfo_decode;
+
+    // liaison lue en 8 bits: le bit de parité (paire) est dans le bit de poids fort
+    for (auto c : trame_teleinfo)
+    {
+        uint8_t b = c;
+        if (__builtin_parity(b))
+        {
+            b |= 0x80;
+        }
+        tinfo_decode.put(b);
+    }
+
+    ASSERT_TRUE(tinfo_decode.ready());
+    ASSERT_STREQ(tinfo_decode.get_value("ADCO"), "111111111111");
+    ASSERT_STREQ(tinfo_decode.get_value("PAPP"), "01890");
+    ASSERT_EQ(tinfo_decode.stats().checksum_errors, 0u);
+}
+
+TEST(teleinfo, separators)
+{
+    auto decode = [](const std::string &data, TeleinfoDecoder &tinfo_decode) {
+        for (auto c : data)
+        {
+            tinfo_decode.put(c);
+        }
+    };
+
+    // historique: une tabulation dans la valeur est une donnée
+    {
+        TeleinfoDecoder tinfo_decode;
+        TeleinfoBuilder trame;
+        trame.add_group("MSG", "A\tB C");
+        decode(trame.get(), tinfo_decode);
+        ASSERT_TRUE(tinfo_decode.ready());
+        ASSERT_STREQ(tinfo_decode.get_value("MSG"), "A\tB C");
+    }
+
+    // historique: pas de tabulation dans l'étiquette
+    {
+        TeleinfoDecoder tinfo_decode;
+        TeleinfoBuilder trame;
+        trame.add_group("A\tB", "1");
+        decode(trame.get(), tinfo_decode);
+        ASSERT_FALSE(tinfo_decode.ready());
+        ASSERT_EQ(tinfo_decode.stats().checksum_errors, 0u);
+        ASSERT_NE(tinfo_decode.stats().resyncs, 0u);
+    }
+
+    // standard: pas d'espace dans l'étiquette
+    {
+        TeleinfoDecoder tinfo_decode;
+        TeleinfoBuilder trame(true);
+        trame.add_group("A B", "1");
+        decode(trame.get(), tinfo_decode);
+        ASSERT_FALSE(tinfo_decode.ready());
+        ASSERT_EQ(tinfo_decode.stats().checksum_errors, 0u);
+        ASSERT_NE(tinfo_decode.stats().resyncs, 0u);
+    }
+
+    // standard: groupe long, horodatage et valeur avec des espaces
+    {
+        TeleinfoDecoder tinfo_decode;
+        TeleinfoBuilder trame(true);
+        std::string pjourf = "00008001 NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE NONUTILE";
+        trame.add_group("PJOURF+1", pjourf.c_str());
+        trame.add_dated_group("SMAXSN", "E200520095010", "01858");
+        decode(trame.get(), tinfo_decode);
+        ASSERT_TRUE(tinfo_decode.ready());
+        ASSERT_EQ(tinfo_decode.get_value("PJOURF+1"), pjourf);
+        ASSERT_STREQ(tinfo_decode.get_value(Label::SMAXSN), "01858");
+        ASSERT_STREQ(tinfo_decode.get_date(Label::SMAXSN), "E200520095010");
+    }
+}
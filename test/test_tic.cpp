@@ -4,6 +4,7 @@
 #include "mock.h"
 #include "mock_time.h"
 #include <ESP8266HTTPClient.h>
+#include <flash_hal.h>
 
 #define ENABLE_LED
 #include "tic.cpp"
@@ -80,22 +81,22 @@ TEST(tic, tinfo_builder)
 {
     ASSERT_TRUE(empty_tinfo.is_empty());
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     ASSERT_TRUE(tinfo.is_empty());
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     tinfo_init(100, true, 0);
     ASSERT_FALSE(tinfo.is_empty());
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     tinfo_init(200, false, 0);
     ASSERT_FALSE(tinfo.is_empty());
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     tinfo_init(300, true, 100);
     ASSERT_FALSE(tinfo.is_empty());
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     tinfo_init(400, false, 200);
     ASSERT_FALSE(tinfo.is_empty());
 }
@@ -106,7 +107,7 @@ TEST(tic, notif_aucun)
 {
     test_config_notif(false, false, false);
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     ASSERT_TRUE(tinfo.is_empty());
 
     for (auto c : trame_teleinfo)
@@ -117,13 +118,327 @@ TEST(tic, notif_aucun)
     ASSERT_FALSE(tinfo.is_empty());
 }
 
+// test du décodage par buffer
+//
+TEST(tic, decode_buffer)
+{
+    test_config_notif(false, false, false);
+
+    tinfo.update_from(empty_tinfo);
+    ASSERT_TRUE(tinfo.is_empty());
+
+    std::string stream = "\x03\nIINST" + trame_teleinfo + trame_teleinfo + trame_teleinfo.substr(0, 20);
+    size_t frames = tic_decode_buffer(reinterpret_cast<const uint8_t *>(stream.data()), stream.length());
+
+    ASSERT_EQ(frames, 2u);
+    ASSERT_FALSE(tinfo.is_empty());
+    ASSERT_STREQ(tinfo.get_value("PAPP"), "01890");
+
+    // pas de décodage en pause
+    tinfo_pause = true;
+    frames = tic_decode_buffer(reinterpret_cast<const uint8_t *>(trame_teleinfo.data()), trame_teleinfo.length());
+    tinfo_pause = false;
+    ASSERT_EQ(frames, 0u);
+}
+
+// test des compteurs de réception
+//
+TEST(tic, stats)
+{
+    String data;
+    tic_get_stats_json(data, false);
+    auto j0 = json::parse(data.s);
+
+    std::string stream = "\x02\nADCO 111111111111 A\r\x03" + trame_teleinfo;
+    size_t frames = tic_decode_buffer(reinterpret_cast<const uint8_t *>(stream.data()), stream.length());
+    ASSERT_EQ(frames, 1u);
+
+    tic_get_stats_json(data, false);
+    auto j1 = json::parse(data.s);
+
+    ASSERT_EQ(j1["mode"], "historique");
+    ASSERT_EQ(j1["bytes"].get<uint32_t>() - j0["bytes"].get<uint32_t>(), stream.length());
+    ASSERT_EQ(j1["frames"].get<uint32_t>() - j0["frames"].get<uint32_t>(), 1u);
+    ASSERT_EQ(j1["groups"].get<uint32_t>() - j0["groups"].get<uint32_t>(), 11u);
+    ASSERT_EQ(j1["checksum_errors"].get<uint32_t>() - j0["checksum_errors"].get<uint32_t>(), 1u);
+    ASSERT_TRUE(j1.contains("overflows"));
+    ASSERT_TRUE(j1.contains("resyncs"));
+    ASSERT_TRUE(j1.contains("interrupts"));
+    ASSERT_TRUE(j1.contains("interval_avg"));
+
+    // la commande tic affiche aussi les compteurs
+    SerialClass::buffer.clear();
+    tic_dump();
+    ASSERT_NE(SerialClass::buffer.s.find("erreurs: checksum"), std::string::npos);
+}
+
+// test de l'historique de la consommation
+//
+TEST(tic, history)
+{
+    String data;
+
+    tic_history.clear();
+    ASSERT_TRUE(tic_get_history_json(data, "minute"));
+    ASSERT_EQ(data.s, "{}");
+
+    // l'horloge du mock n'est pas à l'heure: trame ignorée
+    for (auto c : trame_teleinfo)
+    {
+        tic_decode(c);
+    }
+    ASSERT_TRUE(tic_get_history_json(data, "minute"));
+    ASSERT_EQ(data.s, "{}");
+
+    // 2020-05-20 00:00:30 UTC puis une minute plus tard
+    tic_history.add(1589932830, 1000, 1890);
+    tic_history.add(1589932890, 1010, 2000);
+
+    ASSERT_TRUE(tic_get_history_json(data, "minute"));
+    auto j = json::parse(data.s);
+    ASSERT_EQ(j["period"], 60);
+    ASSERT_EQ(j["start"], 1589932800);
+    ASSERT_EQ(j["energy"], json::parse("[10,0]"));
+    ASSERT_EQ(j["peak"], json::parse("[1890,2000]"));
+
+    ASSERT_TRUE(tic_get_history_json(data, ""));
+    ASSERT_EQ(json::parse(data.s)["period"], 60);
+
+    // la période en cours seule, avec les minutes qu'elle contient
+    ASSERT_TRUE(tic_get_history_json(data, "hour"));
+    j = json::parse(data.s);
+    ASSERT_EQ(j["period"], 3600);
+    ASSERT_EQ(j["energy"], json::parse("[10]"));
+    ASSERT_EQ(j["peak"], json::parse("[2000]"));
+
+    ASSERT_TRUE(tic_get_history_json(data, "day"));
+    j = json::parse(data.s);
+    ASSERT_EQ(j["period"], 86400);
+    ASSERT_EQ(j["start"], 1589932800);
+
+    ASSERT_FALSE(tic_get_history_json(data, "week"));
+
+    // une journée de minutes, envoyée par morceaux sans tout garder en mémoire
+    for (uint32_t t = 120; t < 86400; t += 60)
+    {
+        tic_history.add(1589932830 + t, 1010 + t / 60, 1000);
+    }
+    ASSERT_TRUE(tic_get_history_json(data, "minute"));
+    ASSERT_GT(data.length(), 10000u);
+
+    ESP8266WebServer server;
+    ESP8266WebServer::send_code = 0;
+    ESP8266WebServer::content = "";
+    ESP8266WebServer::chunks.clear();
+    ASSERT_TRUE(tic_send_history(server, "minute"));
+    ASSERT_EQ(ESP8266WebServer::send_code, 200);
+    ASSERT_EQ(ESP8266WebServer::content.s, data.s);
+    ASSERT_GT(ESP8266WebServer::chunks.size(), data.length() / ChunkedOutput::BUFFER_SIZE);
+
+    // résolution inconnue: rien n'est envoyé
+    ESP8266WebServer::send_called = 0;
+    ASSERT_FALSE(tic_send_history(server, "week"));
+    ASSERT_EQ(ESP8266WebServer::send_called, 0);
+}
+
+// test de la sauvegarde de l'historique en flash
+//
+TEST(tic, history_flash)
+{
+    flash_hal_sim.reset();
+    tic_setup();
+    tic_history.clear();
+
+    // 3 heures terminées
+    for (uint32_t t = 0; t <= 3 * 3600; t += 600)
+    {
+        tic_history_add(1589932800 + t, 1000 + t / 60, 1000 + t / 600);
+    }
+    ASSERT_EQ(tic_history.hours().size(), 3u);
+    tic_save_history();
+
+    // au redémarrage, les heures et le jour en cours sont rechargés
+    tic_history.clear();
+    tic_setup();
+    tic_history_add(1589932800 + 3 * 3600 + 10, 2000, 100);
+
+    ASSERT_EQ(tic_history.hours().size(), 3u);
+    ASSERT_EQ(tic_history.hours().energy(2), 60u);
+    ASSERT_EQ(tic_history.hours().peak(2), 1017u);
+    ASSERT_EQ(tic_history.current(EnergyHistory::DAY).energy, 180u);
+}
+
+// test de la consommation par période tarifaire
+//
+TEST(tic, tariff)
+{
+    String data;
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+    tm.tm_year = 120;
+    tm.tm_mon = 4;
+    tm.tm_mday = 20;
+
+    tic_tariff.clear();
+    tic_get_tariff_json(data, false);
+    ASSERT_EQ(data.s, "{}");
+
+    memset(config.prices, 0, sizeof(config.prices));
+    uint32_t index[TariffAccounting::NB_INDEX] = {1000, 2000};
+    tic_tariff.set_name(1, "HC..");
+    tic_tariff.set_name(2, "HP..");
+    tic_tariff.add(tm, index, 2);
+    index[1] += 500;
+    tic_tariff.add(tm, index, 2);
+    tic_tariff_dirty = true;
+
+    tic_get_tariff_json(data, false);
+    auto j = json::parse(data.s);
+    ASSERT_EQ(j["active"], "HP..");
+    ASSERT_EQ(j["periods"], json::parse(R"(["HC..","HP.."])"));
+    ASSERT_EQ(j["today"], json::parse("[0,500]"));
+    ASSERT_EQ(j["yesterday"], json::parse("[0,0]"));
+    ASSERT_EQ(j["month"], json::parse("[0,500]"));
+    ASSERT_FALSE(j.contains("cost"));
+
+    // sans nouvelle trame, le JSON déjà calculé est renvoyé
+    ASSERT_FALSE(tic_tariff_dirty);
+    tic_tariff_json = "cache";
+    tic_get_tariff_json(data, false);
+    ASSERT_EQ(data.s, "cache");
+
+    // le changement des prix recalcule le JSON
+    config.prices[0] = 1000;
+    config.prices[1] = 1500;
+    tic_get_tariff_json(data, false);
+    j = json::parse(data.s);
+    ASSERT_EQ(j["cost"], json::parse("[0.075,0,0.075]"));
+
+    memset(config.prices, 0, sizeof(config.prices));
+    tic_tariff.clear();
+}
+
+// période tarifaire active d'une trame décodée en mode historique
+//
+TEST(tic, tariff_decode)
+{
+    String data;
+
+    tic_tariff.clear();
+    tic_tariff_dirty = true;
+    tinfo.update_from(empty_tinfo);
+
+    // trames reçues à l'heure, le 20 mai 2020
+    tinfo_decoder.set_time_cb([](struct timeval *tv, void *) {
+        tv->tv_sec = 1589968800;
+        tv->tv_usec = 0;
+        return 0;
+    });
+    for (int i = 0; i < 2; ++i)
+    {
+        for (auto c : trame_teleinfo)
+        {
+            tic_decode(c);
+        }
+    }
+    tinfo_decoder.set_time_cb(mock_gettimeofday);
+    ASSERT_STREQ(tinfo.get_value("PTEC"), "HP");
+
+    tic_get_tariff_json(data, false);
+    auto j = json::parse(data.s);
+    ASSERT_EQ(j["active"], "HP");
+    ASSERT_EQ(j["periods"], json::parse(R"(["HC","HP"])"));
+
+    tic_tariff.clear();
+}
+
+// test des pointes de puissance moyenne
+//
+TEST(tic, demand)
+{
+    String data;
+    struct tm tm;
+    memset(&tm, 0, sizeof(tm));
+
+    tic_demand.clear();
+    tic_get_demand_json(data, false);
+    ASSERT_EQ(data.s, "{}");
+
+    // trame avec ISOUSC=30, puis 10 min à 1890 VA
+    for (auto c : trame_teleinfo)
+    {
+        tic_decode(c);
+    }
+    for (uint32_t t = 0; t <= 600; t += 2)
+    {
+        tic_demand.add(1589932800 + t, 0, 1890, tm);
+    }
+
+    tic_get_demand_json(data, false);
+    auto j = json::parse(data.s);
+    ASSERT_EQ(j["limit"], 6000);
+    ASSERT_EQ(j["windows"].size(), 2u);
+    ASSERT_EQ(j["windows"][0]["period"], 600);
+    ASSERT_EQ(j["windows"][0]["last"], json::parse(R"({"time":1589932800,"va":1890})"));
+    ASSERT_EQ(j["windows"][0]["day"], json::parse(R"([{"time":1589932800,"va":1890}])"));
+    ASSERT_EQ(j["windows"][0]["month"].size(), 1u);
+    ASSERT_EQ(j["windows"][1]["period"], 1800);
+    ASSERT_EQ(j["windows"][1]["current"], 1890);
+    ASSERT_EQ(j["windows"][1]["day"], json::parse("[]"));
+
+    tic_demand.clear();
+}
+
+// test de l'envoi de la série temporelle
+//
+TEST(tic, series)
+{
+    ESP8266WebServer server;
+
+    test_config_notif(false, false, false);
+    tic_series.clear();
+
+    for (int i = 0; i < 100; ++i)
+    {
+        for (auto c : trame_teleinfo)
+        {
+            tic_decode(c);
+        }
+    }
+    ASSERT_EQ(tic_series.size(), 100u);
+
+    ESP8266WebServer::send_code = 0;
+    ESP8266WebServer::sendContent_called = 0;
+    ESP8266WebServer::content = "";
+    tic_send_series(server, 0);
+
+    ASSERT_EQ(ESP8266WebServer::send_code, 200);
+    ASSERT_GT(ESP8266WebServer::sendContent_called, 2); // plusieurs morceaux, et la fin
+
+    auto j = json::parse(ESP8266WebServer::content.s);
+    ASSERT_EQ(j["labels"], json::parse(R"(["HCHC","HCHP","PAPP","IINST"])"));
+    ASSERT_EQ(j["samples"].size(), 100u);
+    const auto &s = j["samples"][99];
+    ASSERT_EQ(s[0].get<double>(), static_cast<double>(tinfo.get_timestamp()) + tinfo.get_timestamp_ms() / 1000.);
+    ASSERT_EQ(s[1], tinfo.get_value_int("HCHC"));
+    ASSERT_EQ(s[2], tinfo.get_value_int("HCHP"));
+    ASSERT_EQ(s[3], 1890);
+    ASSERT_EQ(s[4], tinfo.get_value_int("IINST"));
+
+    // sous-échantillonnage
+    ESP8266WebServer::content = "";
+    tic_send_series(server, 10);
+    j = json::parse(ESP8266WebServer::content.s);
+    ASSERT_EQ(j["samples"].size(), 10u);
+}
+
 // test du cas général avec les 3 notifs
 //
 TEST(tic, notif_tous)
 {
     test_config_notif(true, true, true);
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     ASSERT_TRUE(tinfo.is_empty());
 
     HTTPClient::begin_called = 0;
@@ -447,10 +762,10 @@ TEST(tic, json_empty)
 {
     String data;
 
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
 
     // pas de données
-    tic_get_json_array(data, false);
+    data = tic_get_json_array(false);
     ASSERT_EQ(data, "[]");
 
     tic_get_json_dict(data, false);
@@ -459,21 +774,21 @@ TEST(tic, json_empty)
 
 TEST(tic, json)
 {
-    TeleinfoDecoder tinfo_decode;
+    static TeleinfoDecoder tinfo_decode; // tinfo référence sa trame
 
     for (auto c : trame_teleinfo)
     {
         tinfo_decode.put(c);
     }
 
-    tinfo.copy_from(tinfo_decode);
+    tinfo.update_from(tinfo_decode);
 
     // la trame ne doit pas décodée
     ASSERT_STREQ(tinfo.get_value("PAPP"), "01890");
 
     String output;
 
-    tic_get_json_array(output, false);
+    output = tic_get_json_array(false);
     // std::cout << output << std::endl;
     auto j1 = json::parse(output.s);
     ASSERT_TRUE(j1.is_array());
@@ -482,6 +797,10 @@ TEST(tic, json)
     ASSERT_EQ(j1[2]["na"], "ADCO");
     ASSERT_EQ(j1[2]["va"], "111111111111");
 
+    // le rendu partagé est envoyé tel quel, sans recopie
+    ASSERT_EQ(&tic_get_json_array(false), &tic_json[TIC_JSON_ARRAY]);
+    ASSERT_EQ(&tic_get_json_dict(false), &tic_json[TIC_JSON_DICT]);
+
     tic_get_json_dict(output, false);
     // std::cout << output << std::endl;
     auto j2 = json::parse(output.s);
@@ -492,6 +811,225 @@ TEST(tic, json)
     ASSERT_EQ(j2["MOTDETAT"], 0);
 }
 
+// test du rendu JSON partagé jusqu'à la trame suivante
+//
+TEST(tic, json_cache)
+{
+    tinfo_init(1800, false);
+
+    String dict;
+    tic_get_json_dict(dict, false);
+
+    // pas de nouvelle sérialisation pour la même trame
+    tic_json[TIC_JSON_DICT] += " ";
+    String output;
+    tic_get_json_dict(output, false);
+    ASSERT_EQ(output.s, dict.s + " ");
+
+    // notif est insérée dans le rendu existant
+    tic_json[TIC_JSON_DICT] = dict;
+    tic_get_json_dict_notif(output, "PTEC");
+    auto j1 = json::parse(output.s);
+    ASSERT_EQ(j1.size(), 14u);
+    ASSERT_EQ(j1["notif"], "PTEC");
+    ASSERT_EQ(j1["PAPP"], 1800);
+    ASSERT_EQ(output.s.find("\"seconds\""), dict.s.find("\"seconds\""));
+
+    String emoncms;
+    tic_emoncms_data(emoncms, false);
+    ASSERT_NE(emoncms.s.find("PAPP:1800"), std::string::npos);
+
+    // projection pour les clients SSE abonnés à certaines étiquettes
+    String projection;
+    tic_json_build_dict(projection, "PAPP,IINST,ABSENT");
+    auto j2 = json::parse(projection.s);
+    ASSERT_EQ(j2.size(), 4u);
+    ASSERT_EQ(j2["PAPP"], 1800);
+    ASSERT_EQ(j2["IINST"], 7);
+    ASSERT_TRUE(j2.contains("timestamp"));
+
+    // la trame suivante invalide tous les rendus
+    tinfo_init(2400, true);
+    tic_get_json_dict(output, false);
+    ASSERT_EQ(json::parse(output.s)["PAPP"], 2400);
+
+    emoncms.clear();
+    tic_emoncms_data(emoncms, false);
+    ASSERT_NE(emoncms.s.find("PAPP:2400"), std::string::npos);
+
+    output = tic_get_json_array(false);
+    ASSERT_EQ(json::parse(output.s).size(), 14u);
+}
+
+// un changement survenu entre deux envois SSE n'est pas perdu
+//
+TEST(tic, sse_changement)
+{
+    test_config_notif(false, false, false);
+
+    ESP8266WebServer server;
+    server.query["labels"] = "";
+    server.current_client = WiFiClient();
+    sse_clients.handle_sse_data(server);
+    WiFiClient::Socket &socket = server.current_client.socket();
+
+    timer_sse.trigger();
+    tinfo_init(1800, false);
+    tic_notifs();
+    ASSERT_NE(socket.sent.find("\"PAPP\":1800"), std::string::npos);
+
+    // PAPP change avant l'échéance, puis la trame suivante est identique
+    socket.sent.clear();
+    timer_sse.resetToNeverExpires();
+    tinfo_init(2400, false);
+    tic_notifs();
+    tinfo_init(2400, false);
+    ASSERT_FALSE(tinfo.has_changed());
+    timer_sse.trigger();
+    tic_notifs();
+    ASSERT_NE(socket.sent.find("\"PAPP\":2400"), std::string::npos);
+
+    // plus rien à envoyer
+    socket.sent.clear();
+    timer_sse.trigger();
+    tic_notifs();
+    ASSERT_EQ(socket.sent, "");
+
+    timer_sse.resetToNeverExpires();
+    socket.connected = false;
+    sse_clients.handle_clients();
+    ASSERT_EQ(sse_clients.count(), 0u);
+}
+
+// un client qui se connecte reçoit la trame même si elle ne change pas,
+// et elle est renvoyée périodiquement
+TEST(tic, sse_connexion)
+{
+    test_config_notif(false, false, false);
+
+    ESP8266WebServer server;
+    server.query["labels"] = "";
+    server.current_client = WiFiClient();
+    sse_clients.handle_sse_data(server);
+    WiFiClient::Socket &first = server.current_client.socket();
+
+    timer_sse.trigger();
+    tinfo_init(1800, false);
+    tic_notifs();
+    ASSERT_NE(first.sent.find("\"PAPP\":1800"), std::string::npos);
+
+    // trames identiques: rien ne part
+    first.sent.clear();
+    tinfo_init(1800, false);
+    ASSERT_FALSE(tinfo.has_changed());
+    timer_sse.trigger();
+    tic_notifs();
+    ASSERT_EQ(first.sent, "");
+
+    // un nouveau client n'attend ni un changement ni l'échéance du timer
+    server.current_client = WiFiClient();
+    sse_clients.handle_sse_data(server);
+    WiFiClient::Socket &second = server.current_client.socket();
+    second.sent.clear();
+    timer_sse.resetToNeverExpires();
+    tinfo_init(1800, false);
+    tic_notifs();
+    ASSERT_NE(second.sent.find("\"PAPP\":1800"), std::string::npos);
+
+    // une seule fois
+    first.sent.clear();
+    second.sent.clear();
+    timer_sse.trigger();
+    tinfo_init(1800, false);
+    tic_notifs();
+    ASSERT_EQ(second.sent, "");
+
+    // trame renvoyée inchangée au bout de SSE_KEEPALIVE secondes
+    mock_millis += SSE_KEEPALIVE * 1000 - 1;
+    timer_sse.trigger();
+    tinfo_init(1800, false);
+    tic_notifs();
+    ASSERT_EQ(first.sent, "");
+    mock_millis += 1;
+    timer_sse.trigger();
+    tinfo_init(1800, false);
+    tic_notifs();
+    ASSERT_NE(first.sent.find("\"PAPP\":1800"), std::string::npos);
+    ASSERT_NE(second.sent.find("\"PAPP\":1800"), std::string::npos);
+
+    mock_millis = 1000;
+    timer_sse.resetToNeverExpires();
+    first.connected = false;
+    second.connected = false;
+    sse_clients.handle_clients();
+    ASSERT_EQ(sse_clients.count(), 0u);
+}
+
+// différences pour les clients SSE en mode delta
+TEST(tic, json_delta)
+{
+    String delta;
+
+    // première trame: complète
+    tic_sse_delta.reset();
+    tinfo_init(1800, false);
+    ASSERT_FALSE(tic_json_build_delta(delta));
+
+    // seules les étiquettes modifiées, avec la date
+    delta.clear();
+    tinfo_init(2400, false);
+    ASSERT_TRUE(tic_json_build_delta(delta));
+    auto j = json::parse(delta.s);
+    ASSERT_EQ(j.size(), 4u);
+    ASSERT_EQ(j["PAPP"], 2400);
+    ASSERT_EQ(j["IINST"], 10);
+    ASSERT_TRUE(j.contains("timestamp"));
+    ASSERT_TRUE(j.contains("seconds"));
+    ASSERT_LT(delta.length(), tic_json_get(TIC_JSON_DICT).length() / 2);
+
+    // étiquette apparue: dans les différences, disparue: trame complète
+    delta.clear();
+    tinfo_init(2400, true, 45);
+    ASSERT_TRUE(tic_json_build_delta(delta));
+    j = json::parse(delta.s);
+    ASSERT_EQ(j.size(), 4u);
+    ASSERT_EQ(j["PTEC"], "HC");
+    ASSERT_EQ(j["ADPS"], 45);
+
+    delta.clear();
+    tinfo_init(2400, true);
+    ASSERT_FALSE(tic_json_build_delta(delta));
+
+    // trame complète périodique
+    for (int i = 0; i < SSE_KEYFRAME_INTERVAL; ++i)
+    {
+        delta.clear();
+        tinfo_init(2400 + i, true);
+        ASSERT_TRUE(tic_json_build_delta(delta));
+    }
+    delta.clear();
+    tinfo_init(1000, true);
+    ASSERT_FALSE(tic_json_build_delta(delta));
+
+    // trame manquée: ses modifications sont inconnues
+    delta.clear();
+    tinfo_init(1100, true);
+    tinfo_init(1100, true);
+    ASSERT_FALSE(tic_json_build_delta(delta));
+
+    // modifications cumulées sur les trames non diffusées
+    delta.clear();
+    tinfo_init(1200, true);
+    tic_sse_delta.add(tinfo);
+    tinfo_init(1200, true);
+    ASSERT_FALSE(tinfo.has_changed());
+    ASSERT_TRUE(tic_json_build_delta(delta));
+    j = json::parse(delta.s);
+    ASSERT_EQ(j.size(), 4u);
+    ASSERT_EQ(j["PAPP"], 1200);
+    ASSERT_EQ(j["IINST"], 5);
+}
+
 // test clignotement led ou pas sur réception téléinfo
 //
 TEST(tic, led)
@@ -501,7 +1039,7 @@ TEST(tic, led)
     // active le clignotement
     config.options |= OPTION_LED_TINFO;
     digitalWrite_called = 0;
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     ASSERT_TRUE(tinfo.is_empty());
     for (auto c : trame_teleinfo)
     {
@@ -513,7 +1051,7 @@ TEST(tic, led)
     // désactive le clignotement
     config.options &= ~OPTION_LED_TINFO;
     digitalWrite_called = 0;
-    tinfo.copy_from(empty_tinfo);
+    tinfo.update_from(empty_tinfo);
     ASSERT_TRUE(tinfo.is_empty());
     for (auto c : trame_teleinfo)
     {
@@ -533,3 +1071,89 @@ TEST(tic, get_value)
     ASSERT_STREQ(tic_get_value("OPTARIF"), "HC");
     ASSERT_STREQ(tic_get_value("HHPHC"), "A");
 }
+
+// test du mode standard
+//
+TEST(tic, standard)
+{
+    test_config_notif(false, false, false);
+
+    config.tic_mode = TIC_MODE_HISTORIQUE;
+    ASSERT_EQ(tic_baudrate(), 1200u);
+    config.tic_mode = TIC_MODE_STANDARD;
+    ASSERT_EQ(tic_baudrate(), 9600u);
+
+    TeleinfoBuilder trame(true);
+    trame.add_group("ADSC", "041876097321");
+    trame.add_dated_group("DATE", "E200520164452", "");
+    trame.add_group("LTARF", "HEURE  PLEINE");
+    trame.add_group("EAST", "001538257");
+    trame.add_group("SINSTS", "00460");
+    trame.add_dated_group("SMAXSN", "E200520095010", "01858");
+
+    tinfo.update_from(empty_tinfo);
+    size_t frames = tic_decode_buffer(reinterpret_cast<const uint8_t *>(trame.get().data()), trame.get().length());
+    ASSERT_EQ(frames, 1u);
+    ASSERT_TRUE(tinfo.is_standard());
+
+    String output;
+    tic_get_json_dict(output, false);
+    auto j = json::parse(output.s);
+    ASSERT_EQ(j["ADSC"], 41876097321);
+    ASSERT_EQ(j["LTARF"], "HEURE  PLEINE");
+    ASSERT_EQ(j["EAST"], 1538257);
+    ASSERT_EQ(j["SMAXSN"], 1858);
+    ASSERT_EQ(j["DATE"], "");
+
+    ASSERT_STREQ(tic_get_value("SINSTS"), "460");
+
+    // affichage avec les unités et les horodatages
+    SerialClass::buffer.clear();
+    tic_dump();
+    ASSERT_NE(SerialClass::buffer.s.find("mode standard"), std::string::npos);
+    ASSERT_NE(SerialClass::buffer.s.find("EAST       001538257 Wh\n"), std::string::npos);
+    ASSERT_NE(SerialClass::buffer.s.find("SMAXSN     01858 VA  E200520095010\n"), std::string::npos);
+
+    config.tic_mode = TIC_MODE_HISTORIQUE;
+}
+
+// test de la détection automatique du mode
+//
+TEST(tic, autobaud)
+{
+    test_config_notif(false, false, false);
+
+    config.tic_mode = TIC_MODE_AUTO;
+    config.tic_detected = TIC_MODE_STANDARD;
+    tic_setup();
+    ASSERT_EQ(tic_baudrate(), 9600u);
+
+    // une trame en mode standard suffit à verrouiller la détection
+    TeleinfoBuilder trame(true);
+    for (size_t i = 0; i < TeleinfoAutoBaud::LOCK_GROUPS; ++i)
+    {
+        trame.add_group("EAST", 1538257 + i, 9);
+    }
+    tic_decode_buffer(reinterpret_cast<const uint8_t *>(trame.get().data()), trame.get().length());
+    ASSERT_TRUE(tinfo_autobaud.locked());
+    ASSERT_EQ(tic_baudrate(), 9600u);
+    ASSERT_EQ(config.tic_detected, TIC_MODE_STANDARD);
+
+    // la vitesse configurée n'est pas soumise à la détection
+    tic_set_mode(TIC_MODE_HISTORIQUE);
+    ASSERT_EQ(tic_baudrate(), 1200u);
+
+    // retour en détection automatique sans redémarrer: elle reprend au dernier mode détecté
+    tic_set_mode(TIC_MODE_AUTO);
+    ASSERT_FALSE(tinfo_autobaud.locked());
+    ASSERT_EQ(tic_baudrate(), 9600u);
+
+    // octet par octet (client série), la détection suit aussi
+    for (auto c : trame.get())
+    {
+        tic_decode(c);
+    }
+    ASSERT_TRUE(tinfo_autobaud.locked());
+
+    config.tic_mode = TIC_MODE_HISTORIQUE;
+}
@@ -0,0 +1,56 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests du dictionnaire des étiquettes
+//
+
+#include "mock.h"
+
+#include "ticlabels.cpp"
+
+TEST(ticlabels, find)
+{
+    ASSERT_EQ(tic_label_find("PAPP"), Label::PAPP);
+    ASSERT_EQ(tic_label_find("ADCO"), Label::ADCO);
+    ASSERT_EQ(tic_label_find("SMAXSN1-1"), Label::SMAXSN1_1);
+    ASSERT_EQ(tic_label_find("NJOURF+1"), Label::NJOURF_1);
+    ASSERT_EQ(tic_label_find("PPOINTE"), Label::PPOINTE);
+
+    ASSERT_EQ(tic_label_find("PAP"), Label::unknown);
+    ASSERT_EQ(tic_label_find("papp"), Label::unknown);
+    ASSERT_EQ(tic_label_find(""), Label::unknown);
+
+    // mauvaise empreinte
+    ASSERT_EQ(tic_label_find("PAPP", tic_label_hash("PTEC")), Label::unknown);
+}
+
+TEST(ticlabels, all)
+{
+    // chaque étiquette est retrouvée par son nom
+    for (size_t i = 0; i < TIC_LABEL_COUNT; ++i)
+    {
+        Label id = static_cast<Label>(i);
+        const char *name = tic_label_name(id);
+        ASSERT_NE(name, nullptr);
+        ASSERT_LT(strlen(name), 10u);
+        ASSERT_EQ(tic_label_find(name), id) << name;
+    }
+
+    ASSERT_EQ(tic_label_name(Label::unknown), nullptr);
+    ASSERT_EQ(tic_label_unit(Label::unknown), nullptr);
+}
+
+TEST(ticlabels, info)
+{
+    ASSERT_STREQ(tic_label_name(Label::HCHP), "HCHP");
+    ASSERT_STREQ(tic_label_unit(Label::HCHP), "Wh");
+    ASSERT_EQ(tic_label_type(Label::HCHP), LabelType::numeric);
+
+    ASSERT_STREQ(tic_label_unit(Label::PAPP), "VA");
+    ASSERT_STREQ(tic_label_unit(Label::ERQ1), "VArh");
+    ASSERT_STREQ(tic_label_unit(Label::PTEC), "");
+    ASSERT_EQ(tic_label_type(Label::PTEC), LabelType::text);
+    ASSERT_EQ(tic_label_type(Label::DATE), LabelType::date);
+    ASSERT_EQ(tic_label_type(Label::unknown), LabelType::text);
+}
@@ -0,0 +1,167 @@
+// module téléinformation client
+// rene-d 2020
+
+//
+// tests de la série temporelle compressée
+//
+
+#include "mock.h"
+
+#include "timeseries.h"
+
+#include <vector>
+
+// 2020-05-20 00:00:00 UTC
+static const uint32_t SERIES_T0 = 1589932800;
+
+static TimeSample make_sample(uint32_t sec, uint16_t ms, uint32_t a, uint32_t b, uint32_t c, uint32_t d)
+{
+    TimeSample s;
+    s.sec = sec;
+    s.ms = ms;
+    s.values[0] = a;
+    s.values[1] = b;
+    s.values[2] = c;
+    s.values[3] = d;
+    return s;
+}
+
+template <typename Series>
+static std::vector<TimeSample> decode(const Series &series)
+{
+    std::vector<TimeSample> samples;
+    series.for_each([&](const TimeSample &s) { samples.push_back(s); });
+    return samples;
+}
+
+static void assert_same(const TimeSample &a, const TimeSample &b)
+{
+    ASSERT_EQ(a.sec, b.sec);
+    ASSERT_EQ(a.ms, b.ms);
+    for (int i = 0; i < TimeSample::NB_VALUES; ++i)
+    {
+        ASSERT_EQ(a.values[i], b.values[i]);
+    }
+}
+
+TEST(timeseries, vide)
+{
+    TimeSeries<4, 64> series;
+
+    ASSERT_EQ(series.size(), 0u);
+    ASSERT_EQ(series.bytes(), 0u);
+    ASSERT_EQ(series.for_each([](const TimeSample &) {}), 0u);
+}
+
+TEST(timeseries, aller_retour)
+{
+    TimeSeries<8, 128> series;
+    std::vector<TimeSample> samples;
+
+    // trames toutes les 1.2 à 1.5 s, index qui montent lentement, puissance qui varie
+    uint32_t ms = 0;
+    uint32_t hchc = 52890470;
+    uint32_t hchp = 49126843;
+    for (int i = 0; i < 200; ++i)
+    {
+        ms += 1200 + (i * 37) % 300;
+        if (i % 7 == 0)
+        {
+            ++hchp;
+        }
+        uint32_t papp = 1800 + (i * 53) % 400;
+        samples.push_back(make_sample(SERIES_T0 + ms / 1000, ms % 1000, hchc, hchp, papp, papp / 230));
+        series.add(samples.back());
+    }
+
+    std::vector<TimeSample> decoded = decode(series);
+    ASSERT_EQ(decoded.size(), samples.size());
+    ASSERT_EQ(series.size(), samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        assert_same(decoded[i], samples[i]);
+    }
+
+    // quelques bits par trame au lieu de 22 octets
+    ASSERT_LT(series.bytes(), samples.size() * 22 / 4);
+}
+
+TEST(timeseries, extremes)
+{
+    TimeSeries<4, 256> series;
+    std::vector<TimeSample> samples;
+
+    // variations maximales dans les deux sens, débordement des valeurs
+    samples.push_back(make_sample(SERIES_T0, 999, 0, UINT32_MAX, 0x80000000, 1));
+    samples.push_back(make_sample(SERIES_T0, 999, UINT32_MAX, 0, 0x7FFFFFFF, 1));
+    samples.push_back(make_sample(SERIES_T0 + 1, 0, 1, 1, 0x80000000, 17));
+    samples.push_back(make_sample(SERIES_T0 + 3600, 500, 0x12345678, 0xFFFFFFFE, 0, 16));
+    samples.push_back(make_sample(SERIES_T0 + 3600, 501, 0x12345678, 0xFFFFFFFE, 255, 0));
+    samples.push_back(make_sample(SERIES_T0 + 86400, 0, 0, 0, 0, 0));
+
+    for (const auto &s : samples)
+    {
+        series.add(s);
+    }
+
+    std::vector<TimeSample> decoded = decode(series);
+    ASSERT_EQ(decoded.size(), samples.size());
+    for (size_t i = 0; i < samples.size(); ++i)
+    {
+        assert_same(decoded[i], samples[i]);
+    }
+}
+
+TEST(timeseries, horloge)
+{
+    TimeSeries<4, 256> series;
+
+    series.add(make_sample(SERIES_T0 + 100, 0, 1, 2, 3, 4));
+    series.add(make_sample(SERIES_T0 + 101, 200, 1, 2, 3, 4));
+
+    // retour en arrière: nouveau bloc, les trames restent dans l'ordre d'arrivée
+    series.add(make_sample(SERIES_T0 + 50, 0, 1, 2, 3, 4));
+    series.add(make_sample(SERIES_T0 + 51, 300, 1, 2, 3, 4));
+
+    // long écart: nouveau bloc
+    series.add(make_sample(SERIES_T0 + 10 * 86400, 0, 5, 6, 7, 8));
+
+    std::vector<TimeSample> decoded = decode(series);
+    ASSERT_EQ(decoded.size(), 5u);
+    ASSERT_EQ(decoded[1].sec, SERIES_T0 + 101);
+    ASSERT_EQ(decoded[1].ms, 200);
+    ASSERT_EQ(decoded[2].sec, SERIES_T0 + 50);
+    ASSERT_EQ(decoded[3].sec, SERIES_T0 + 51);
+    ASSERT_EQ(decoded[3].ms, 300);
+    ASSERT_EQ(decoded[4].sec, SERIES_T0 + 10 * 86400);
+    ASSERT_EQ(decoded[4].values[3], 8u);
+}
+
+TEST(timeseries, recyclage)
+{
+    TimeSeries<3, 32> series;
+    std::vector<TimeSample> samples;
+
+    // des variations de 32 bits remplissent vite les blocs
+    for (uint32_t i = 0; i < 100; ++i)
+    {
+        samples.push_back(make_sample(SERIES_T0 + i, 0, i * 0x10000001u, i, i * 0x20000003u, i));
+        series.add(samples.back());
+    }
+
+    std::vector<TimeSample> decoded = decode(series);
+    ASSERT_GT(decoded.size(), 0u);
+    ASSERT_LT(decoded.size(), samples.size());
+    ASSERT_LE(series.bytes(), 3u * 32u);
+
+    // seules les trames les plus récentes sont gardées, sans trou
+    size_t offset = samples.size() - decoded.size();
+    for (size_t i = 0; i < decoded.size(); ++i)
+    {
+        assert_same(decoded[i], samples[offset + i]);
+    }
+
+    series.clear();
+    ASSERT_EQ(series.size(), 0u);
+    ASSERT_EQ(decode(series).size(), 0u);
+}
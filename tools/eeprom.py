@@ -45,6 +45,21 @@ def get_eeprom_base():
     return base - 0x40200000
 
 
+def prices_to_str(prices):
+    """ Prix du kWh en dix-millièmes d'euro, jusqu'au dernier prix défini, comme l'interface web. """
+    while prices and prices[-1] == 0:
+        prices = prices[:-1]
+    return ",".join(f"{p // 10000}.{p % 10000:04d}" for p in prices)
+
+
+def prices_from_str(s):
+    """ Lit les prix du kWh en euros séparés par des virgules (10 au plus). """
+    prices = [round(float(p) * 10000) if p.strip() else 0 for p in s.split(",")] if s else []
+    if len(prices) > 10 or any(not 0 <= p <= 65535 for p in prices):
+        raise ValueError(f"prix invalides: {s}")
+    return prices + [0] * (10 - len(prices))
+
+
 def write_eeprom(config):
     """ Sérialise la conf dans la page de 1Ko. """
 
@@ -83,7 +98,7 @@ def write_eeprom(config):
     )
 
     eeprom = struct.pack(
-        "<33s65s17s65s65sIHH32s32s65s128s256s256s",
+        "<33s65s17s65s65sIHH32s32sBB10H43s128s256s256s",
         config["ssid"].encode(),
         config["psk"].encode(),
         config["host"].encode(),
@@ -94,6 +109,9 @@ def write_eeprom(config):
         config["sse_freq"],
         config["username"].encode(),
         config["password"].encode(),
+        config.get("tic_mode", 0),
+        config.get("tic_detected", 0),
+        *prices_from_str(config.get("prices", "")),
         b"",  # filler
         emoncms,
         jeedom,
@@ -122,7 +140,7 @@ def read_eeprom(eeprom):
 
     config = {}
 
-    d = struct.unpack("<33s65s17s65s65sIHH32s32s65s128s256s256sH", eeprom)
+    d = struct.unpack("<33s65s17s65s65sIHH32s32sBB10H43s128s256s256sH", eeprom)
     config["ssid"] = d[0].rstrip(b"\0").decode()
     config["psk"] = d[1].rstrip(b"\0").decode()
     config["host"] = d[2].rstrip(b"\0").decode()
@@ -133,8 +151,11 @@ def read_eeprom(eeprom):
     config["sse_freq"] = d[7]
     config["username"] = d[8].rstrip(b"\0").decode()
     config["password"] = d[9].rstrip(b"\0").decode()
+    config["tic_mode"] = d[10]
+    config["tic_detected"] = d[11]
+    config["prices"] = prices_to_str(list(d[12:22]))
 
-    emoncms = struct.unpack_from("<33s33s33sHBI", d[11])
+    emoncms = struct.unpack_from("<33s33s33sHBI", d[23])
     config["emon_host"] = emoncms[0].rstrip(b"\0").decode()
     config["emon_apikey"] = emoncms[1].rstrip(b"\0").decode()
     config["emon_url"] = emoncms[2].rstrip(b"\0").decode()
@@ -142,7 +163,7 @@ def read_eeprom(eeprom):
     config["emon_node"] = emoncms[4]
     config["emon_freq"] = emoncms[5]
 
-    jeedom = struct.unpack_from("<33s49s65s13sHI", d[12])
+    jeedom = struct.unpack_from("<33s49s65s13sHI", d[24])
     config["jdom_host"] = jeedom[0].rstrip(b"\0").decode()
     config["jdom_apikey"] = jeedom[1].rstrip(b"\0").decode()
     config["jdom_url"] = jeedom[2].rstrip(b"\0").decode()
@@ -150,7 +171,7 @@ def read_eeprom(eeprom):
     config["jdom_port"] = jeedom[4]
     config["jdom_freq"] = jeedom[5]
 
-    httpreq = struct.unpack_from("<33s151sHIBHH", d[13])
+    httpreq = struct.unpack_from("<33s151sHIBHH", d[25])
     config["httpreq_host"] = httpreq[0].rstrip(b"\0").decode()
     config["httpreq_url"] = httpreq[1].rstrip(b"\0").decode()
     config["httpreq_port"] = httpreq[2]
@@ -162,7 +183,7 @@ def read_eeprom(eeprom):
     config["httpreq_seuil_haut"] = httpreq[5]
     config["httpreq_seuil_bas"] = httpreq[6]
 
-    config["crc"] = f"0x{d[14]:04x}"
+    config["crc"] = f"0x{d[26]:04x}"
 
     return config
 
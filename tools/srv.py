@@ -115,6 +115,8 @@ def config_json():
         "ota_auth": "OTA_WifInfo",
         "ota_port": "8266",
         "sse_freq": 0,
+        "tic_mode": 0,
+        "prices": "0.1327,0.1654",
         "jdom_host": "jeedom.local",
         "jdom_port": "80",
         "jdom_url": "/plugins/teleinfo/core/php/jeeTeleinfo.php",